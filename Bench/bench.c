@@ -0,0 +1,761 @@
+/******************************************************************************
+ *
+ * File Name: bench.c
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: Scaling benchmark for the Task1 (blocking) and Task2 (non
+ * 				blocking) i2c_flash drivers. Runs 1 to N client threads or
+ * 				processes with a mixed read and write load, records the latency
+ * 				of every operation, the throughput and the CPU time used, and
+ * 				checks every page read back for lost or mixed up data. Prints
+ * 				one CSV line per client count, so runs of different driver
+ * 				builds can be put side by side. The requests come from the
+ * 				workload generator, and can run against the software model
+ * 				instead of a device.
+ *
+ *****************************************************************************/
+
+/**
+ *Include Library Headers
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "target.h"
+#include "workload.h"
+
+/**
+ * Define constants using the macro
+ */
+#define DEFAULT_CLIENTS		8
+#define DEFAULT_OPS			200
+#define DEFAULT_READ_PCT	50
+#define DEFAULT_PAGES		1
+#define TAG_SIZE			8
+#define OP_READ				WORKLOAD_READ
+#define OP_WRITE			WORKLOAD_WRITE
+
+/**
+ *  Head of every page written by the benchmark, the rest of the page is a
+ *  pattern derived from it
+ */
+struct bench_tag
+{
+	uint32_t seq;					/* Write sequence of the client */
+	uint16_t page;					/* Page the data was meant for */
+	uint8_t  client;				/* Client that wrote it */
+	uint8_t  check;					/* XOR of the bytes above */
+};
+
+/**
+ *  One timed operation
+ */
+struct bench_op
+{
+	uint64_t latency_ns;
+	char     type;
+};
+
+/**
+ *  Results of one client, kept in shared memory so processes can report them
+ */
+struct bench_client
+{
+	unsigned int id;
+	unsigned int first_page;		/* Pages owned by the client */
+	unsigned int region_pages;
+	unsigned int ops_done;
+	unsigned int pages_done;		/* Pages moved by the timed operations */
+	unsigned int lost;				/* Pages read back older than last written */
+	unsigned int mixed;				/* Pages of another client or another page */
+	unsigned int corrupt;			/* Pages whose pattern is broken */
+	unsigned int io_errors;			/* Calls that failed */
+	struct bench_op *ops;			/* ops_per_client entries */
+};
+
+/**
+ *  Settings of the run, from the command line
+ */
+struct bench_config
+{
+	const char *path;
+	const char *label;
+	int driver;						/* TARGET_BLOCKING, TARGET_POLLING or TARGET_MODEL */
+	unsigned int max_clients;
+	unsigned int ops_per_client;
+	struct workload_config workload;
+	unsigned int poll_us;
+	int processes;					/* Clients are processes instead of threads */
+	int serialize;					/* Hold a lock around seek and transfer */
+	int accept_only;				/* Time writes until queued, not until on the chip */
+	int order;						/* Run the ordering check instead of the benchmark */
+	unsigned int page_size;
+	unsigned int number_of_pages;
+	unsigned int bus_hz;			/* Of the model */
+	unsigned int write_cycle_us;
+	struct eeprom_model *model;
+};
+
+static struct bench_config config;
+static pthread_mutex_t *bench_lock;		/* Shared between processes when serialize is set */
+
+/**
+* bench_fill_page - Function to build the data of one page
+* @buf: Page buffer
+* @client: Writing client
+* @page: Page number on the chip
+* @seq: Write sequence
+*
+* Returns void.
+*/
+static void bench_fill_page(unsigned char *buf, unsigned int client, unsigned int page, uint32_t seq)
+{
+	struct bench_tag tag;
+	unsigned int i;
+
+	tag.seq    = seq;
+	tag.page   = page;
+	tag.client = client;
+	tag.check  = (seq ^ (seq >> 8) ^ (seq >> 16) ^ (seq >> 24) ^ page ^ (page >> 8) ^ client) & 0xFF;
+	memcpy(buf, &tag, TAG_SIZE);
+	for(i = TAG_SIZE; i < config.page_size; i++)
+	{
+		buf[i] = (seq * 31 + page + i) & 0xFF;
+	}
+}
+
+/**
+* bench_check_page - Function to check one page read back
+* @c: Reading client
+* @buf: Page data
+* @page: Page number on the chip
+* @expected: Sequence the client last wrote to the page
+*
+* Returns void, the errors are counted in the client.
+*/
+static void bench_check_page(struct bench_client *c, const unsigned char *buf, unsigned int page, uint32_t expected)
+{
+	struct bench_tag tag;
+	unsigned int i;
+
+	memcpy(&tag, buf, TAG_SIZE);
+	if(tag.check != ((tag.seq ^ (tag.seq >> 8) ^ (tag.seq >> 16) ^ (tag.seq >> 24) ^ tag.page ^ (tag.page >> 8) ^ tag.client) & 0xFF))
+	{
+		c->corrupt++;
+		return;
+	}
+	if(tag.client != c->id || tag.page != (page & 0xFFFF) || tag.seq > expected)
+	{
+		c->mixed++;
+		return;
+	}
+	if(tag.seq < expected)
+	{
+		c->lost++;
+		return;
+	}
+	for(i = TAG_SIZE; i < config.page_size; i++)
+	{
+		if(buf[i] != ((tag.seq * 31 + page + i) & 0xFF))
+		{
+			c->corrupt++;
+			return;
+		}
+	}
+}
+
+/**
+* bench_read - Function to read pages from a given page on
+* @target: Target
+* @buf: Data Buffer
+* @page: First page
+* @count: Number of pages
+*
+* Returns 0, or negative errno.
+*/
+static int bench_read(struct eeprom_target *target, unsigned char *buf, unsigned int page, unsigned int count)
+{
+	long retValue;
+
+	retValue = target_ioctl(target, page, FLASHSETP);
+	if(retValue < 0)
+	{
+		return retValue;
+	}
+	return target_read(target, buf, count);
+}
+
+/**
+* bench_write - Function to write pages from a given page on and wait as configured
+* @target: Target
+* @buf: Data Buffer
+* @page: First page
+* @count: Number of pages
+*
+* Returns 0, or negative errno.
+*/
+static int bench_write(struct eeprom_target *target, unsigned char *buf, unsigned int page, unsigned int count)
+{
+	long retValue;
+
+	retValue = target_ioctl(target, page, FLASHSETP);
+	if(retValue < 0)
+	{
+		return retValue;
+	}
+	retValue = target_write(target, buf, count);
+	return (retValue < 0) ? retValue : 0;
+}
+
+/**
+* bench_client_run - Function run by every client thread or process
+* @arg: Client
+*
+* Returns NULL.
+*
+* Description: Writes the whole region of the client first, untimed, then runs
+* 				the timed requests of the workload generator on the region. In
+* 				an open loop a request is timed from when it was due, so a
+* 				target that falls behind the arrival rate shows it in the
+* 				latency and not only in the throughput.
+*/
+static void *bench_client_run(void *arg)
+{
+	struct bench_client *c = arg;
+	struct eeprom_target target;
+	unsigned int pageSize = config.page_size;
+	unsigned int maxPages = config.workload.max_pages;
+	unsigned int i, j, page, count;
+	struct workload workload;
+	struct workload_op op;
+	uint32_t *lastSeq, seq = 0;
+	unsigned char *buf;
+	uint64_t start, due;
+	int opened, retValue;
+	char type;
+
+	opened = target_open(&target, config.path, config.driver, config.model);
+	target.poll_us = config.poll_us;
+	target.accept_only = config.accept_only;
+	buf = malloc(maxPages * pageSize);
+	lastSeq = calloc(c->region_pages, sizeof(uint32_t));
+	if(opened < 0 || buf == NULL || lastSeq == NULL || workload_init(&workload, &config.workload, c->region_pages, c->id * 7919 + 1) < 0)
+	{
+		c->io_errors++;
+		goto out;
+	}
+	for(i = 0; i < c->region_pages; i += count)
+	{
+		count = (c->region_pages - i < maxPages) ? c->region_pages - i : maxPages;
+		for(j = 0; j < count; j++)
+		{
+			bench_fill_page(&buf[j * pageSize], c->id, c->first_page + i + j, 0);
+		}
+		if(bench_write(&target, buf, c->first_page + i, count) < 0)
+		{
+			c->io_errors++;
+		}
+	}
+	due = target_now_ns();
+	for(i = 0; i < config.ops_per_client; i++)
+	{
+		workload_next(&workload, &op);
+		page  = op.page;
+		count = op.count;
+		type  = op.type;
+		if(type == OP_WRITE)
+		{
+			seq++;
+			for(j = 0; j < count; j++)
+			{
+				bench_fill_page(&buf[j * pageSize], c->id, c->first_page + page + j, seq);
+			}
+		}
+		if(config.serialize)
+		{
+			pthread_mutex_lock(bench_lock);
+		}
+		if(config.workload.rate > 0.0)
+		{
+			due += op.gap_ns;
+			target_sleep_until(due);
+			start = due;
+		}
+		else
+		{
+			start = target_now_ns();
+		}
+		if(type == OP_READ)
+		{
+			retValue = bench_read(&target, buf, c->first_page + page, count);
+		}
+		else
+		{
+			retValue = bench_write(&target, buf, c->first_page + page, count);
+		}
+		c->ops[i].latency_ns = target_now_ns() - start;
+		c->ops[i].type = type;
+		if(config.serialize)
+		{
+			pthread_mutex_unlock(bench_lock);
+		}
+		c->ops_done++;
+		if(op.think_ns)
+		{
+			target_sleep_until(target_now_ns() + op.think_ns);
+		}
+		if(retValue < 0)
+		{
+			c->io_errors++;
+			continue;
+		}
+		c->pages_done += count;
+		for(j = 0; j < count; j++)
+		{
+			if(type == OP_READ)
+			{
+				bench_check_page(c, &buf[j * pageSize], c->first_page + page + j, lastSeq[page + j]);
+			}
+			else
+			{
+				lastSeq[page + j] = seq;
+			}
+		}
+	}
+out:
+	target_close(&target);
+	free(buf);
+	free(lastSeq);
+	return NULL;
+}
+
+/**
+* bench_cpu_busy - Function to read the busy and total CPU time of the system
+* @busy: Set to the jiffies not idle
+* @total: Set to all jiffies
+*
+* Returns 0, or -1 if /proc/stat can not be read.
+*
+* Description: System wide, so the driver's kernel threads and interrupts are
+* 				counted too.
+*/
+static int bench_cpu_busy(unsigned long long *busy, unsigned long long *total)
+{
+	unsigned long long v[8] = { 0 };
+	FILE *f = fopen("/proc/stat", "r");
+	int n;
+
+	if(f == NULL)
+	{
+		return -1;
+	}
+	n = fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+	fclose(f);
+	if(n < 4)
+	{
+		return -1;
+	}
+	*total = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+	*busy  = *total - v[3] - v[4];
+	return 0;
+}
+
+/**
+* bench_compare_ns - Function to order latencies for qsort
+*/
+static int bench_compare_ns(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+* bench_percentiles - Function to print the latency percentiles of one op type
+* @clients: Client results
+* @number: Number of clients
+* @type: OP_READ or OP_WRITE
+*
+* Returns void, prints p50, p90, p99, p99.9 and max in microseconds.
+*/
+static void bench_percentiles(struct bench_client *clients, unsigned int number, char type)
+{
+	static const double points[] = { 0.50, 0.90, 0.99, 0.999 };
+	uint64_t *lat;
+	size_t n = 0, i, j;
+
+	lat = malloc((size_t)number * config.ops_per_client * sizeof(uint64_t));
+	for(i = 0; lat != NULL && i < number; i++)
+	{
+		for(j = 0; j < clients[i].ops_done; j++)
+		{
+			if(clients[i].ops[j].type == type)
+			{
+				lat[n++] = clients[i].ops[j].latency_ns;
+			}
+		}
+	}
+	if(n == 0)
+	{
+		printf(",,,,,");
+		free(lat);
+		return;
+	}
+	qsort(lat, n, sizeof(uint64_t), bench_compare_ns);
+	for(i = 0; i < sizeof(points) / sizeof(points[0]); i++)
+	{
+		printf(",%.1f", lat[(size_t)(points[i] * (n - 1))] / 1000.0);
+	}
+	printf(",%.1f", lat[n - 1] / 1000.0);
+	free(lat);
+}
+
+/**
+* bench_run - Function to run one client count and print its CSV line
+* @number: Number of clients
+*
+* Returns 0, or -1 if the clients could not be started.
+*/
+static int bench_run(unsigned int number)
+{
+	struct bench_client *clients;
+	struct bench_op *opsArea;
+	pthread_t threads[number];
+	pid_t pids[number];
+	struct rusage before, after;
+	unsigned long long busy0 = 0, total0 = 0, busy1 = 0, total1 = 0;
+	unsigned int i, region = config.number_of_pages / number, totalOps = 0, lost = 0, mixed = 0, corrupt = 0, ioErrors = 0;
+	unsigned long long totalPages = 0;
+	const char *driver;
+	char name[32];
+	uint64_t start, wall;
+	double clientCpu, seconds;
+	size_t opsBytes = (size_t)number * config.ops_per_client * sizeof(struct bench_op);
+
+	if(region < config.workload.max_pages)
+	{
+		fprintf(stderr, "%u clients need at least %u pages each\n", number, config.workload.max_pages);
+		return -1;
+	}
+	clients = mmap(NULL, number * sizeof(struct bench_client), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	opsArea = mmap(NULL, opsBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if(clients == MAP_FAILED || opsArea == MAP_FAILED)
+	{
+		perror("mmap");
+		return -1;
+	}
+	memset(clients, 0, number * sizeof(struct bench_client));
+	for(i = 0; i < number; i++)
+	{
+		clients[i].id = i;
+		clients[i].first_page = i * region;
+		clients[i].region_pages = region;
+		clients[i].ops = &opsArea[i * config.ops_per_client];
+	}
+	getrusage(config.processes ? RUSAGE_CHILDREN : RUSAGE_SELF, &before);
+	bench_cpu_busy(&busy0, &total0);
+	start = target_now_ns();
+	for(i = 0; i < number; i++)
+	{
+		if(config.processes)
+		{
+			pids[i] = fork();
+			if(pids[i] == 0)
+			{
+				bench_client_run(&clients[i]);
+				_exit(0);
+			}
+		}
+		else
+		{
+			pthread_create(&threads[i], NULL, bench_client_run, &clients[i]);
+		}
+	}
+	for(i = 0; i < number; i++)
+	{
+		if(config.processes)
+		{
+			waitpid(pids[i], NULL, 0);
+		}
+		else
+		{
+			pthread_join(threads[i], NULL);
+		}
+	}
+	wall = target_now_ns() - start;
+	bench_cpu_busy(&busy1, &total1);
+	getrusage(config.processes ? RUSAGE_CHILDREN : RUSAGE_SELF, &after);
+
+	for(i = 0; i < number; i++)
+	{
+		totalOps += clients[i].ops_done;
+		totalPages += clients[i].pages_done;
+		lost     += clients[i].lost;
+		mixed    += clients[i].mixed;
+		corrupt  += clients[i].corrupt;
+		ioErrors += clients[i].io_errors;
+	}
+	seconds = wall / 1e9;
+	clientCpu = (after.ru_utime.tv_sec - before.ru_utime.tv_sec) + (after.ru_utime.tv_usec - before.ru_utime.tv_usec) / 1e6 +
+				(after.ru_stime.tv_sec - before.ru_stime.tv_sec) + (after.ru_stime.tv_usec - before.ru_stime.tv_usec) / 1e6;
+	driver = (config.driver == TARGET_MODEL) ? "model" : ((config.driver == TARGET_BLOCKING) ? "blocking" : "polling");
+	printf("%s,%s,%s,%u,%s,%u,%u-%u,%u,%.1f,%u,%.3f,%.1f,%.1f",
+		config.label, driver, config.processes ? "processes" : "threads", number,
+		workload_name(&config.workload, name, sizeof(name)), config.workload.read_pct,
+		config.workload.min_pages, config.workload.max_pages, config.workload.think_us, config.workload.rate,
+		totalOps, seconds, totalOps / seconds, (totalPages * (double)config.page_size) / 1024.0 / seconds);
+	bench_percentiles(clients, number, OP_READ);
+	bench_percentiles(clients, number, OP_WRITE);
+	printf(",%.1f,%.1f,%.1f,%u,%u,%u,%u\n",
+		100.0 * clientCpu / seconds,
+		(total1 > total0) ? 100.0 * (busy1 - busy0) / (total1 - total0) : 0.0,
+		totalOps ? 1e6 * ((busy1 - busy0) / (double)sysconf(_SC_CLK_TCK)) / totalOps : 0.0,
+		lost, mixed, corrupt, ioErrors);
+	fflush(stdout);
+	munmap(opsArea, opsBytes);
+	munmap(clients, number * sizeof(struct bench_client));
+	return 0;
+}
+
+/**
+* bench_order - Function to check that a read sees the write made before it on the same file
+* @rounds: Writes to check
+*
+* Returns the number of pages read back wrong or calls failed.
+*
+* Description: Every round writes a page on one CPU, returning as soon as the write
+* 				is queued, then moves to the next CPU and reads the page back through
+* 				the same open file. The non blocking driver takes the two requests on
+* 				different CPUs, so the read only sees the write if the driver keeps the
+* 				order of the requests of a file across CPUs.
+*/
+static int bench_order(unsigned int rounds)
+{
+	struct bench_client c;
+	struct eeprom_target target;
+	unsigned char *buf;
+	unsigned int round, page;
+	cpu_set_t cpus;
+	int numberOfCpus;
+
+	memset(&c, 0, sizeof(c));
+	numberOfCpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if(numberOfCpus < 1)
+	{
+		numberOfCpus = 1;
+	}
+	buf = malloc(config.page_size);
+	if(buf == NULL || target_open(&target, config.path, config.driver, config.model) < 0)
+	{
+		fprintf(stderr, "Can not open %s\n", config.path);
+		free(buf);
+		return 1;
+	}
+	target.poll_us = config.poll_us;
+	target.accept_only = 1;
+	for(round = 0; round < rounds; round++)
+	{
+		page = round % config.number_of_pages;
+		CPU_ZERO(&cpus);
+		CPU_SET(round % numberOfCpus, &cpus);
+		sched_setaffinity(0, sizeof(cpus), &cpus);
+		bench_fill_page(buf, c.id, page, round + 1);
+		if(bench_write(&target, buf, page, 1) < 0)
+		{
+			c.io_errors++;
+			continue;
+		}
+		CPU_ZERO(&cpus);
+		CPU_SET((round + 1) % numberOfCpus, &cpus);
+		sched_setaffinity(0, sizeof(cpus), &cpus);
+		memset(buf, 0, config.page_size);
+		if(bench_read(&target, buf, page, 1) < 0)
+		{
+			c.io_errors++;
+			continue;
+		}
+		bench_check_page(&c, buf, page, round + 1);
+	}
+	//Leave no queued write behind
+	target_ioctl(&target, 0, FLASHFLUSH);
+	target_close(&target);
+	free(buf);
+	printf("label,driver,cpus,rounds,lost,mixed,corrupt,io_errors\n");
+	printf("%s,%s,%d,%u,%u,%u,%u,%u\n", config.label,
+		(config.driver == TARGET_MODEL) ? "model" : (config.driver == TARGET_POLLING) ? "polling" : "blocking",
+		numberOfCpus, rounds, c.lost, c.mixed, c.corrupt, c.io_errors);
+	return c.lost + c.mixed + c.corrupt + c.io_errors;
+}
+
+/**
+* bench_usage - Function to print the command line
+*/
+static void bench_usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -d path   EEPROM device (default " DEVICE_PATH ")\n"
+		"  -l label  Label of the driver build in the output\n"
+		"  -m mode   blocking (Task1) or polling (Task2), found out if not given\n"
+		"  -M        Run against the software model instead of a device\n"
+		"  -b hz     Bus clock of the model (default %d)\n"
+		"  -w us     Page write cycle of the model (default %d)\n"
+		"  -c N      Run 1, 2, 4 ... N clients (default %d)\n"
+		"  -n ops    Timed operations per client (default %d)\n"
+		"  -r pct    Percent of reads (default %d)\n"
+		"  -s pages  Pages per operation, or min:max for sizes between the two (default %d)\n"
+		"  -D dist   Pages to use: uniform, seq, zipf[:theta] or hot[:pages_pct[:access_pct]] (default uniform)\n"
+		"  -t us     Mean think time after every operation, closed loop\n"
+		"  -R rate   Operations per second of every client, open loop with Poisson arrivals\n"
+		"  -u us     Poll interval of non blocking reads (default %d)\n"
+		"  -P        Clients are processes instead of threads\n"
+		"  -L        Serialize seek and transfer over all clients\n"
+		"  -a        Time non blocking writes until queued, not until on the chip\n"
+		"  -O        Check instead that a read sees the write before it on the same file, -n rounds moving between CPUs\n",
+		name, MODEL_BUS_HZ, MODEL_WRITE_CYCLE_US, DEFAULT_CLIENTS, DEFAULT_OPS, DEFAULT_READ_PCT, DEFAULT_PAGES, DEFAULT_POLL_US);
+}
+
+/**
+ * Main Function
+ */
+int main(int argc, char **argv)
+{
+	struct eeprom_target target;
+	pthread_mutexattr_t attr;
+	unsigned int number;
+	int retValue, option;
+
+	config.path = DEVICE_PATH;
+	config.label = "i2c_flash";
+	config.max_clients = DEFAULT_CLIENTS;
+	config.ops_per_client = DEFAULT_OPS;
+	config.poll_us = DEFAULT_POLL_US;
+	config.bus_hz = MODEL_BUS_HZ;
+	config.write_cycle_us = MODEL_WRITE_CYCLE_US;
+	workload_parse(&config.workload, "uniform");
+	config.workload.read_pct = DEFAULT_READ_PCT;
+	config.workload.min_pages = DEFAULT_PAGES;
+	config.workload.max_pages = DEFAULT_PAGES;
+	while((option = getopt(argc, argv, "d:l:m:Mb:w:c:n:r:s:D:t:R:u:PLaOh")) != -1)
+	{
+		switch(option)
+		{
+			case 'd': config.path = optarg; break;
+			case 'l': config.label = optarg; break;
+			case 'm': config.driver = (strcmp(optarg, "blocking") == 0) ? TARGET_BLOCKING : TARGET_POLLING; break;
+			case 'M': config.driver = TARGET_MODEL; break;
+			case 'b': config.bus_hz = atoi(optarg); break;
+			case 'w': config.write_cycle_us = atoi(optarg); break;
+			case 'c': config.max_clients = atoi(optarg); break;
+			case 'n': config.ops_per_client = atoi(optarg); break;
+			case 'r': config.workload.read_pct = atoi(optarg); break;
+			case 's':
+				if(sscanf(optarg, "%u:%u", &config.workload.min_pages, &config.workload.max_pages) < 2)
+				{
+					config.workload.max_pages = config.workload.min_pages;
+				}
+				break;
+			case 'D':
+				if(workload_parse(&config.workload, optarg) < 0)
+				{
+					bench_usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 't': config.workload.think_us = atoi(optarg); break;
+			case 'R': config.workload.rate = atof(optarg); break;
+			case 'u': config.poll_us = atoi(optarg); break;
+			case 'P': config.processes = 1; break;
+			case 'L': config.serialize = 1; break;
+			case 'a': config.accept_only = 1; break;
+			case 'O': config.order = 1; break;
+			default: bench_usage(argv[0]); return 1;
+		}
+	}
+	if(config.max_clients < 1 || config.max_clients > 255 || config.workload.min_pages < 1 ||
+			config.workload.max_pages < config.workload.min_pages || config.workload.read_pct > 100)
+	{
+		bench_usage(argv[0]);
+		return 1;
+	}
+	if(config.driver == TARGET_MODEL)
+	{
+		//The model lives in this process, clients in other processes would each get a copy
+		if(config.processes)
+		{
+			fprintf(stderr, "-P can not be used with the model\n");
+			return 1;
+		}
+		config.model = model_create(MODEL_PAGE_SIZE, MODEL_NUMBER_OF_PAGES, MODEL_ADDRESS_BYTES, config.bus_hz, config.write_cycle_us, 1);
+		if(config.model == NULL)
+		{
+			fprintf(stderr, "Can not create the model\n");
+			return 1;
+		}
+	}
+	else if(config.driver == 0)
+	{
+		retValue = target_detect(config.path);
+		config.driver = (retValue < 0) ? TARGET_BLOCKING : retValue;
+	}
+	retValue = target_open(&target, config.path, config.driver, config.model);
+	if(retValue < 0)
+	{
+		fprintf(stderr, "%s: %s\n", config.path, strerror(-retValue));
+		return 1;
+	}
+	config.page_size = target.page_size;
+	config.number_of_pages = target.number_of_pages;
+	target_close(&target);
+	if(config.page_size < TAG_SIZE)
+	{
+		fprintf(stderr, "Pages of %u bytes can not hold the check tag\n", config.page_size);
+		return 1;
+	}
+	if(config.order)
+	{
+		retValue = bench_order(config.ops_per_client);
+		model_destroy(config.model);
+		return (retValue != 0) ? 1 : 0;
+	}
+
+	bench_lock = mmap(NULL, sizeof(pthread_mutex_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if(bench_lock == MAP_FAILED)
+	{
+		perror("mmap");
+		return 1;
+	}
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutex_init(bench_lock, &attr);
+
+	printf("label,driver,clients_are,clients,distribution,read_pct,pages_per_op,think_us,rate_per_client,ops,seconds,ops_per_s,kib_per_s,"
+		"rd_p50_us,rd_p90_us,rd_p99_us,rd_p999_us,rd_max_us,wr_p50_us,wr_p90_us,wr_p99_us,wr_p999_us,wr_max_us,"
+		"client_cpu_pct,system_cpu_pct,system_cpu_us_per_op,lost,mixed,corrupt,io_errors\n");
+	for(number = 1; ; number *= 2)
+	{
+		if(number > config.max_clients)
+		{
+			number = config.max_clients;
+		}
+		bench_run(number);
+		if(number == config.max_clients)
+		{
+			break;
+		}
+	}
+	model_destroy(config.model);
+	return 0;
+}
@@ -0,0 +1,167 @@
+/******************************************************************************
+ *
+ * File Name: model.c
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: Software model of an I2C EEPROM and its bus. A read is one
+ * 				transfer of the address and all its pages. A write is one
+ * 				transfer per page, and the chip does not answer until the page
+ * 				write cycle after it has ended. Transfers of all callers share
+ * 				the one bus. Times are in nanoseconds of whatever clock the
+ * 				caller uses, so the same model serves real time runs and
+ * 				deterministic runs on a virtual clock.
+ *
+ *****************************************************************************/
+
+/**
+ *Include Library Headers
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "model.h"
+
+/**
+* model_transfer_ns - Function to work out the bus time of a transfer
+* @model: Model
+* @bytes: Bytes on the bus, slave addresses included
+*
+* Returns nanoseconds.
+*/
+static uint64_t model_transfer_ns(struct eeprom_model *model, unsigned int bytes)
+{
+	return ((uint64_t)bytes * 9 * 1000000000ULL) / model->bus_hz;
+}
+
+/**
+* model_create - Function to create a model of an erased chip
+* @page_size: Bytes per page
+* @number_of_pages: Pages of the chip
+* @address_bytes: Width of the memory address
+* @bus_hz: I2C clock
+* @write_cycle_us: Page write cycle of the chip
+* @real_time: Callers sleep until the end of each transfer
+*
+* Returns the model, or NULL.
+*/
+struct eeprom_model *model_create(unsigned int page_size, unsigned int number_of_pages, unsigned int address_bytes,
+		unsigned int bus_hz, unsigned int write_cycle_us, int real_time)
+{
+	struct eeprom_model *model = calloc(1, sizeof(struct eeprom_model));
+
+	if(model == NULL || bus_hz == 0)
+	{
+		free(model);
+		return NULL;
+	}
+	model->page_size       = page_size;
+	model->number_of_pages = number_of_pages;
+	model->address_bytes   = address_bytes;
+	model->bus_hz          = bus_hz;
+	model->write_cycle_us  = write_cycle_us;
+	model->real_time       = real_time;
+	model->data = malloc((size_t)page_size * number_of_pages);
+	if(model->data == NULL)
+	{
+		free(model);
+		return NULL;
+	}
+	memset(model->data, 0xFF, (size_t)page_size * number_of_pages);
+	pthread_mutex_init(&model->lock, NULL);
+	return model;
+}
+
+/**
+* model_read - Function to read pages from the model
+* @model: Model
+* @start_ns: When the read is issued
+* @page: First page, the read wraps at the end of the chip
+* @count: Number of pages
+* @buf: Data Buffer, may be NULL
+*
+* Returns when the read finishes.
+*
+* Description: The read waits for the bus and for the write cycle of the page
+* 				written last, then moves all pages in one transfer.
+*/
+uint64_t model_read(struct eeprom_model *model, uint64_t start_ns, unsigned int page, unsigned int count, unsigned char *buf)
+{
+	uint64_t begin, end;
+	unsigned int i;
+
+	pthread_mutex_lock(&model->lock);
+	begin = start_ns;
+	if(begin < model->bus_free_ns)
+	{
+		begin = model->bus_free_ns;
+	}
+	if(begin < model->chip_ready_ns)
+	{
+		begin = model->chip_ready_ns;
+	}
+	end = begin + model_transfer_ns(model, 2 + model->address_bytes + (count * model->page_size));
+	model->bus_free_ns = end;
+	for(i = 0; buf != NULL && i < count; i++)
+	{
+		memcpy(&buf[i * model->page_size], &model->data[((page + i) % model->number_of_pages) * model->page_size], model->page_size);
+	}
+	model->reads += count;
+	pthread_mutex_unlock(&model->lock);
+	return end;
+}
+
+/**
+* model_write - Function to write pages to the model
+* @model: Model
+* @start_ns: When the write is issued
+* @page: First page, the write wraps at the end of the chip
+* @count: Number of pages
+* @buf: Data Buffer, may be NULL
+*
+* Returns when the transfer of the last page finishes, its write cycle runs on.
+*/
+uint64_t model_write(struct eeprom_model *model, uint64_t start_ns, unsigned int page, unsigned int count, const unsigned char *buf)
+{
+	uint64_t begin = start_ns, end = start_ns;
+	unsigned int i;
+
+	pthread_mutex_lock(&model->lock);
+	for(i = 0; i < count; i++)
+	{
+		if(begin < model->bus_free_ns)
+		{
+			begin = model->bus_free_ns;
+		}
+		if(begin < model->chip_ready_ns)
+		{
+			begin = model->chip_ready_ns;
+		}
+		end = begin + model_transfer_ns(model, 1 + model->address_bytes + model->page_size);
+		model->bus_free_ns = end;
+		model->chip_ready_ns = end + ((uint64_t)model->write_cycle_us * 1000);
+		if(buf != NULL)
+		{
+			memcpy(&model->data[((page + i) % model->number_of_pages) * model->page_size], &buf[i * model->page_size], model->page_size);
+		}
+		begin = end;
+	}
+	model->writes += count;
+	pthread_mutex_unlock(&model->lock);
+	return end;
+}
+
+/**
+* model_destroy - Function to free a model
+* @model: Model
+*
+* Returns void.
+*/
+void model_destroy(struct eeprom_model *model)
+{
+	if(model != NULL)
+	{
+		pthread_mutex_destroy(&model->lock);
+		free(model->data);
+		free(model);
+	}
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+ *
+ * File Name: model.h
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: Software model of an I2C EEPROM and its bus. Keeps the page
+ * 				data in RAM and works out when every transfer would finish on
+ * 				real hardware, from the bus clock and the page write cycle.
+ *
+ *****************************************************************************/
+#ifndef EEPROM_MODEL_H
+#define EEPROM_MODEL_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * Define constants using the macro
+ */
+#define MODEL_PAGE_SIZE			64
+#define MODEL_NUMBER_OF_PAGES	512
+#define MODEL_ADDRESS_BYTES		2
+#define MODEL_BUS_HZ			100000
+#define MODEL_WRITE_CYCLE_US	5000
+
+/**
+ *  State of the modelled chip and bus
+ */
+struct eeprom_model
+{
+	unsigned int page_size;
+	unsigned int number_of_pages;
+	unsigned int address_bytes;
+	unsigned int bus_hz;			/* I2C clock, 9 clocks per byte */
+	unsigned int write_cycle_us;	/* Page write cycle of the chip */
+	int real_time;					/* Callers sleep until the modelled end of each transfer */
+	uint64_t bus_free_ns;			/* End of the last transfer on the bus */
+	uint64_t chip_ready_ns;			/* End of the last page write cycle */
+	uint64_t reads;					/* Pages read */
+	uint64_t writes;				/* Pages written */
+	unsigned char *data;			/* Chip contents */
+	pthread_mutex_t lock;
+};
+
+struct eeprom_model *model_create(unsigned int page_size, unsigned int number_of_pages, unsigned int address_bytes,
+		unsigned int bus_hz, unsigned int write_cycle_us, int real_time);
+uint64_t model_read(struct eeprom_model *model, uint64_t start_ns, unsigned int page, unsigned int count, unsigned char *buf);
+uint64_t model_write(struct eeprom_model *model, uint64_t start_ns, unsigned int page, unsigned int count, const unsigned char *buf);
+void model_destroy(struct eeprom_model *model);
+
+#endif
@@ -0,0 +1,646 @@
+/******************************************************************************
+ *
+ * File Name: replay.c
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: Replays a trace taken with the capture library against the
+ * 				Task1 or Task2 driver or against the software model, at the
+ * 				recorded speed or as fast as the target goes. Every stream of
+ * 				the trace is replayed by its own thread, in its recorded order.
+ * 				On the model the replay can also run on a virtual clock, which
+ * 				gives the same result on every run. Prints the recorded and the
+ * 				replayed latencies side by side.
+ *
+ *****************************************************************************/
+
+/**
+ *Include Library Headers
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "target.h"
+#include "trace.h"
+
+/**
+ * Define constants using the macro
+ */
+#define REPLAY_MAX_STREAMS	256
+#define REPLAY_TICKETS		64
+
+/**
+ *  One record and what its replay gave
+ */
+struct replay_op
+{
+	struct trace_record rec;
+	uint64_t latency_ns;			/* Replayed latency */
+	int32_t result;					/* Replayed result */
+	int done;						/* Replayed, skipped ones stay 0 */
+};
+
+/**
+ *  State of one stream
+ */
+struct replay_stream
+{
+	uint16_t id;
+	pthread_t thread;
+	struct eeprom_target target;
+	int opened;
+	unsigned int position;			/* Page pointer the target should have */
+	uint64_t ready_ns;				/* Virtual clock, end of the last op */
+	int32_t recorded[REPLAY_TICKETS];	/* Tickets of the trace ... */
+	int32_t replayed[REPLAY_TICKETS];	/* ... and of the replay, same slot */
+	unsigned int next_ticket;
+};
+
+/**
+ *  Settings of the run, from the command line
+ */
+struct replay_config
+{
+	const char *path;
+	const char *csv;
+	int kind;						/* TARGET_BLOCKING, TARGET_POLLING or TARGET_MODEL */
+	int max_speed;					/* Ignore the recorded issue times */
+	int virtual_time;				/* Model only, do not sleep */
+	unsigned int poll_us;
+	unsigned int bus_hz;
+	unsigned int write_cycle_us;
+};
+
+static struct replay_config config;
+static struct replay_op *ops;
+static size_t number_of_ops;
+static struct replay_stream streams[REPLAY_MAX_STREAMS];
+static unsigned int number_of_streams;
+static struct eeprom_model *model;
+static unsigned int page_size, number_of_pages;
+static uint64_t replay_epoch;
+
+/**
+* replay_load - Function to read a trace into memory
+* @path: Trace file
+*
+* Returns 0, or -1.
+*/
+static int replay_load(const char *path)
+{
+	struct trace_header header;
+	struct trace_record rec;
+	size_t allocated = 0;
+	FILE *f = fopen(path, "rb");
+
+	if(f == NULL)
+	{
+		perror(path);
+		return -1;
+	}
+	if(fread(&header, sizeof(header), 1, f) != 1 || header.magic != TRACE_MAGIC ||
+			header.version != TRACE_VERSION || header.record_size != sizeof(struct trace_record))
+	{
+		fprintf(stderr, "%s is not a trace of this version\n", path);
+		fclose(f);
+		return -1;
+	}
+	page_size = header.page_size ? header.page_size : MODEL_PAGE_SIZE;
+	number_of_pages = header.number_of_pages ? header.number_of_pages : MODEL_NUMBER_OF_PAGES;
+	while(fread(&rec, sizeof(rec), 1, f) == 1)
+	{
+		if(number_of_ops == allocated)
+		{
+			allocated = allocated ? allocated * 2 : 1024;
+			ops = realloc(ops, allocated * sizeof(struct replay_op));
+			if(ops == NULL)
+			{
+				fclose(f);
+				return -1;
+			}
+		}
+		memset(&ops[number_of_ops], 0, sizeof(struct replay_op));
+		ops[number_of_ops++].rec = rec;
+	}
+	fclose(f);
+	return 0;
+}
+
+/**
+* replay_compare_start - Function to order records by issue time for qsort
+*/
+static int replay_compare_start(const void *a, const void *b)
+{
+	const struct trace_record *x = &((const struct replay_op *)a)->rec, *y = &((const struct replay_op *)b)->rec;
+
+	if(x->start_ns != y->start_ns)
+	{
+		return (x->start_ns > y->start_ns) - (x->start_ns < y->start_ns);
+	}
+	return (x->stream > y->stream) - (x->stream < y->stream);
+}
+
+/**
+* replay_stream_of - Function to find the stream of a record
+* @id: Stream number of the trace
+*
+* Returns the stream, or NULL if there are too many.
+*/
+static struct replay_stream *replay_stream_of(uint16_t id)
+{
+	unsigned int i;
+
+	for(i = 0; i < number_of_streams; i++)
+	{
+		if(streams[i].id == id)
+		{
+			return &streams[i];
+		}
+	}
+	if(number_of_streams == REPLAY_MAX_STREAMS)
+	{
+		return NULL;
+	}
+	streams[number_of_streams].id = id;
+	return &streams[number_of_streams++];
+}
+
+/**
+* replay_ticket - Functions to map the tickets of the trace to the replay
+*/
+static void replay_ticket_add(struct replay_stream *s, int32_t recorded, int32_t replayed)
+{
+	s->recorded[s->next_ticket % REPLAY_TICKETS] = recorded;
+	s->replayed[s->next_ticket % REPLAY_TICKETS] = replayed;
+	s->next_ticket++;
+}
+
+static int32_t replay_ticket_find(struct replay_stream *s, int32_t recorded)
+{
+	unsigned int i;
+
+	for(i = 0; i < REPLAY_TICKETS; i++)
+	{
+		if(s->recorded[i] == recorded)
+		{
+			return s->replayed[i];
+		}
+	}
+	return recorded;
+}
+
+/**
+* replay_ioctl_known - Function to check whether an ioctl can be replayed
+* @cmd: Command
+*
+* Returns 1 for commands that take a value, 0 for those that pass a pointer.
+*/
+static int replay_ioctl_known(uint32_t cmd)
+{
+	switch(cmd)
+	{
+		case FLASHGETS:
+		case FLASHGETP:
+		case FLASHSETP:
+		case FLASHERASE:
+		case FLASHFLUSH:
+		case FLASHWAIT:
+		case FLASHCANCEL:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/**
+* replay_one - Function to replay one record on a device or the real time model
+* @s: Stream
+* @op: Record
+* @buf: Data Buffer, large enough for the whole chip
+*
+* Returns void, the result and latency are kept in the record.
+*
+* Description: The page pointer is only set when the target would not be on the
+* 				recorded page anyway. Ioctls that pass a pointer are not replayed.
+*/
+static void replay_one(struct replay_stream *s, struct replay_op *op, unsigned char *buf)
+{
+	struct trace_record *r = &op->rec;
+	unsigned long arg = r->count;
+	uint64_t start;
+	long retValue = 0;
+
+	if(r->op != TRACE_OPEN && !s->opened)
+	{
+		return;
+	}
+	if((r->op == TRACE_READ || r->op == TRACE_WRITE) && r->count > number_of_pages)
+	{
+		return;
+	}
+	//The page pointer of the blocking driver is shared by all streams
+	if((r->op == TRACE_READ || r->op == TRACE_WRITE) && (r->page != s->position || config.kind == TARGET_BLOCKING))
+	{
+		target_ioctl(&s->target, r->page, FLASHSETP);
+		s->position = r->page;
+	}
+	if(r->op == TRACE_IOCTL && !replay_ioctl_known(r->cmd))
+	{
+		return;
+	}
+	if(r->op == TRACE_IOCTL && (r->cmd == FLASHWAIT || r->cmd == FLASHCANCEL))
+	{
+		arg = replay_ticket_find(s, r->count);
+	}
+	start = target_now_ns();
+	switch(r->op)
+	{
+		case TRACE_OPEN:
+			retValue = target_open(&s->target, config.path, config.kind, model);
+			s->target.poll_us = config.poll_us;
+			s->target.accept_only = 1;
+			s->opened = (retValue == 0);
+			s->position = 0;
+			break;
+		case TRACE_CLOSE:
+			target_close(&s->target);
+			s->opened = 0;
+			break;
+		case TRACE_READ:
+			retValue = target_read(&s->target, buf, r->count);
+			s->position = (s->position + r->count) % number_of_pages;
+			break;
+		case TRACE_WRITE:
+			retValue = target_write(&s->target, buf, r->count);
+			s->position = (s->position + r->count) % number_of_pages;
+			if(r->result > 0 && retValue >= 0)
+			{
+				replay_ticket_add(s, r->result, retValue);
+			}
+			break;
+		case TRACE_IOCTL:
+			retValue = target_ioctl(&s->target, arg, r->cmd);
+			if(r->cmd == FLASHSETP && retValue >= 0)
+			{
+				s->position = arg;
+			}
+			break;
+	}
+	op->latency_ns = target_now_ns() - start;
+	op->result = retValue;
+	op->done = 1;
+}
+
+/**
+* replay_stream_run - Function run by the thread of every stream
+* @arg: Stream
+*
+* Returns NULL.
+*/
+static void *replay_stream_run(void *arg)
+{
+	struct replay_stream *s = arg;
+	unsigned char *buf;
+	struct timespec ts;
+	uint64_t when;
+	size_t i;
+
+	buf = malloc((size_t)page_size * number_of_pages);
+	if(buf == NULL)
+	{
+		return NULL;
+	}
+	memset(buf, 0xA5, (size_t)page_size * number_of_pages);
+	for(i = 0; i < number_of_ops; i++)
+	{
+		if(ops[i].rec.stream != s->id)
+		{
+			continue;
+		}
+		if(!config.max_speed)
+		{
+			when = replay_epoch + ops[i].rec.start_ns;
+			ts.tv_sec  = when / 1000000000ULL;
+			ts.tv_nsec = when % 1000000000ULL;
+			while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+		}
+		replay_one(s, &ops[i], buf);
+	}
+	if(s->opened)
+	{
+		target_close(&s->target);
+	}
+	free(buf);
+	return NULL;
+}
+
+/**
+* replay_next_of - Function to find the next record of a stream
+* @s: Stream
+* @from: First index to look at
+*
+* Returns the index, or number_of_ops if the stream is done.
+*/
+static size_t replay_next_of(struct replay_stream *s, size_t from)
+{
+	while(from < number_of_ops && ops[from].rec.stream != s->id)
+	{
+		from++;
+	}
+	return from;
+}
+
+/**
+* replay_virtual - Function to replay the whole trace on the model's clock
+*
+* Returns the virtual time the replay took, in nanoseconds.
+*
+* Description: A stream issues its next op when its last one is done, or at the
+* 				recorded time if that is later. Of all streams the one that
+* 				issues first goes next, ties go to the stream seen first in the
+* 				trace, so the model sees the same sequence on every run.
+*/
+static uint64_t replay_virtual(void)
+{
+	size_t next[REPLAY_MAX_STREAMS], i;
+	struct trace_record *r;
+	uint64_t issue, best, end, last = 0;
+	unsigned int j, page, chosen;
+
+	for(j = 0; j < number_of_streams; j++)
+	{
+		next[j] = replay_next_of(&streams[j], 0);
+	}
+	for(;;)
+	{
+		chosen = number_of_streams;
+		best = UINT64_MAX;
+		for(j = 0; j < number_of_streams; j++)
+		{
+			if(next[j] == number_of_ops)
+			{
+				continue;
+			}
+			issue = streams[j].ready_ns;
+			if(!config.max_speed && issue < ops[next[j]].rec.start_ns)
+			{
+				issue = ops[next[j]].rec.start_ns;
+			}
+			if(issue < best)
+			{
+				best = issue;
+				chosen = j;
+			}
+		}
+		if(chosen == number_of_streams)
+		{
+			break;
+		}
+		i = next[chosen];
+		r = &ops[i].rec;
+		issue = best;
+		end = issue;
+		switch(r->op)
+		{
+			case TRACE_READ:
+				end = model_read(model, issue, r->page, r->count, NULL);
+				break;
+			case TRACE_WRITE:
+				end = model_write(model, issue, r->page, r->count, NULL);
+				break;
+			case TRACE_IOCTL:
+				if(r->cmd == FLASHERASE)
+				{
+					for(page = 0; page < number_of_pages; page++)
+					{
+						end = model_write(model, issue, page, 1, NULL);
+					}
+				}
+				break;
+		}
+		streams[chosen].ready_ns = end;
+		ops[i].latency_ns = end - issue;
+		ops[i].result = (r->op == TRACE_WRITE) ? 0 : r->result;
+		ops[i].done = (r->op != TRACE_IOCTL || replay_ioctl_known(r->cmd));
+		next[chosen] = replay_next_of(&streams[chosen], i + 1);
+		if(end > last)
+		{
+			last = end;
+		}
+	}
+	return last;
+}
+
+/**
+* replay_compare_ns - Function to order latencies for qsort
+*/
+static int replay_compare_ns(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+* replay_report - Function to print the latencies of one op type
+* @name: Name in the output
+* @type: TRACE_READ, TRACE_WRITE or TRACE_IOCTL
+*
+* Returns void, prints one CSV line.
+*/
+static void replay_report(const char *name, uint8_t type)
+{
+	uint64_t *recorded, *replayed;
+	size_t n = 0, i;
+	unsigned int failed = 0;
+
+	recorded = malloc(number_of_ops * sizeof(uint64_t));
+	replayed = malloc(number_of_ops * sizeof(uint64_t));
+	for(i = 0; recorded != NULL && replayed != NULL && i < number_of_ops; i++)
+	{
+		if(ops[i].rec.op != type || !ops[i].done)
+		{
+			continue;
+		}
+		recorded[n] = ops[i].rec.latency_ns;
+		replayed[n] = ops[i].latency_ns;
+		n++;
+		if(ops[i].result < 0 && ops[i].rec.result >= 0)
+		{
+			failed++;
+		}
+	}
+	if(n == 0)
+	{
+		printf("%s,0,,,,,,,0\n", name);
+	}
+	else
+	{
+		qsort(recorded, n, sizeof(uint64_t), replay_compare_ns);
+		qsort(replayed, n, sizeof(uint64_t), replay_compare_ns);
+		printf("%s,%zu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%u\n", name, n,
+			recorded[n / 2] / 1000.0, recorded[(size_t)(0.99 * (n - 1))] / 1000.0, recorded[n - 1] / 1000.0,
+			replayed[n / 2] / 1000.0, replayed[(size_t)(0.99 * (n - 1))] / 1000.0, replayed[n - 1] / 1000.0, failed);
+	}
+	free(recorded);
+	free(replayed);
+}
+
+/**
+* replay_write_csv - Function to write every replayed record
+* @path: CSV file
+*
+* Returns 0, or -1.
+*/
+static int replay_write_csv(const char *path)
+{
+	FILE *f = fopen(path, "w");
+	size_t i;
+
+	if(f == NULL)
+	{
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "stream,op,page,count,cmd,start_us,recorded_us,replayed_us,recorded_result,replayed_result\n");
+	for(i = 0; i < number_of_ops; i++)
+	{
+		if(!ops[i].done)
+		{
+			continue;
+		}
+		fprintf(f, "%u,%c,%u,%u,%u,%.1f,%.1f,%.1f,%d,%d\n", ops[i].rec.stream, ops[i].rec.op, ops[i].rec.page,
+			ops[i].rec.count, ops[i].rec.cmd, ops[i].rec.start_ns / 1000.0, ops[i].rec.latency_ns / 1000.0,
+			ops[i].latency_ns / 1000.0, ops[i].rec.result, ops[i].result);
+	}
+	fclose(f);
+	return 0;
+}
+
+/**
+* replay_usage - Function to print the command line
+*/
+static void replay_usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options] trace\n"
+		"  -d path   EEPROM device (default " DEVICE_PATH ")\n"
+		"  -m mode   blocking (Task1) or polling (Task2), found out if not given\n"
+		"  -M        Replay against the software model instead of a device\n"
+		"  -b hz     Bus clock of the model (default %d)\n"
+		"  -w us     Page write cycle of the model (default %d)\n"
+		"  -v        Run the model on a virtual clock, the result is the same every run\n"
+		"  -x        Issue every op as soon as its stream is free, not at its recorded time\n"
+		"  -u us     Poll interval of non blocking reads (default %d)\n"
+		"  -o file   Write every replayed record to a CSV file\n",
+		name, MODEL_BUS_HZ, MODEL_WRITE_CYCLE_US, DEFAULT_POLL_US);
+}
+
+/**
+ * Main Function
+ */
+int main(int argc, char **argv)
+{
+	uint64_t recorded = 0, elapsed;
+	unsigned int i;
+	int option;
+
+	config.path = DEVICE_PATH;
+	config.poll_us = DEFAULT_POLL_US;
+	config.bus_hz = MODEL_BUS_HZ;
+	config.write_cycle_us = MODEL_WRITE_CYCLE_US;
+	while((option = getopt(argc, argv, "d:m:Mb:w:vxu:o:h")) != -1)
+	{
+		switch(option)
+		{
+			case 'd': config.path = optarg; break;
+			case 'm': config.kind = (strcmp(optarg, "blocking") == 0) ? TARGET_BLOCKING : TARGET_POLLING; break;
+			case 'M': config.kind = TARGET_MODEL; break;
+			case 'b': config.bus_hz = atoi(optarg); break;
+			case 'w': config.write_cycle_us = atoi(optarg); break;
+			case 'v': config.virtual_time = 1; break;
+			case 'x': config.max_speed = 1; break;
+			case 'u': config.poll_us = atoi(optarg); break;
+			case 'o': config.csv = optarg; break;
+			default: replay_usage(argv[0]); return 1;
+		}
+	}
+	if(optind != argc - 1 || (config.virtual_time && config.kind != TARGET_MODEL))
+	{
+		replay_usage(argv[0]);
+		return 1;
+	}
+	if(replay_load(argv[optind]) < 0)
+	{
+		return 1;
+	}
+	qsort(ops, number_of_ops, sizeof(struct replay_op), replay_compare_start);
+	for(i = 0; i < number_of_ops; i++)
+	{
+		if(replay_stream_of(ops[i].rec.stream) == NULL)
+		{
+			fprintf(stderr, "More than %d streams in the trace\n", REPLAY_MAX_STREAMS);
+			return 1;
+		}
+		if(ops[i].rec.start_ns + ops[i].rec.latency_ns > recorded)
+		{
+			recorded = ops[i].rec.start_ns + ops[i].rec.latency_ns;
+		}
+	}
+	if(config.kind == TARGET_MODEL)
+	{
+		model = model_create(page_size, number_of_pages, MODEL_ADDRESS_BYTES, config.bus_hz, config.write_cycle_us, !config.virtual_time);
+		if(model == NULL)
+		{
+			fprintf(stderr, "Can not create the model\n");
+			return 1;
+		}
+	}
+	else if(config.kind == 0)
+	{
+		config.kind = target_detect(config.path);
+		if(config.kind < 0)
+		{
+			fprintf(stderr, "%s: %s\n", config.path, strerror(-config.kind));
+			return 1;
+		}
+	}
+
+	if(config.virtual_time)
+	{
+		elapsed = replay_virtual();
+	}
+	else
+	{
+		replay_epoch = target_now_ns();
+		for(i = 0; i < number_of_streams; i++)
+		{
+			pthread_create(&streams[i].thread, NULL, replay_stream_run, &streams[i]);
+		}
+		for(i = 0; i < number_of_streams; i++)
+		{
+			pthread_join(streams[i].thread, NULL);
+		}
+		elapsed = target_now_ns() - replay_epoch;
+	}
+
+	printf("target,%s,speed,%s,clock,%s,records,%zu,streams,%u,recorded_s,%.3f,replayed_s,%.3f\n",
+		(config.kind == TARGET_MODEL) ? "model" : ((config.kind == TARGET_BLOCKING) ? "blocking" : "polling"),
+		config.max_speed ? "max" : "recorded", config.virtual_time ? "virtual" : "real",
+		number_of_ops, number_of_streams, recorded / 1e9, elapsed / 1e9);
+	printf("op,count,rec_p50_us,rec_p99_us,rec_max_us,rep_p50_us,rep_p99_us,rep_max_us,failed\n");
+	replay_report("read", TRACE_READ);
+	replay_report("write", TRACE_WRITE);
+	replay_report("ioctl", TRACE_IOCTL);
+	if(config.csv != NULL && replay_write_csv(config.csv) < 0)
+	{
+		return 1;
+	}
+	model_destroy(model);
+	return 0;
+}
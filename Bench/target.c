@@ -0,0 +1,279 @@
+/******************************************************************************
+ *
+ * File Name: target.c
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: One way for the benchmark tools to use an EEPROM. Hides the
+ * 				difference between the blocking Task1 driver, the polling Task2
+ * 				driver and the software model, which is used in real time here.
+ *
+ *****************************************************************************/
+
+/**
+ *Include Library Headers
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "target.h"
+
+/**
+* target_now_ns - Function to read the monotonic clock
+*
+* Returns nanoseconds.
+*/
+uint64_t target_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/**
+* target_sleep_until - Function to sleep until a given time
+* @end: Monotonic time in nanoseconds
+*
+* Returns void.
+*/
+void target_sleep_until(uint64_t end)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = end / 1000000000ULL;
+	ts.tv_nsec = end % 1000000000ULL;
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+/**
+* target_detect - Function to find out which driver serves a device
+* @path: Device file
+*
+* Returns TARGET_BLOCKING or TARGET_POLLING, or negative errno.
+*/
+int target_detect(const char *path)
+{
+	struct i2c_EEPROM_status status;
+	int fd, kind;
+
+	fd = open(path, O_RDWR);
+	if(fd < 0)
+	{
+		return -errno;
+	}
+	//Only the non blocking driver fills in FLASHSTATUS
+	memset(&status, 0xFF, sizeof(status));
+	kind = (eeprom_ioctl(fd, &status, FLASHSTATUS) >= 0 && status.works_done != 0xFFFFFFFF) ? TARGET_POLLING : TARGET_BLOCKING;
+	close(fd);
+	return kind;
+}
+
+/**
+* target_open - Function to open a device or attach to a model
+* @target: Target to set up
+* @path: Device file, unused for the model
+* @kind: TARGET_BLOCKING, TARGET_POLLING, TARGET_MODEL, or 0 to find out
+* @model: Model for TARGET_MODEL
+*
+* Returns 0, or negative errno.
+*/
+int target_open(struct eeprom_target *target, const char *path, int kind, struct eeprom_model *model)
+{
+	struct i2c_EEPROM_geometry geometry;
+
+	memset(target, 0, sizeof(struct eeprom_target));
+	target->fd = -1;
+	target->poll_us = DEFAULT_POLL_US;
+	if(kind == TARGET_MODEL)
+	{
+		if(model == NULL)
+		{
+			return -EINVAL;
+		}
+		target->kind = TARGET_MODEL;
+		target->model = model;
+		target->page_size = model->page_size;
+		target->number_of_pages = model->number_of_pages;
+		return 0;
+	}
+	if(kind == 0)
+	{
+		kind = target_detect(path);
+		if(kind < 0)
+		{
+			return kind;
+		}
+	}
+	target->kind = kind;
+	target->fd = open(path, O_RDWR);
+	if(target->fd < 0)
+	{
+		return -errno;
+	}
+	target->page_size = MODEL_PAGE_SIZE;
+	target->number_of_pages = MODEL_NUMBER_OF_PAGES;
+	if(eeprom_ioctl(target->fd, &geometry, FLASHGETG) >= 0)
+	{
+		target->page_size = geometry.page_size;
+		target->number_of_pages = geometry.number_of_pages;
+	}
+	return 0;
+}
+
+/**
+* target_read - Function to read pages at the page pointer
+* @target: Target
+* @buf: Data Buffer
+* @count: Number of pages
+*
+* Returns 0, or negative errno.
+*
+* Description: The blocking driver returns the data from read(). The non blocking
+* 				driver queues the read on the first call and returns -1 with EPERM
+* 				until a later call hands the data over.
+*/
+int target_read(struct eeprom_target *target, unsigned char *buf, unsigned int count)
+{
+	uint64_t end;
+	int retValue;
+
+	if(target->kind == TARGET_MODEL)
+	{
+		end = model_read(target->model, target_now_ns(), target->position, count, buf);
+		target->position = (target->position + count) % target->number_of_pages;
+		if(target->model->real_time)
+		{
+			target_sleep_until(end);
+		}
+		return 0;
+	}
+	retValue = read(target->fd, buf, count);
+	while(target->kind == TARGET_POLLING && retValue == -1 && errno == EPERM)
+	{
+		if(target->poll_us)
+		{
+			usleep(target->poll_us);
+		}
+		retValue = read(target->fd, buf, count);
+	}
+	return (retValue < 0) ? -errno : 0;
+}
+
+/**
+* target_write - Function to write pages at the page pointer
+* @target: Target
+* @buf: Data Buffer
+* @count: Number of pages
+*
+* Returns the ticket of a queued write, 0 if it is done, or negative errno.
+*
+* Description: A write to the non blocking driver is done when its ticket is,
+* 				unless accept_only is set, then the caller gets the ticket.
+*/
+int target_write(struct eeprom_target *target, const unsigned char *buf, unsigned int count)
+{
+	uint64_t end;
+	int retValue;
+
+	if(target->kind == TARGET_MODEL)
+	{
+		end = model_write(target->model, target_now_ns(), target->position, count, buf);
+		target->position = (target->position + count) % target->number_of_pages;
+		if(target->model->real_time)
+		{
+			target_sleep_until(end);
+		}
+		return 0;
+	}
+	retValue = write(target->fd, buf, count);
+	if(retValue < 0)
+	{
+		return -errno;
+	}
+	if(target->kind == TARGET_POLLING && !target->accept_only && retValue > 0)
+	{
+		//A cached write (0) has no ticket, it counts as done once accepted
+		if(eeprom_ioctl(target->fd, retValue, FLASHWAIT) < 0)
+		{
+			return -errno;
+		}
+		retValue = 0;
+	}
+	return retValue;
+}
+
+/**
+* target_ioctl - Function to send a command
+* @target: Target
+* @arg: Argument, value or pointer as the command wants it
+* @cmd: Command
+*
+* Returns the result of the command, or negative errno.
+*
+* Description: The model knows the page pointer and erase, every other command
+* 				succeeds on it without doing anything.
+*/
+long target_ioctl(struct eeprom_target *target, unsigned long arg, unsigned int cmd)
+{
+	unsigned char *blank;
+	uint64_t end = 0;
+	unsigned int page;
+	long retValue;
+
+	if(target->kind != TARGET_MODEL)
+	{
+		retValue = eeprom_ioctl(target->fd, arg, cmd);
+		return (retValue < 0) ? -errno : retValue;
+	}
+	switch(cmd)
+	{
+		case FLASHSETP:
+			if(arg >= target->number_of_pages)
+			{
+				return -EINVAL;
+			}
+			target->position = arg;
+			return 0;
+		case FLASHGETP:
+			return target->position;
+		case FLASHERASE:
+			blank = malloc(target->page_size);
+			if(blank == NULL)
+			{
+				return -ENOMEM;
+			}
+			memset(blank, 0xFF, target->page_size);
+			for(page = 0; page < target->number_of_pages; page++)
+			{
+				end = model_write(target->model, target_now_ns(), page, 1, blank);
+			}
+			free(blank);
+			if(target->model->real_time)
+			{
+				target_sleep_until(end);
+			}
+			return 0;
+		default:
+			return 0;
+	}
+}
+
+/**
+* target_close - Function to close a device
+* @target: Target
+*
+* Returns void, the model stays for other targets.
+*/
+void target_close(struct eeprom_target *target)
+{
+	if(target->fd >= 0)
+	{
+		close(target->fd);
+		target->fd = -1;
+	}
+}
@@ -0,0 +1,97 @@
+/******************************************************************************
+ *
+ * File Name: target.h
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: One way for the benchmark tools to use an EEPROM, whether it
+ * 				is driven by the Task1 driver, the Task2 driver or the
+ * 				software model.
+ *
+ *****************************************************************************/
+#ifndef EEPROM_TARGET_H
+#define EEPROM_TARGET_H
+
+#include <stdint.h>
+#include "model.h"
+
+/**
+ * Define constants using the macro
+ */
+#define DEVICE_PATH 		"/dev/i2c_flash"
+#define FLASHGETS			1
+#define FLASHGETP			2
+#define FLASHSETP			3
+#define FLASHERASE			4
+#define FLASHGETG			5
+#define FLASHERASEP			6
+#define FLASHERASEC			7
+#define FLASHWAIT			8
+#define FLASHFLUSH			9
+#define FLASHCANCEL			10
+#define FLASHSTATUS			11
+#define FLASHCAS			12
+#define TARGET_BLOCKING		1
+#define TARGET_POLLING		2
+#define TARGET_MODEL		3
+#define DEFAULT_POLL_US		100
+
+/**
+ * The driver takes the argument before the command
+ */
+#define eeprom_ioctl(fd, arg, cmd)	ioctl((fd), (unsigned long)(arg), (cmd))
+
+/**
+ *  Chip geometry as returned by FLASHGETG
+ */
+struct i2c_EEPROM_geometry
+{
+	unsigned int page_size;
+	unsigned int number_of_pages;
+	unsigned int address_bytes;
+	unsigned int slave_address;
+};
+
+/**
+ *  Scheduler state as returned by FLASHSTATUS, only used to tell the drivers apart
+ */
+struct i2c_EEPROM_status
+{
+	unsigned int queue_depth;
+	unsigned int current_op;
+	unsigned int current_ticket;
+	unsigned int pages_done;
+	unsigned int pages_total;
+	int last_error;
+	unsigned int works_done;
+	unsigned int works_failed;
+	long long queued_ns;
+	long long started_ns;
+	long long finished_ns;
+};
+
+/**
+ *  One open EEPROM
+ */
+struct eeprom_target
+{
+	int kind;						/* TARGET_BLOCKING, TARGET_POLLING or TARGET_MODEL */
+	int fd;							/* Device file, -1 for the model */
+	struct eeprom_model *model;		/* Model, NULL for a device */
+	unsigned int position;			/* Page pointer of the model */
+	unsigned int page_size;
+	unsigned int number_of_pages;
+	unsigned int poll_us;			/* Poll interval of Task2 reads */
+	int accept_only;				/* Task2 writes return once queued */
+};
+
+int target_detect(const char *path);
+int target_open(struct eeprom_target *target, const char *path, int kind, struct eeprom_model *model);
+int target_read(struct eeprom_target *target, unsigned char *buf, unsigned int count);
+int target_write(struct eeprom_target *target, const unsigned char *buf, unsigned int count);
+long target_ioctl(struct eeprom_target *target, unsigned long arg, unsigned int cmd);
+void target_close(struct eeprom_target *target);
+uint64_t target_now_ns(void);
+void target_sleep_until(uint64_t end);
+
+#endif
@@ -0,0 +1,56 @@
+/******************************************************************************
+ *
+ * File Name: trace.h
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: Binary I/O trace of an i2c_flash application. A header is
+ * 				followed by one fixed size record per call, in the order the
+ * 				calls finished. Written by the capture library, read by replay.
+ *
+ *****************************************************************************/
+#ifndef EEPROM_TRACE_H
+#define EEPROM_TRACE_H
+
+#include <stdint.h>
+
+/**
+ * Define constants using the macro
+ */
+#define TRACE_MAGIC			0x54433249		/* "I2CT" */
+#define TRACE_VERSION		1
+#define TRACE_OPEN			'O'
+#define TRACE_CLOSE			'C'
+#define TRACE_READ			'R'
+#define TRACE_WRITE			'W'
+#define TRACE_IOCTL			'I'
+
+/**
+ *  Start of every trace file
+ */
+struct trace_header
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t record_size;			/* sizeof(struct trace_record) of the writer */
+	uint32_t page_size;				/* Geometry of the traced chip, 0 if unknown */
+	uint32_t number_of_pages;
+};
+
+/**
+ *  One call of the application, 32 bytes
+ */
+struct trace_record
+{
+	uint64_t start_ns;				/* Issue time since the trace started */
+	uint32_t latency_ns;			/* Until the call returned, or the data of a polled read arrived */
+	uint16_t stream;				/* One per open() of the device */
+	uint8_t  op;					/* TRACE_OPEN ... TRACE_IOCTL */
+	uint8_t  reserved;
+	uint32_t page;					/* Page pointer when a read or write was issued */
+	uint32_t count;					/* Pages of a read or write, argument of an ioctl */
+	uint32_t cmd;					/* Command of an ioctl */
+	int32_t  result;				/* Return value, negative errno on failure */
+};
+
+#endif
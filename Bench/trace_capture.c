@@ -0,0 +1,392 @@
+/******************************************************************************
+ *
+ * File Name: trace_capture.c
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: Library to capture an I/O trace of any i2c_flash application
+ * 				without changing it or the driver. Loaded with LD_PRELOAD, it
+ * 				wraps open, read, write, ioctl and close of the device file and
+ * 				appends one record per call to the trace file.
+ *
+ * 				I2C_TRACE names the trace file (default i2c_trace.bin).
+ * 				I2C_TRACE_DEVICE is the start of the device path to trace
+ * 				(default /dev/i2c_flash).
+ *
+ * 				Polled reads of the non blocking driver become one record,
+ * 				issued with the first call and done with the call that got the
+ * 				data. The page of a read or write is asked from the driver with
+ * 				FLASHGETP just before the call.
+ *
+ *****************************************************************************/
+
+/**
+ *Include Library Headers
+ */
+#undef _FORTIFY_SOURCE
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include "target.h"
+#include "trace.h"
+
+/**
+ * Define constants using the macro
+ */
+#define TRACE_DEFAULT_FILE		"i2c_trace.bin"
+#define TRACE_MAX_FDS			1024
+#define TRACE_BUFFER			256
+
+/**
+ *  State of one traced file descriptor
+ */
+struct trace_fd
+{
+	int traced;
+	uint16_t stream;
+	int pending;					/* A polled read is queued in the driver */
+	uint64_t pending_start;
+	uint32_t pending_page;
+};
+
+static int (*real_open)(const char *, int, ...);
+static int (*real_open64)(const char *, int, ...);
+static ssize_t (*real_read)(int, void *, size_t);
+static ssize_t (*real_write)(int, const void *, size_t);
+static int (*real_ioctl)(int, unsigned long, ...);
+static int (*real_close)(int);
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_fd trace_fds[TRACE_MAX_FDS];
+static struct trace_record trace_buffer[TRACE_BUFFER];
+static unsigned int trace_buffered;
+static int trace_file = -1;
+static int trace_started;			/* Header written */
+static uint64_t trace_epoch;
+static uint16_t trace_next_stream;
+static const char *trace_device;
+static size_t trace_device_length;
+
+/**
+* trace_now_ns - Function to read the time since the trace started
+*
+* Returns nanoseconds.
+*/
+static uint64_t trace_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec - trace_epoch;
+}
+
+/**
+* trace_flush - Function to write the buffered records, called with trace_lock held
+*
+* Returns void.
+*/
+static void trace_flush(void)
+{
+	if(trace_file >= 0 && trace_buffered)
+	{
+		if(real_write(trace_file, trace_buffer, trace_buffered * sizeof(struct trace_record)) < 0)
+		{
+			fprintf(stderr, "i2c_trace: lost %u records\n", trace_buffered);
+		}
+	}
+	trace_buffered = 0;
+}
+
+/**
+* trace_emit - Function to add one record
+* @fd: Traced file descriptor
+* @op: TRACE_OPEN ... TRACE_IOCTL
+* @start: Issue time
+* @page: Page pointer
+* @count: Pages or ioctl argument
+* @cmd: Ioctl command
+* @result: Return value or negative errno
+*
+* Returns void, errno is kept for the application.
+*/
+static void trace_emit(int fd, uint8_t op, uint64_t start, uint32_t page, uint32_t count, uint32_t cmd, int32_t result)
+{
+	struct trace_record *r;
+	uint64_t latency = trace_now_ns() - start;
+	int savedErrno = errno;
+
+	pthread_mutex_lock(&trace_lock);
+	r = &trace_buffer[trace_buffered++];
+	memset(r, 0, sizeof(struct trace_record));
+	r->start_ns   = start;
+	r->latency_ns = (latency > UINT32_MAX) ? UINT32_MAX : latency;
+	r->stream     = trace_fds[fd].stream;
+	r->op         = op;
+	r->page       = page;
+	r->count      = count;
+	r->cmd        = cmd;
+	r->result     = result;
+	if(trace_buffered == TRACE_BUFFER || op == TRACE_CLOSE)
+	{
+		trace_flush();
+	}
+	pthread_mutex_unlock(&trace_lock);
+	errno = savedErrno;
+}
+
+/**
+* trace_is_traced - Function to check whether a file descriptor is the device
+*/
+static int trace_is_traced(int fd)
+{
+	return fd >= 0 && fd < TRACE_MAX_FDS && trace_fds[fd].traced;
+}
+
+/**
+* trace_page - Function to ask the driver for its page pointer
+* @fd: Traced file descriptor
+*
+* Returns the page, errno is kept for the application.
+*/
+static uint32_t trace_page(int fd)
+{
+	int savedErrno = errno;
+	int page = real_ioctl(fd, 0UL, (unsigned long)FLASHGETP);
+
+	errno = savedErrno;
+	return (page < 0) ? 0 : page;
+}
+
+/**
+* trace_prepare_fork - Functions to keep the trace sane over fork()
+*
+* Description: The buffer is written before the fork so the child does not
+* 				write it again. Streams of the child are numbered from its pid
+* 				so they do not clash with the parent's.
+*/
+static void trace_prepare_fork(void)
+{
+	pthread_mutex_lock(&trace_lock);
+	trace_flush();
+}
+
+static void trace_parent_fork(void)
+{
+	pthread_mutex_unlock(&trace_lock);
+}
+
+static void trace_child_fork(void)
+{
+	trace_next_stream = (getpid() & 0xFF) << 8;
+	pthread_mutex_unlock(&trace_lock);
+}
+
+/**
+* trace_init - Function to find the wrapped calls and open the trace file
+*/
+__attribute__((constructor)) static void trace_init(void)
+{
+	const char *path = getenv("I2C_TRACE");
+	struct timespec ts;
+
+	real_open   = dlsym(RTLD_NEXT, "open");
+	real_open64 = dlsym(RTLD_NEXT, "open64");
+	real_read   = dlsym(RTLD_NEXT, "read");
+	real_write  = dlsym(RTLD_NEXT, "write");
+	real_ioctl  = dlsym(RTLD_NEXT, "ioctl");
+	real_close  = dlsym(RTLD_NEXT, "close");
+	trace_device = getenv("I2C_TRACE_DEVICE");
+	if(trace_device == NULL)
+	{
+		trace_device = DEVICE_PATH;
+	}
+	trace_device_length = strlen(trace_device);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	trace_epoch = ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+	trace_file = real_open((path != NULL) ? path : TRACE_DEFAULT_FILE, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	if(trace_file < 0)
+	{
+		fprintf(stderr, "i2c_trace: can not create the trace file\n");
+	}
+	pthread_atfork(trace_prepare_fork, trace_parent_fork, trace_child_fork);
+}
+
+/**
+* trace_exit - Function to write what is left at exit
+*/
+__attribute__((destructor)) static void trace_exit(void)
+{
+	pthread_mutex_lock(&trace_lock);
+	trace_flush();
+	pthread_mutex_unlock(&trace_lock);
+}
+
+/**
+* trace_opened - Function to start tracing a newly opened file
+* @path: Path given to open
+* @fd: Result of open
+* @start: Issue time
+*
+* Returns fd, errno is kept for the application.
+*/
+static int trace_opened(const char *path, int fd, uint64_t start)
+{
+	struct i2c_EEPROM_geometry geometry;
+	struct trace_header header;
+	int savedErrno = errno;
+
+	if(trace_file < 0 || path == NULL || strncmp(path, trace_device, trace_device_length) != 0)
+	{
+		return fd;
+	}
+	if(fd >= 0 && fd < TRACE_MAX_FDS)
+	{
+		pthread_mutex_lock(&trace_lock);
+		if(!trace_started)
+		{
+			//The first device opened gives the geometry of the trace
+			memset(&header, 0, sizeof(header));
+			header.magic = TRACE_MAGIC;
+			header.version = TRACE_VERSION;
+			header.record_size = sizeof(struct trace_record);
+			if(real_ioctl(fd, (unsigned long)&geometry, (unsigned long)FLASHGETG) >= 0)
+			{
+				header.page_size = geometry.page_size;
+				header.number_of_pages = geometry.number_of_pages;
+			}
+			if(real_write(trace_file, &header, sizeof(header)) < 0)
+			{
+				fprintf(stderr, "i2c_trace: can not write the trace header\n");
+			}
+			trace_started = 1;
+		}
+		memset(&trace_fds[fd], 0, sizeof(struct trace_fd));
+		trace_fds[fd].traced = 1;
+		trace_fds[fd].stream = trace_next_stream++;
+		pthread_mutex_unlock(&trace_lock);
+		trace_emit(fd, TRACE_OPEN, start, 0, 0, 0, 0);
+	}
+	errno = savedErrno;
+	return fd;
+}
+
+/**
+ * Wrapped calls
+ */
+int open(const char *path, int flags, ...)
+{
+	uint64_t start = trace_now_ns();
+	mode_t mode = 0;
+	va_list ap;
+
+	if(flags & O_CREAT)
+	{
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+	return trace_opened(path, real_open(path, flags, mode), start);
+}
+
+int open64(const char *path, int flags, ...)
+{
+	uint64_t start = trace_now_ns();
+	mode_t mode = 0;
+	va_list ap;
+
+	if(flags & O_CREAT)
+	{
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+	return trace_opened(path, real_open64(path, flags, mode), start);
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+	uint64_t start;
+	uint32_t page;
+	ssize_t retValue;
+
+	if(!trace_is_traced(fd))
+	{
+		return real_read(fd, buf, count);
+	}
+	page  = trace_fds[fd].pending ? trace_fds[fd].pending_page : trace_page(fd);
+	start = trace_fds[fd].pending ? trace_fds[fd].pending_start : trace_now_ns();
+	retValue = real_read(fd, buf, count);
+	if(retValue == -1 && errno == EPERM)
+	{
+		trace_fds[fd].pending = 1;
+		trace_fds[fd].pending_start = start;
+		trace_fds[fd].pending_page = page;
+		return retValue;
+	}
+	trace_fds[fd].pending = 0;
+	trace_emit(fd, TRACE_READ, start, page, count, 0, (retValue < 0) ? -errno : retValue);
+	return retValue;
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+	uint64_t start;
+	uint32_t page;
+	ssize_t retValue;
+
+	if(!trace_is_traced(fd))
+	{
+		return real_write(fd, buf, count);
+	}
+	page  = trace_page(fd);
+	start = trace_now_ns();
+	retValue = real_write(fd, buf, count);
+	trace_emit(fd, TRACE_WRITE, start, page, count, 0, (retValue < 0) ? -errno : retValue);
+	return retValue;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+	unsigned long cmd;
+	uint64_t start;
+	va_list ap;
+	int retValue;
+
+	va_start(ap, request);
+	cmd = va_arg(ap, unsigned long);
+	va_end(ap);
+	if(!trace_is_traced(fd))
+	{
+		return real_ioctl(fd, request, cmd);
+	}
+	//The driver takes the argument before the command
+	start = trace_now_ns();
+	retValue = real_ioctl(fd, request, cmd);
+	trace_emit(fd, TRACE_IOCTL, start, 0, request, cmd, (retValue < 0) ? -errno : retValue);
+	return retValue;
+}
+
+int close(int fd)
+{
+	uint64_t start;
+	int retValue;
+
+	if(!trace_is_traced(fd))
+	{
+		return real_close(fd);
+	}
+	start = trace_now_ns();
+	retValue = real_close(fd);
+	trace_emit(fd, TRACE_CLOSE, start, 0, 0, 0, (retValue < 0) ? -errno : retValue);
+	trace_fds[fd].traced = 0;
+	return retValue;
+}
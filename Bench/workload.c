@@ -0,0 +1,260 @@
+/******************************************************************************
+ *
+ * File Name: workload.c
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: Workload generator for the benchmark tools. Every client has
+ * 				its own generator with its own seed, so a run can be repeated.
+ *
+ * 				uniform		every page as likely
+ * 				seq			one request after the other, wrapping at the end
+ * 				zipf:theta	page k is hit in proportion to 1/(k+1)^theta,
+ * 							page 0 is the hottest
+ * 				hot:P:A		A percent of requests go to the first P percent
+ * 							of pages, the rest to the others
+ *
+ *****************************************************************************/
+
+/**
+ *Include Library Headers
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "workload.h"
+
+/**
+* workload_random - Function to draw the next random number
+* @w: Generator
+*
+* Returns a number uniform in [0, 1).
+*/
+static double workload_random(struct workload *w)
+{
+	//xorshift64*, every client its own stream
+	w->state ^= w->state >> 12;
+	w->state ^= w->state << 25;
+	w->state ^= w->state >> 27;
+	return ((w->state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+* workload_below - Function to draw a number in [0, n)
+*/
+static unsigned int workload_below(struct workload *w, unsigned int n)
+{
+	return (unsigned int)(workload_random(w) * n);
+}
+
+/**
+* workload_exponential - Function to draw an exponential time
+* @w: Generator
+* @mean_ns: Mean in nanoseconds
+*
+* Returns nanoseconds.
+*/
+static uint64_t workload_exponential(struct workload *w, double mean_ns)
+{
+	return (uint64_t)(-log(1.0 - workload_random(w)) * mean_ns);
+}
+
+/**
+* workload_zipf - Function to draw a Zipfian rank
+* @w: Generator
+* @n: Number of ranks
+*
+* Returns a rank in [0, n), 0 the most likely.
+*
+* Description: The method of Gray et al., "Quickly Generating Billion-Record
+* 				Synthetic Databases", with zeta(n, theta) worked out once in
+* 				workload_init().
+*/
+static unsigned int workload_zipf(struct workload *w, unsigned int n)
+{
+	double u = workload_random(w), uz = u * w->zeta_n;
+	unsigned int rank;
+
+	if(uz < 1.0)
+	{
+		return 0;
+	}
+	if(uz < 1.0 + pow(0.5, w->config.theta))
+	{
+		return 1;
+	}
+	rank = (unsigned int)(n * pow(w->eta * u - w->eta + 1.0, w->alpha));
+	return (rank < n) ? rank : n - 1;
+}
+
+/**
+* workload_parse - Function to read a distribution from the command line
+* @config: Settings to fill in
+* @spec: "uniform", "seq", "zipf[:theta]" or "hot[:pages_pct[:access_pct]]"
+*
+* Returns 0, or -1 if spec is not known.
+*/
+int workload_parse(struct workload_config *config, const char *spec)
+{
+	config->theta = WORKLOAD_ZIPF_THETA;
+	config->hot_pages_pct = WORKLOAD_HOT_PAGES_PCT;
+	config->hot_access_pct = WORKLOAD_HOT_ACCESS_PCT;
+	if(strcmp(spec, "uniform") == 0)
+	{
+		config->distribution = WORKLOAD_UNIFORM;
+	}
+	else if(strcmp(spec, "seq") == 0)
+	{
+		config->distribution = WORKLOAD_SEQUENTIAL;
+	}
+	else if(strncmp(spec, "zipf", 4) == 0 && (spec[4] == '\0' || spec[4] == ':'))
+	{
+		config->distribution = WORKLOAD_ZIPF;
+		if(spec[4] == ':')
+		{
+			config->theta = atof(&spec[5]);
+		}
+		if(config->theta <= 0.0 || config->theta >= 1.0)
+		{
+			return -1;
+		}
+	}
+	else if(strncmp(spec, "hot", 3) == 0 && (spec[3] == '\0' || spec[3] == ':'))
+	{
+		config->distribution = WORKLOAD_HOTSET;
+		if(spec[3] == ':')
+		{
+			sscanf(&spec[4], "%u:%u", &config->hot_pages_pct, &config->hot_access_pct);
+		}
+		if(config->hot_pages_pct < 1 || config->hot_pages_pct > 99 || config->hot_access_pct > 100)
+		{
+			return -1;
+		}
+	}
+	else
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/**
+* workload_name - Function to print a distribution the way workload_parse() reads it
+* @config: Settings
+* @buf: Output buffer
+* @size: Size of buf
+*
+* Returns buf.
+*/
+const char *workload_name(const struct workload_config *config, char *buf, unsigned int size)
+{
+	switch(config->distribution)
+	{
+		case WORKLOAD_SEQUENTIAL:
+			snprintf(buf, size, "seq");
+			break;
+		case WORKLOAD_ZIPF:
+			snprintf(buf, size, "zipf:%.2f", config->theta);
+			break;
+		case WORKLOAD_HOTSET:
+			snprintf(buf, size, "hot:%u:%u", config->hot_pages_pct, config->hot_access_pct);
+			break;
+		default:
+			snprintf(buf, size, "uniform");
+			break;
+	}
+	return buf;
+}
+
+/**
+* workload_init - Function to set up the generator of one client
+* @w: Generator
+* @config: Settings
+* @region_pages: Pages the requests are spread over
+* @seed: Seed of the client, not 0
+*
+* Returns 0, or -1 if a request of max_pages does not fit the region.
+*/
+int workload_init(struct workload *w, const struct workload_config *config, unsigned int region_pages, unsigned int seed)
+{
+	unsigned int i, n;
+	double zeta2;
+
+	memset(w, 0, sizeof(struct workload));
+	w->config = *config;
+	w->region_pages = region_pages;
+	w->state = ((uint64_t)seed << 32) | (seed ^ 0x9E3779B9);
+	if(config->min_pages < 1 || config->max_pages < config->min_pages || config->max_pages > region_pages)
+	{
+		return -1;
+	}
+	if(config->distribution == WORKLOAD_ZIPF)
+	{
+		//Ranks are the pages a request of min_pages can start at
+		n = region_pages - config->min_pages + 1;
+		for(i = 1; i <= n; i++)
+		{
+			w->zeta_n += 1.0 / pow(i, config->theta);
+		}
+		zeta2 = 1.0 + pow(0.5, config->theta);
+		w->alpha = 1.0 / (1.0 - config->theta);
+		w->eta = (1.0 - pow(2.0 / n, 1.0 - config->theta)) / (1.0 - zeta2 / w->zeta_n);
+	}
+	return 0;
+}
+
+/**
+* workload_next - Function to draw the next request
+* @w: Generator
+* @op: Request
+*
+* Returns void.
+*
+* Description: A request never runs over the end of the region, a page drawn
+* 				too close to it is moved back.
+*/
+void workload_next(struct workload *w, struct workload_op *op)
+{
+	struct workload_config *config = &w->config;
+	unsigned int last, hot, page;
+
+	op->type  = (workload_below(w, 100) < config->read_pct) ? WORKLOAD_READ : WORKLOAD_WRITE;
+	op->count = config->min_pages + workload_below(w, config->max_pages - config->min_pages + 1);
+	last = w->region_pages - op->count;
+	switch(config->distribution)
+	{
+		case WORKLOAD_SEQUENTIAL:
+			if(w->next_page > last)
+			{
+				w->next_page = 0;
+			}
+			page = w->next_page;
+			w->next_page += op->count;
+			break;
+		case WORKLOAD_ZIPF:
+			page = workload_zipf(w, w->region_pages - config->min_pages + 1);
+			break;
+		case WORKLOAD_HOTSET:
+			hot = (w->region_pages * config->hot_pages_pct) / 100;
+			if(hot < 1)
+			{
+				hot = 1;
+			}
+			if(workload_below(w, 100) < config->hot_access_pct || hot == w->region_pages)
+			{
+				page = workload_below(w, hot);
+			}
+			else
+			{
+				page = hot + workload_below(w, w->region_pages - hot);
+			}
+			break;
+		default:
+			page = workload_below(w, last + 1);
+			break;
+	}
+	op->page = (page > last) ? last : page;
+	op->gap_ns = (config->rate > 0.0) ? workload_exponential(w, 1e9 / config->rate) : 0;
+	op->think_ns = config->think_us ? workload_exponential(w, config->think_us * 1000.0) : 0;
+}
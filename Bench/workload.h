@@ -0,0 +1,78 @@
+/******************************************************************************
+ *
+ * File Name: workload.h
+ *
+ * Date: 19-OCT-2026
+ *
+ * Description: Workload generator for the benchmark tools. Picks the type,
+ * 				page and size of every request from a uniform, sequential,
+ * 				Zipfian or hot set distribution, and the time before it from a
+ * 				think time or an open loop arrival rate.
+ *
+ *****************************************************************************/
+#ifndef EEPROM_WORKLOAD_H
+#define EEPROM_WORKLOAD_H
+
+#include <stdint.h>
+
+/**
+ * Define constants using the macro
+ */
+#define WORKLOAD_UNIFORM		0
+#define WORKLOAD_SEQUENTIAL		1
+#define WORKLOAD_ZIPF			2
+#define WORKLOAD_HOTSET			3
+#define WORKLOAD_ZIPF_THETA		0.99
+#define WORKLOAD_HOT_PAGES_PCT	20
+#define WORKLOAD_HOT_ACCESS_PCT	80
+#define WORKLOAD_READ			'R'
+#define WORKLOAD_WRITE			'W'
+
+/**
+ *  Settings of a workload, the same for every client
+ */
+struct workload_config
+{
+	int distribution;				/* WORKLOAD_UNIFORM ... WORKLOAD_HOTSET */
+	double theta;					/* Skew of WORKLOAD_ZIPF, 0 < theta < 1 */
+	unsigned int hot_pages_pct;		/* Size of the hot set of WORKLOAD_HOTSET ... */
+	unsigned int hot_access_pct;	/* ... and the share of requests that go to it */
+	unsigned int read_pct;			/* Percent of reads */
+	unsigned int min_pages;			/* Size of a request, uniform between the two */
+	unsigned int max_pages;
+	unsigned int think_us;			/* Mean pause after a request, closed loop */
+	double rate;					/* Requests per second of a client, open loop, 0 for closed loop */
+};
+
+/**
+ *  State of the generator of one client
+ */
+struct workload
+{
+	struct workload_config config;
+	unsigned int region_pages;		/* Pages the requests are spread over */
+	uint64_t state;					/* Random generator */
+	unsigned int next_page;			/* WORKLOAD_SEQUENTIAL */
+	double zeta_n;					/* WORKLOAD_ZIPF, see workload_zipf() */
+	double alpha;
+	double eta;
+};
+
+/**
+ *  One request
+ */
+struct workload_op
+{
+	char type;						/* WORKLOAD_READ or WORKLOAD_WRITE */
+	unsigned int page;				/* First page, from the start of the region */
+	unsigned int count;				/* Pages */
+	uint64_t gap_ns;				/* Open loop: time since the arrival of the last request */
+	uint64_t think_ns;				/* Closed loop: pause after this request */
+};
+
+int workload_parse(struct workload_config *config, const char *spec);
+const char *workload_name(const struct workload_config *config, char *buf, unsigned int size);
+int workload_init(struct workload *w, const struct workload_config *config, unsigned int region_pages, unsigned int seed);
+void workload_next(struct workload *w, struct workload_op *op);
+
+#endif
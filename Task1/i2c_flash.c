@@ -24,6 +24,12 @@
 #include <linux/gpio.h>
 #include <asm/uaccess.h>
 #include <linux/string.h>
+#include <linux/moduleparam.h>
+#include <linux/of.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/version.h>
+#include <linux/delay.h>
 
 /**
  * Define constants using the macro
@@ -36,10 +42,27 @@
 #define SLAVE_ADDRESS       0x54
 #define EEPROM_PAGE_SIZE	64
 #define NUMBER_OF_PAGES		512
+#define ADDRESS_BYTES		2
+#define MIN_PAGE_SIZE		8
+#define MAX_PAGE_SIZE		256
+#define MAX_MESSAGE_LENGTH	0xFFFF
+#define WRITE_CYCLE_TIME	5000
 #define FLASHGETS			1
 #define FLASHGETP			2
 #define FLASHSETP			3
 #define FLASHERASE			4
+#define FLASHGETG			5
+
+/**
+ *  Chip geometry, also returned to user space by FLASHGETG
+ */
+struct i2c_EEPROM_geometry
+{
+  unsigned int page_size;			/* Page size in bytes */
+  unsigned int number_of_pages;		/* Number of pages on the chip */
+  unsigned int address_bytes;		/* Width of the memory address, 1 or 2 */
+  unsigned int slave_address;		/* Slave address of EEPROM */
+};
 
 /**
  *  Per-device data structure for each
@@ -49,10 +72,20 @@ struct i2c_EEPROM_dev
 {
   struct i2c_client client;      	/* I2C client for EEPROM */
   unsigned int addr;              	/* Slave address of EEPROM */
-  unsigned short current_pointer; 	/* Current Position pointer */
+  unsigned int current_pointer; 	/* Current Position pointer */
   struct cdev cdev;				  	/* Character Device */
   char name[20];				  	/* Character Device Name */
   unsigned int BUSY_FLAG;		  	/* Busy Flag Status */	
+  struct i2c_EEPROM_geometry geometry;	/* Page size, page count and address width */
+  unsigned int size;				/* Chip size in bytes */
+  int (*write_pages)(struct i2c_EEPROM_dev *, const char __user *, size_t);	/* Page loop for this geometry */
+  struct device *device;			/* Class device carrying the sysfs attributes */
+  unsigned int max_read_len;		/* Largest read message the adapter accepts */
+  unsigned int max_first_read_len;	/* Largest read after the address in a combined transfer */
+  unsigned int combined_read;		/* Adapter accepts write-then-read in one transfer */
+  unsigned int bus_clock;			/* Bus clock from the adapter's device tree node, 0 if unknown */
+  unsigned int bus_speed;			/* Bus speed in Hz measured at probe */
+  ktime_t write_cycle_end;			/* When the chip finishes its last page write */
 };
 
 /**
@@ -63,6 +96,26 @@ static struct class *eep_class;   					/* Device class */
 struct i2c_EEPROM_dev *i2c_EEPROM_device_list;     	/* List of private data structures, one per bank */
 struct i2c_client* client_core = NULL;
 
+/**
+ * Module parameters for the chip geometry, used unless the device tree
+ * describes the EEPROM
+ */
+static unsigned short slave_address = SLAVE_ADDRESS;
+module_param(slave_address, ushort, S_IRUGO);
+MODULE_PARM_DESC(slave_address, "I2C slave address of the EEPROM (default 0x54)");
+static unsigned int page_size = EEPROM_PAGE_SIZE;
+module_param(page_size, uint, S_IRUGO);
+MODULE_PARM_DESC(page_size, "Page size in bytes: 8, 16, 32, 64, 128 or 256 (default 64)");
+static unsigned int number_of_pages = NUMBER_OF_PAGES;
+module_param(number_of_pages, uint, S_IRUGO);
+MODULE_PARM_DESC(number_of_pages, "Number of pages on the chip (default 512)");
+static unsigned int address_bytes = ADDRESS_BYTES;
+module_param(address_bytes, uint, S_IRUGO);
+MODULE_PARM_DESC(address_bytes, "Memory address width in bytes: 1 or 2 (default 2)");
+static unsigned int write_cycle_time = WRITE_CYCLE_TIME;
+module_param(write_cycle_time, uint, S_IRUGO);
+MODULE_PARM_DESC(write_cycle_time, "Page write cycle time in microseconds (default 5000)");
+
 /**
  *  Data structure for i2c device id of EEPROM
  */
@@ -70,19 +123,485 @@ static struct i2c_device_id eeprom_id_table[] = {
 	{DEVICE_NAME,0}
 };
 
+/**
+ *  Data structure for device tree match of EEPROM
+ */
+static const struct of_device_id eeprom_of_match[] = {
+	{ .compatible = "asu,i2c_flash" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, eeprom_of_match);
+
+/**
+* i2c_eeprom_chip_address - Function to get the slave address for a memory offset
+* @dev: EEPROM device
+* @offset: Memory offset
+*
+* Returns slave address.
+* 
+* Description: One byte address parts larger than 256 bytes (24C04 - 24C16) carry
+* 				the upper address bits in the low bits of the slave address.
+*/
+static inline unsigned short i2c_eeprom_chip_address(struct i2c_EEPROM_dev *dev, unsigned int offset)
+{
+	if(dev->geometry.address_bytes == 1)
+	{
+		return dev->client.addr | ((offset >> 8) & 0x07);
+	}
+	return dev->client.addr;
+}
+
+/**
+* i2c_eeprom_send - Function to issue a single I2C message in master transmit mode
+* @dev: EEPROM device
+* @offset: Memory offset the message is addressed to
+* @buffer: Address bytes followed by the payload
+* @length: Length of buffer
+*
+* Returns negative errno, or else the number of messages sent.
+*/
+static int i2c_eeprom_send(struct i2c_EEPROM_dev *dev, unsigned int offset, char *buffer, int length)
+{
+	struct i2c_msg msg;
+
+	msg.addr  = i2c_eeprom_chip_address(dev, offset);
+	msg.flags = 0;
+	msg.len   = length;
+	msg.buf   = buffer;
+	return i2c_transfer(dev->client.adapter, &msg, 1);
+}
+
+/**
+* i2c_eeprom_set_address - Function to place a memory offset at the start of a message
+* @buffer: Message buffer
+* @offset: Memory offset
+* @addressBytes: Width of the memory address
+*
+* Returns void.
+*/
+static __always_inline void i2c_eeprom_set_address(char *buffer, unsigned int offset, const unsigned int addressBytes)
+{
+	if(addressBytes == 2)
+	{
+		//Set Address High Byte
+		buffer[0] = ((offset >> 8) & 0xFF);
+	}
+	//Set Address Low Byte
+	buffer[addressBytes - 1] = (offset & 0xFF);
+}
+
+/**
+* i2c_eeprom_wait_write_cycle - Function to wait for the chip to finish its page write
+* @dev: EEPROM device
+*
+* Returns void.
+* 
+* Description: The chip does not answer while it programs a page, so every transfer
+* 				waits out what is left of the write cycle of the last page sent.
+*/
+static void i2c_eeprom_wait_write_cycle(struct i2c_EEPROM_dev *dev)
+{
+	s64 remaining = ktime_us_delta(dev->write_cycle_end, ktime_get());
+
+	if(remaining > 0)
+	{
+		usleep_range(remaining, remaining + 100);
+	}
+}
+
+/**
+* i2c_eeprom_read_data - Function to read a block of memory in adapter sized chunks
+* @dev: EEPROM device
+* @offset: Memory offset to read from
+* @buffer: Buffer for the data
+* @length: Number of bytes
+*
+* Returns negative errno, or else 0.
+* 
+* Description: The address write and the first chunk go out as one combined
+* 				transfer. The chip keeps counting, so the remaining chunks are issued
+* 				back to back as current address reads without addressing it again.
+*/
+static int i2c_eeprom_read_data(struct i2c_EEPROM_dev *dev, unsigned int offset, char *buffer, unsigned int length)
+{
+	struct i2c_msg msg[2];
+	char Address[2];
+	unsigned int chunk, done;
+	int retValue;
+
+	i2c_eeprom_wait_write_cycle(dev);
+	i2c_eeprom_set_address(Address, offset, dev->geometry.address_bytes);
+	msg[0].addr  = i2c_eeprom_chip_address(dev, offset);
+	msg[0].flags = 0;
+	msg[0].len   = dev->geometry.address_bytes;
+	msg[0].buf   = Address;
+	msg[1].addr  = msg[0].addr;
+	msg[1].flags = I2C_M_RD;
+	if(dev->combined_read)
+	{
+		chunk = min(length, dev->max_first_read_len);
+		msg[1].len = chunk;
+		msg[1].buf = buffer;
+		retValue = i2c_transfer(dev->client.adapter, msg, 2);
+	}
+	else
+	{
+		chunk = 0;
+		retValue = i2c_transfer(dev->client.adapter, msg, 1);
+	}
+	for(done = chunk; retValue >= 0 && done < length; done += chunk)
+	{
+		chunk = min(length - done, dev->max_read_len);
+		msg[1].addr = i2c_eeprom_chip_address(dev, offset + done);
+		msg[1].len  = chunk;
+		msg[1].buf  = &buffer[done];
+		retValue = i2c_transfer(dev->client.adapter, &msg[1], 1);
+	}
+	return (retValue < 0) ? retValue : 0;
+}
+
+/**
+* i2c_eeprom_set_transfer_limits - Function to size read chunks for the adapter
+* @dev: EEPROM device
+* @adapter: Adapter the EEPROM sits on
+*
+* Returns void.
+* 
+* Description: Reads are split to the adapter's quirks when it declares any,
+* 				otherwise to the largest length an I2C message can carry.
+*/
+static void i2c_eeprom_set_transfer_limits(struct i2c_EEPROM_dev *dev, struct i2c_adapter *adapter)
+{
+	u32 value;
+
+	dev->max_read_len = MAX_MESSAGE_LENGTH;
+	dev->max_first_read_len = MAX_MESSAGE_LENGTH;
+	dev->combined_read = 1;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,1,0)
+	if(adapter->quirks)
+	{
+		if(adapter->quirks->max_read_len)
+		{
+			dev->max_read_len = min_t(unsigned int, dev->max_read_len, adapter->quirks->max_read_len);
+		}
+		dev->max_first_read_len = dev->max_read_len;
+		if(adapter->quirks->max_comb_2nd_msg_len)
+		{
+			dev->max_first_read_len = min_t(unsigned int, dev->max_first_read_len, adapter->quirks->max_comb_2nd_msg_len);
+		}
+		if(adapter->quirks->max_num_msgs == 1)
+		{
+			dev->combined_read = 0;
+		}
+	}
+#endif
+	dev->bus_clock = 0;
+	if(adapter->dev.of_node && !of_property_read_u32(adapter->dev.of_node, "clock-frequency", &value))
+	{
+		dev->bus_clock = value;
+	}
+}
+
+/**
+* i2c_eeprom_measure_bus_speed - Function to measure the effective bus speed
+* @dev: EEPROM device
+*
+* Returns void.
+* 
+* Description: Times a one page read from offset 0 and counts nine clocks for
+* 				every byte on the wire (slave address, memory address and data).
+*/
+static void i2c_eeprom_measure_bus_speed(struct i2c_EEPROM_dev *dev)
+{
+	char probeBuffer[MAX_PAGE_SIZE];
+	unsigned int bits;
+	ktime_t start;
+	s64 elapsed;
+
+	dev->bus_speed = 0;
+	start = ktime_get();
+	if(i2c_eeprom_read_data(dev, 0, probeBuffer, dev->geometry.page_size) < 0)
+	{
+		printk("Bus speed measurement failed\n");
+		return;
+	}
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+	bits = (2 + (dev->combined_read ? 0 : 1) + dev->geometry.address_bytes + dev->geometry.page_size) * 9;
+	if(elapsed > 0)
+	{
+		dev->bus_speed = div64_u64((u64)bits * NSEC_PER_SEC, elapsed);
+	}
+	printk("EEPROM bus speed %u Hz (adapter clock %u Hz), reads split at %u bytes\n",
+		dev->bus_speed, dev->bus_clock, dev->max_read_len);
+}
+
+/**
+ * Sysfs attributes of the EEPROM class device
+ */
+static ssize_t bus_speed_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->bus_speed);
+}
+static DEVICE_ATTR(bus_speed, S_IRUGO, bus_speed_show, NULL);
+
+static ssize_t bus_clock_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->bus_clock);
+}
+static DEVICE_ATTR(bus_clock, S_IRUGO, bus_clock_show, NULL);
+
+static ssize_t max_read_len_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->max_read_len);
+}
+static DEVICE_ATTR(max_read_len, S_IRUGO, max_read_len_show, NULL);
+
+static struct attribute *i2c_eeprom_attrs[] = {
+	&dev_attr_bus_speed.attr,
+	&dev_attr_bus_clock.attr,
+	&dev_attr_max_read_len.attr,
+	NULL,
+};
+
+static const struct attribute_group i2c_eeprom_attr_group = {
+	.attrs = i2c_eeprom_attrs,
+};
+
+/**
+* i2c_eeprom_stage_page - Function to prepare the next page for the bus
+* @frame: Address bytes followed by room for one page
+* @offset: Memory offset of the page
+* @buf: Page data in user space
+* @pageSize: Page size in bytes
+* @addressBytes: Width of the memory address
+*
+* Returns 0, or -EFAULT if the page can not be copied.
+* 
+* Description: The page is copied from user space straight behind its address,
+* 				so the frame goes to the bus as it is.
+*/
+static __always_inline int i2c_eeprom_stage_page(char *frame, unsigned int offset, const char __user *buf,
+	const unsigned int pageSize, const unsigned int addressBytes)
+{
+	i2c_eeprom_set_address(frame, offset, addressBytes);
+	return copy_from_user(&frame[addressBytes], buf, pageSize) ? -EFAULT : 0;
+}
+
+/**
+* i2c_eeprom_write_pages - Function to program consecutive pages from the current pointer
+* @dev: EEPROM device
+* @buf: Page data in user space
+* @count: Number of pages
+* @pageSize: Page size in bytes
+* @addressBytes: Width of the memory address
+*
+* Returns negative errno, or else 0.
+* 
+* Description: Two frames are used in turn. While one page is programmed by the
+* 				chip, the next page is copied from user space into the other frame,
+* 				so a write of many pages costs little more than the bus and write
+* 				cycle time. Always inlined, so the wrappers below get a copy of the
+* 				loop with the page size and address width folded in as constants.
+*/
+static __always_inline int i2c_eeprom_write_pages(struct i2c_EEPROM_dev *dev, const char __user *buf, size_t count,
+	const unsigned int pageSize, const unsigned int addressBytes)
+{
+	int retValue;
+	size_t i;
+	char frame[2][ADDRESS_BYTES + MAX_PAGE_SIZE];
+	unsigned int tempPointer = dev->current_pointer;
+
+	retValue = i2c_eeprom_stage_page(frame[0], tempPointer, buf, pageSize, addressBytes);
+	for(i=0;i<count && retValue==0;i++)
+	{
+		i2c_eeprom_wait_write_cycle(dev);
+		retValue = i2c_eeprom_send(dev, tempPointer, frame[i & 1], addressBytes + pageSize);
+		if(retValue<0)
+		{
+			printk("Error:i2c_master_send");
+			return retValue;
+		}
+		dev->write_cycle_end = ktime_add_us(ktime_get(), write_cycle_time);
+		tempPointer = tempPointer + pageSize;
+		//If current position of pointer has reached the last position then reset it back to 0
+		if(tempPointer >= dev->size)
+		{
+			tempPointer = 0;
+		}
+		dev->current_pointer = tempPointer;
+		//Stage the next page while the chip programs this one
+		retValue = 0;
+		if(i + 1 < count)
+		{
+			retValue = i2c_eeprom_stage_page(frame[(i + 1) & 1], tempPointer, &buf[(i + 1) * pageSize], pageSize, addressBytes);
+		}
+	}
+	return retValue;
+}
+
+/**
+ * Fast paths for the common geometries
+ */
+#define I2C_EEPROM_WRITE_PAGES(pageSize, addressBytes) \
+static int i2c_eeprom_write_pages_##pageSize##_##addressBytes(struct i2c_EEPROM_dev *dev, const char __user *buf, size_t count) \
+{ \
+	return i2c_eeprom_write_pages(dev, buf, count, pageSize, addressBytes); \
+}
+I2C_EEPROM_WRITE_PAGES(8, 1)
+I2C_EEPROM_WRITE_PAGES(16, 1)
+I2C_EEPROM_WRITE_PAGES(32, 2)
+I2C_EEPROM_WRITE_PAGES(64, 2)
+I2C_EEPROM_WRITE_PAGES(128, 2)
+I2C_EEPROM_WRITE_PAGES(256, 2)
+
+static int i2c_eeprom_write_pages_generic(struct i2c_EEPROM_dev *dev, const char __user *buf, size_t count)
+{
+	return i2c_eeprom_write_pages(dev, buf, count, dev->geometry.page_size, dev->geometry.address_bytes);
+}
+
+/**
+* i2c_eeprom_erase_pages - Function to program every page with 0xFF
+* @dev: EEPROM device
+*
+* Returns negative errno, or else 0.
+* 
+* Description: One frame is filled with 0xFF once, only its address changes
+* 				from page to page.
+*/
+static int i2c_eeprom_erase_pages(struct i2c_EEPROM_dev *dev)
+{
+	int retValue;
+	unsigned int i, tempPointer;
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int addressBytes = dev->geometry.address_bytes;
+	char frame[ADDRESS_BYTES + MAX_PAGE_SIZE];
+
+	memset(&frame[addressBytes], 0xFF, pageSize);
+	for(i=0;i<dev->geometry.number_of_pages;i++)
+	{
+		tempPointer = i * pageSize;
+		i2c_eeprom_set_address(frame, tempPointer, addressBytes);
+		gpio_set_value_cansleep(GPIO_LED_PIN, 1);
+		i2c_eeprom_wait_write_cycle(dev);
+		retValue = i2c_eeprom_send(dev, tempPointer, frame, addressBytes + pageSize);
+		dev->write_cycle_end = ktime_add_us(ktime_get(), write_cycle_time);
+		gpio_set_value_cansleep(GPIO_LED_PIN, 0);
+		if(retValue<0)
+		{
+			return retValue;
+		}
+		printk("Page %i Erase Successfull\n",i);
+	}
+	return 0;
+}
+
+/**
+* i2c_eeprom_set_geometry - Function to validate and apply the chip geometry
+* @dev: EEPROM device
+* @geometry: Requested geometry
+*
+* Returns 0, or -EINVAL if the geometry is not supported.
+* 
+* Description: Page size must be a power of two from 8 to 256 bytes and the address
+* 				one or two bytes wide. The page loop for the geometry is picked here once.
+*/
+static int i2c_eeprom_set_geometry(struct i2c_EEPROM_dev *dev, const struct i2c_EEPROM_geometry *geometry)
+{
+	unsigned int maxSize;
+
+	if(geometry->page_size < MIN_PAGE_SIZE || geometry->page_size > MAX_PAGE_SIZE ||
+		(geometry->page_size & (geometry->page_size - 1)))
+	{
+		return -EINVAL;
+	}
+	if(geometry->address_bytes != 1 && geometry->address_bytes != 2)
+	{
+		return -EINVAL;
+	}
+	//One byte parts address at most eight 256 byte blocks through the slave address
+	maxSize = (geometry->address_bytes == 1) ? (256 * 8) : (256 * 256);
+	if(geometry->number_of_pages < 1 || geometry->number_of_pages > (maxSize / geometry->page_size))
+	{
+		return -EINVAL;
+	}
+
+	dev->geometry = *geometry;
+	dev->size = geometry->page_size * geometry->number_of_pages;
+	dev->current_pointer = 0;
+	switch((geometry->page_size << 2) | geometry->address_bytes)
+	{
+		case (8 << 2) | 1:
+			dev->write_pages = i2c_eeprom_write_pages_8_1;
+			break;
+		case (16 << 2) | 1:
+			dev->write_pages = i2c_eeprom_write_pages_16_1;
+			break;
+		case (32 << 2) | 2:
+			dev->write_pages = i2c_eeprom_write_pages_32_2;
+			break;
+		case (64 << 2) | 2:
+			dev->write_pages = i2c_eeprom_write_pages_64_2;
+			break;
+		case (128 << 2) | 2:
+			dev->write_pages = i2c_eeprom_write_pages_128_2;
+			break;
+		case (256 << 2) | 2:
+			dev->write_pages = i2c_eeprom_write_pages_256_2;
+			break;
+		default:
+			dev->write_pages = i2c_eeprom_write_pages_generic;
+			break;
+	}
+	return 0;
+}
+
 /**
 * eeprom_probe - Function to probe EEPROM
 * @client: I2C Client
 * @id: I2C Device ID
 *
-* Returns 0.
+* Returns 0, or -EINVAL if the geometry is not supported.
 * 
 * Description: This function is called when a driver is registerd and a new device
-* 				is plugged in.
+* 				is plugged in. The "pagesize", "size" and "address-width" device tree
+* 				properties override the module parameters.
 */
 static int eeprom_probe(struct i2c_client *client, const struct i2c_device_id * id)
 {
+	struct i2c_EEPROM_geometry geometry = i2c_EEPROM_device_list->geometry;
+	u32 value, sizeBytes = 0;
+
+	if(client->dev.of_node)
+	{
+		if(!of_property_read_u32(client->dev.of_node, "pagesize", &value))
+		{
+			geometry.page_size = value;
+		}
+		if(!of_property_read_u32(client->dev.of_node, "address-width", &value))
+		{
+			geometry.address_bytes = value / 8;
+		}
+		if(!of_property_read_u32(client->dev.of_node, "size", &value))
+		{
+			sizeBytes = value;
+		}
+		if(sizeBytes && geometry.page_size)
+		{
+			geometry.number_of_pages = sizeBytes / geometry.page_size;
+		}
+	}
+	geometry.slave_address = client->addr;
+	if(i2c_eeprom_set_geometry(i2c_EEPROM_device_list, &geometry))
+	{
+		printk("Unsupported EEPROM geometry\n");
+		return -EINVAL;
+	}
 	memcpy(&(i2c_EEPROM_device_list->client),client,sizeof(struct i2c_client));
+	i2c_eeprom_set_transfer_limits(i2c_EEPROM_device_list, client->adapter);
+	i2c_eeprom_measure_bus_speed(i2c_EEPROM_device_list);
     return 0;
 }
 
@@ -118,6 +637,7 @@ static struct i2c_driver eeprom_driver =
   .driver = {
     .name       =  DEVICE_NAME,      		/* Name */
     .owner		= THIS_MODULE,				/* Owner */
+    .of_match_table = of_match_ptr(eeprom_of_match),	/* Device Tree Match */
   },
   .id_table     = eeprom_id_table, 			/* ID */
   .probe 		= eeprom_probe,        		/* Probe Method */
@@ -177,65 +697,30 @@ int i2c_eeprom_release(struct inode *inode, struct file *filp)
 */
 ssize_t i2c_eeprom_write(struct file *filp, const char *buf, size_t count, loff_t *ppos)
 {
-	int retValue,i,j;
-	char *receiveBuffer;
-	char sendBuffer[EEPROM_PAGE_SIZE+2];
-	int tempPointer;
-	if(count < 1 || count > 512)
+	int retValue;
+	if(count < 1 || count > i2c_EEPROM_device_list->geometry.number_of_pages)
 	{
 		printk("Invalid Input for Page Number\n");
 		return -1;
 	}
-	receiveBuffer = kmalloc(count * EEPROM_PAGE_SIZE, GFP_KERNEL);
-	tempPointer = i2c_EEPROM_device_list->current_pointer;
-	//copy contents from userspace to kernel space
-	retValue = copy_from_user(receiveBuffer,buf,(count * EEPROM_PAGE_SIZE));
 	//Switch ON LED before Write Operation Begins
 	gpio_set_value_cansleep(GPIO_LED_PIN, 1);
 	//Turn On Busy Flag
 	i2c_EEPROM_device_list->BUSY_FLAG = 1;
-	
-	if(retValue)
-	{
-		printk("Error: copy from user");
-		gpio_set_value_cansleep(GPIO_LED_PIN, 0); 
-		i2c_EEPROM_device_list->BUSY_FLAG = 0;
-		kfree(receiveBuffer);
-		return -1;
-	}
-
-	for(i=0;i<count;i++)
-	{
-		//Set Address High Byte
-		sendBuffer[0]= ((tempPointer >> 8) & 0xFF);
-		//Set Address Low Byte			
-		sendBuffer[1]= (tempPointer & 0xFF);        			
-		memcpy(&sendBuffer[2], &receiveBuffer[i * EEPROM_PAGE_SIZE], EEPROM_PAGE_SIZE);
-		for (j=0; j<EEPROM_PAGE_SIZE; j++)
-			printk("%c",receiveBuffer[(i * EEPROM_PAGE_SIZE) + j]);
-		//Issue a single I2C message in master transmit mode
-		retValue = i2c_master_send(&(i2c_EEPROM_device_list->client), sendBuffer,sizeof(sendBuffer));
-		if(retValue<0)
-		{
-			printk("Error:i2c_master_send");
-			gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-			i2c_EEPROM_device_list->BUSY_FLAG = 0;
-			kfree(receiveBuffer);
-			return -1;
-		}
-		i2c_EEPROM_device_list->current_pointer = (i2c_EEPROM_device_list->current_pointer) + EEPROM_PAGE_SIZE;
-		//If current position of pointer has reached the last position then reset it back to 0
-		if((i2c_EEPROM_device_list->current_pointer) >= (EEPROM_PAGE_SIZE * NUMBER_OF_PAGES))
-		{
-			i2c_EEPROM_device_list->current_pointer = 0;
-		}
-		tempPointer = i2c_EEPROM_device_list->current_pointer;
-	}
+	//Pages are copied from userspace one at a time while the previous one is programmed
+	retValue = i2c_EEPROM_device_list->write_pages(i2c_EEPROM_device_list, (const char __user *)buf, count);
 	//Switch Off LED after Write Operation Ends
 	gpio_set_value_cansleep(GPIO_LED_PIN, 0);
 	//Turn Off Busy Flag
 	i2c_EEPROM_device_list->BUSY_FLAG = 0;
-	kfree(receiveBuffer);
+	if(retValue<0)
+	{
+		if(retValue == -EFAULT)
+		{
+			printk("Error: copy from user");
+		}
+		return -1;
+	}
 	return 0;
 }
 
@@ -254,32 +739,21 @@ ssize_t i2c_eeprom_read(struct file *filp, char *buf, size_t count, loff_t *ppos
 {
 	int retValue;
 	char *SendBuffer;
-	unsigned char Address[2];
-	int tempPointer;
-	if(count < 1 || count > 512)
+	unsigned int tempPointer;
+	unsigned int pageSize = i2c_EEPROM_device_list->geometry.page_size;
+	if(count < 1 || count > i2c_EEPROM_device_list->geometry.number_of_pages)
 	{
 		printk("Invalid Input for Page Number\n");
 		return -1;
 	}
-	SendBuffer =kzalloc((count*EEPROM_PAGE_SIZE),GFP_KERNEL);
+	SendBuffer =kzalloc((count*pageSize),GFP_KERNEL);
 	tempPointer = i2c_EEPROM_device_list->current_pointer;
 	
-	//Set Address High Byte
-	Address[0] = (unsigned )((tempPointer >> 8) & (0x00FF));
-	//Set Address Low Byte
-	Address[1] = (unsigned )(tempPointer & (0x00FF));
 	//Switch ON LED before Read Operation Begins
 	gpio_set_value_cansleep(GPIO_LED_PIN, 1);
 	i2c_EEPROM_device_list->BUSY_FLAG = 1;
-	//Issue a single I2C message in master transmit mode
-	retValue = i2c_master_send(&(i2c_EEPROM_device_list->client), &Address[0],sizeof(Address));
-	if(retValue < 0)
-	{
-		kfree(SendBuffer);
-		return -1;
-	}
-	//Recieve a single I2C message in master receive mode
-	retValue = i2c_master_recv(&(i2c_EEPROM_device_list->client),SendBuffer,(count*EEPROM_PAGE_SIZE));
+	//Address the chip and receive the data in chunks the adapter accepts
+	retValue = i2c_eeprom_read_data(i2c_EEPROM_device_list, tempPointer, SendBuffer, (count*pageSize));
 	if(retValue < 0)
 	{
 		kfree(SendBuffer);
@@ -288,15 +762,15 @@ ssize_t i2c_eeprom_read(struct file *filp, char *buf, size_t count, loff_t *ppos
 	//Switch OFF LED after Read Operation Ends
 	gpio_set_value_cansleep(GPIO_LED_PIN, 0);
 	i2c_EEPROM_device_list->BUSY_FLAG = 0;
-	i2c_EEPROM_device_list->current_pointer = i2c_EEPROM_device_list->current_pointer + (count*EEPROM_PAGE_SIZE);
+	i2c_EEPROM_device_list->current_pointer = i2c_EEPROM_device_list->current_pointer + (count*pageSize);
 	// If pointer has reached last position then set it to the start position.
-	if((i2c_EEPROM_device_list->current_pointer) >= ((EEPROM_PAGE_SIZE * NUMBER_OF_PAGES) - EEPROM_PAGE_SIZE))
+	if((i2c_EEPROM_device_list->current_pointer) >= (i2c_EEPROM_device_list->size - pageSize))
 	{
 		i2c_EEPROM_device_list->current_pointer = 0;
 	}
 	tempPointer = i2c_EEPROM_device_list->current_pointer;
 
-    retValue = copy_to_user(buf, SendBuffer,(count * EEPROM_PAGE_SIZE));
+    retValue = copy_to_user(buf, SendBuffer,(count * pageSize));
 	if(retValue)
 	{
 		kfree(SendBuffer);
@@ -321,57 +795,41 @@ ssize_t i2c_eeprom_read(struct file *filp, char *buf, size_t count, loff_t *ppos
 static long i2c_eeprom_ioctl(struct file *file, unsigned int arg, unsigned long cmd)
 {
 	short retValue =0;
-	int tempPointer = 0;
-	char tempBuffer[EEPROM_PAGE_SIZE];
-	char sendBuffer[EEPROM_PAGE_SIZE+2];
-	int i=0;
+	unsigned int pageSize = i2c_EEPROM_device_list->geometry.page_size;
 	switch(cmd)
 	{
 		case FLASHGETS:
 			retValue = i2c_EEPROM_device_list->BUSY_FLAG;
 			break;
 		case FLASHGETP:
-			retValue = (i2c_EEPROM_device_list->current_pointer)/(EEPROM_PAGE_SIZE);
+			retValue = (i2c_EEPROM_device_list->current_pointer)/(pageSize);
 			break;
 		case FLASHSETP:
-			if(arg > 511 || arg < 0)
+			if(arg >= i2c_EEPROM_device_list->geometry.number_of_pages)
 			{
 				retValue = -1;
 			}
 			else
 			{
-				i2c_EEPROM_device_list->current_pointer = arg * EEPROM_PAGE_SIZE;
-				retValue = (i2c_EEPROM_device_list->current_pointer)/(EEPROM_PAGE_SIZE);
+				i2c_EEPROM_device_list->current_pointer = arg * pageSize;
+				retValue = (i2c_EEPROM_device_list->current_pointer)/(pageSize);
 			}
 			break;
 		case FLASHERASE:
-			tempPointer = 0;
 			i2c_EEPROM_device_list->current_pointer = 0;
-			for(i=0;i<(EEPROM_PAGE_SIZE);i++)
-				tempBuffer[i] = 0xFF;
-			for(i=0;i<NUMBER_OF_PAGES;i++)
+			if(i2c_eeprom_erase_pages(i2c_EEPROM_device_list)<0)
 			{
-				//Set Address High Byte
-				sendBuffer[0]= ((tempPointer >> 8) & 0xFF);
-				//Set Address Low Byte		
-				sendBuffer[1]= (tempPointer & 0xFF);        			
-				memcpy(&sendBuffer[2], &tempBuffer[0], EEPROM_PAGE_SIZE);
-				gpio_set_value_cansleep(GPIO_LED_PIN, 1);
-				retValue = i2c_master_send(&(i2c_EEPROM_device_list->client), sendBuffer,sizeof(sendBuffer));
-				gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-				if(retValue<0)
-				{
-					printk("Error:i2c_master_send");
-					gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-					return -1;
-				}
-				i2c_EEPROM_device_list->current_pointer = (i2c_EEPROM_device_list->current_pointer) + EEPROM_PAGE_SIZE;
-				tempPointer = i2c_EEPROM_device_list->current_pointer;
-				printk("Page %i Erase Successfull\n",i);
+				return -1;
 			}
 			i2c_EEPROM_device_list->current_pointer = 0;
 			retValue = i2c_EEPROM_device_list->current_pointer;
 			break;
+		case FLASHGETG:
+			if(copy_to_user((void __user *)(unsigned long)arg, &(i2c_EEPROM_device_list->geometry), sizeof(struct i2c_EEPROM_geometry)))
+			{
+				retValue = -EFAULT;
+			}
+			break;
 		default:
 			break;
 	}
@@ -397,11 +855,25 @@ static int __init i2c_eeprom_init(void)
 {
 	int err;
 	struct i2c_adapter *adap;
+	struct i2c_EEPROM_geometry geometry;
 
 	/* Allocate the per-device data structure, i2c_EEPROM_dev */
 	i2c_EEPROM_device_list = kmalloc(sizeof(struct i2c_EEPROM_dev), GFP_KERNEL);
 
 	memset(i2c_EEPROM_device_list, 0, sizeof(struct i2c_EEPROM_dev));
+
+	/* Geometry from the module parameters, the device tree may override it at probe */
+	geometry.page_size       = page_size;
+	geometry.number_of_pages = number_of_pages;
+	geometry.address_bytes   = address_bytes;
+	geometry.slave_address   = slave_address;
+	if(i2c_eeprom_set_geometry(i2c_EEPROM_device_list, &geometry))
+	{
+		printk("Unsupported EEPROM geometry\n");
+		kfree(i2c_EEPROM_device_list);
+		return -EINVAL;
+	}
+	i2c_eeprom_board_info[0].addr = slave_address;
   
 	/* Register and create the /dev interfaces to access the EEPROM banks.  */
 	if(alloc_chrdev_region(&dev_number, I2C_MINOR_NUMBER, 1, DRIVER_NAME) < 0)
@@ -425,7 +897,11 @@ static int __init i2c_eeprom_init(void)
 		return 1;
 	}
 
-	device_create(eep_class, NULL, MKDEV(MAJOR(dev_number), 0), NULL, DEVICE_NAME);
+	i2c_EEPROM_device_list->device = device_create(eep_class, NULL, MKDEV(MAJOR(dev_number), 0), i2c_EEPROM_device_list, DEVICE_NAME);
+	if(sysfs_create_group(&(i2c_EEPROM_device_list->device->kobj), &i2c_eeprom_attr_group))
+	{
+		printk("Creating sysfs attributes failed\n");
+	}
 	err = gpio_request_one(GPIO_MUX_PIN, GPIOF_OUT_INIT_LOW, "Mux");
 	if(err)
 	{
@@ -464,6 +940,7 @@ static int __init i2c_eeprom_init(void)
 */
 static void __exit i2c_eeprom_exit(void)
 {
+	sysfs_remove_group(&(i2c_EEPROM_device_list->device->kobj), &i2c_eeprom_attr_group);
 	device_destroy(eep_class, MKDEV(MAJOR(dev_number), 0));
 	cdev_del(&(i2c_EEPROM_device_list->cdev));
 	class_destroy(eep_class);
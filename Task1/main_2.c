@@ -29,6 +29,24 @@
 #define FLASHGETP			2
 #define FLASHSETP			3
 #define FLASHERASE			4
+#define FLASHGETG			5
+
+/**
+ *  Chip geometry as returned by FLASHGETG
+ */
+struct i2c_EEPROM_geometry
+{
+	unsigned int page_size;
+	unsigned int number_of_pages;
+	unsigned int address_bytes;
+	unsigned int slave_address;
+};
+
+/**
+ * Geometry of the opened EEPROM, defaults until FLASHGETG succeeds
+ */
+unsigned int page_size = EEPROM_PAGE_SIZE;
+unsigned int number_of_pages = NUMBER_OF_PAGES;
 
 void generate_randomString(char *s, const int len);
 
@@ -48,6 +66,7 @@ int main(int argc, char **argv)
 	else
 	{
 		printf("Device Opened Successfully.\n");
+		get_Geometry_EEPROM(fd);
 		while(1)
 		{
 			printf("\nInput command: \n1. Read\n2. Write\n3. FLASHGETS\n4. FLASHGETP\n5. FLASHSETP\n6. FLASHERASE\n7. Exit\n");
@@ -95,11 +114,21 @@ int read_EEPROM(int fd)
 {
 	int retValue,count,cp;
 	unsigned int i,j,k;
-	char buf[EEPROM_PAGE_SIZE * NUMBER_OF_PAGES];
+	char *buf;
 
 	printf("Enter the Number of pages to read from EEPROM\n");
 	scanf("%d",&count);
-	
+	if(count < 1)
+	{
+		printf("Read Failure : invalid number of pages\n");
+		return -1;
+	}
+	buf = (char *)malloc(page_size * count);
+	if(buf == NULL)
+	{
+		printf("Read Failure : out of memory\n");
+		return -1;
+	}
 	cp = ioctl(fd,&k, FLASHGETP);
 	retValue = read(fd,&(buf[0]), count);
 	if (retValue < 0)
@@ -112,13 +141,14 @@ int read_EEPROM(int fd)
 		for(j=0;j<count;j++)
 		{
 			printf("Page %d : ",(j+cp));
-			for(i = 0; i < EEPROM_PAGE_SIZE; i++)
+			for(i = 0; i < page_size; i++)
 			{
-				printf("%c",buf[i + (j*EEPROM_PAGE_SIZE)]);
+				printf("%c",buf[i + (j*page_size)]);
 			}
 			printf("\n");
 		}
 	}
+	free(buf);
 	return retValue;
 }
 
@@ -142,8 +172,8 @@ int write_EEPROM(int fd)
 	printf("Enter the Number of pages to write to EEPROM\n");
 	scanf("%d",&count);
 	
-	writeBuffer = (char *)malloc(count*EEPROM_PAGE_SIZE);
-	generate_randomString(writeBuffer,count*EEPROM_PAGE_SIZE);
+	writeBuffer = (char *)malloc(count*page_size + 1);
+	generate_randomString(writeBuffer,count*page_size);
 	
 	retValue = write(fd, writeBuffer, count);
 	if (retValue < 0)
@@ -223,7 +253,7 @@ int set_Pointer_EEPROM(int fd)
 	int retValue;
 	unsigned int i;
 	
-	printf("Enter the Pointer Set Position (0-511)\n");
+	printf("Enter the Pointer Set Position (0-%u)\n", number_of_pages - 1);
 	scanf("%d",&i);
 	retValue = ioctl(fd,i,FLASHSETP);
 	if(retValue < 0)
@@ -263,6 +293,35 @@ int erase_EEPROM(int fd)
 	return retValue;
 }
 
+/**
+* get_Geometry_EEPROM - Function to get the geometry of EEPROM
+* @fd: File Descriptor
+*
+* Returns 0, or negative value if the driver does not report its geometry.
+* 
+* Description: Fetches page size and number of pages from the driver, so the
+* 				same program works for every supported EEPROM part.
+*/
+int get_Geometry_EEPROM(int fd)
+{
+	int retValue;
+	struct i2c_EEPROM_geometry geometry;
+
+	retValue = ioctl(fd,&geometry,FLASHGETG);
+	if(retValue < 0)
+	{
+		printf("EEPROM Geometry not reported, assuming %u pages of %u bytes\n", number_of_pages, page_size);
+	}
+	else
+	{
+		page_size = geometry.page_size;
+		number_of_pages = geometry.number_of_pages;
+		printf("EEPROM Geometry : %u pages of %u bytes, %u byte address, slave address 0x%x\n",
+			number_of_pages, page_size, geometry.address_bytes, geometry.slave_address);
+	}
+	return retValue;
+}
+
 /**
 * generate_randomString - Function to generate random string of given length
 * @s: File Descriptor
@@ -26,25 +26,152 @@
 #include <asm/uaccess.h>
 #include <linux/string.h>
 #include <linux/workqueue.h>
+#include <linux/kthread.h>
+#include <linux/llist.h>
+#include <linux/percpu.h>
 #include <asm/errno.h>
 #include <linux/delay.h>
+#include <linux/moduleparam.h>
+#include <linux/of.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/version.h>
+#include <linux/spinlock.h>
+#include <linux/list.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/bitmap.h>
+#include <linux/completion.h>
+#include <linux/raid/xor.h>
+#include <linux/seqlock.h>
+#include <linux/crc32.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,9,0) && IS_ENABLED(CONFIG_NVMEM)
+#define I2C_EEPROM_NVMEM
+#include <linux/nvmem-provider.h>
+#endif
 
 /**
  * Define constants using the macro
  */
 #define DRIVER_NAME 		"i2c_flash"
 #define DEVICE_NAME 		"i2c_flash"
-#define WORK_QUEUE_NAME     "i2c_work_queue"
+#define VOLUME_NAME 		"i2c_flash_volume"
+#define LOG_NAME_SUFFIX		"_log"
+#define DISPATCH_THREAD_NAME	"i2c_flash_bus%d"
 #define I2C_MINOR_NUMBER    0
 #define GPIO_LED_PIN        26
 #define GPIO_MUX_PIN        29
 #define SLAVE_ADDRESS       0x54
 #define EEPROM_PAGE_SIZE	64
 #define NUMBER_OF_PAGES		512
+#define MAX_EEPROM_DEVICES	4
+#define VOLUME_NONE			0
+#define VOLUME_STRIPE		1
+#define VOLUME_MIRROR		2
+#define VOLUME_PARITY		3
+#define XOR_BULK_BYTES		512
+#define XOR_ALIGN			64
+#define VOLUME_MAX_PARTS	(2 * MAX_EEPROM_DEVICES)
+#define ADDRESS_BYTES		2
+#define MIN_PAGE_SIZE		8
+#define MAX_PAGE_SIZE		256
+#define MAX_MESSAGE_LENGTH	0xFFFF
+#define TRANSFER_I2C		0
+#define TRANSFER_SMBUS_BLOCK	1
+#define TRANSFER_SMBUS_BYTE	2
+#define ACK_POLL_NONE		0
+#define ACK_POLL_QUICK		1
+#define ACK_POLL_BYTE		2
+#define ACK_POLL_INTERVAL	50
+#define WRITE_CYCLE_TIME	5000
+#define PRIORITY_HIGH		0
+#define PRIORITY_LOW		1
+#define PRIORITY_BACKGROUND	2
+#define NUMBER_OF_PRIORITIES	3
+#define SCRUB_START_DELAY	5000
+#define SCRUB_IDLE_RETRY	100
+#define WARM_UP_PAGES		8
+#define TICKET_HISTORY		256
+#define TICKET_BLOCK		64
+#define LOG_MIN_PAGES		2
+#define LOG_MIN_PAGE_SIZE	16
+#define LOG_BATCH_PAGES		8
 #define FLASHGETS			1
 #define FLASHGETP			2
 #define FLASHSETP			3
 #define FLASHERASE			4
+#define FLASHGETG			5
+#define FLASHERASEP			6
+#define FLASHERASEC			7
+#define FLASHWAIT			8
+#define FLASHFLUSH			9
+#define FLASHCANCEL			10
+#define FLASHSTATUS			11
+#define FLASHCAS			12
+
+/**
+ *  Chip geometry, also returned to user space by FLASHGETG
+ */
+struct i2c_EEPROM_geometry
+{
+  unsigned int page_size;			/* Page size in bytes */
+  unsigned int number_of_pages;		/* Number of pages on the chip */
+  unsigned int address_bytes;		/* Width of the memory address, 1 or 2 */
+  unsigned int slave_address;		/* Slave address of EEPROM */
+};
+
+/**
+ *  Progress of the queued erase, returned to user space by FLASHERASEP
+ */
+struct i2c_EEPROM_progress
+{
+  unsigned int pages_done;			/* Pages erased so far */
+  unsigned int pages_total;			/* Pages to erase */
+  unsigned int status;				/* 'Q'ueued, 'R'unning, 'D'one, 'C'ancelled, 'F'ailed, 0 if none */
+};
+
+/**
+ *  Scheduler state of an EEPROM, returned to user space by FLASHSTATUS
+ */
+struct i2c_EEPROM_status
+{
+  unsigned int queue_depth;			/* Works queued or running */
+  unsigned int current_op;			/* 'R'ead, 'W'rite or 'E'rase last on the bus, 0 if idle */
+  unsigned int current_ticket;		/* Ticket of that work */
+  unsigned int pages_done;			/* Pages of that work done */
+  unsigned int pages_total;			/* Pages of that work */
+  int last_error;					/* Negative errno of the last failed work, 0 if none */
+  unsigned int works_done;			/* Works finished */
+  unsigned int works_failed;		/* Works failed or cancelled */
+  long long queued_ns;				/* When the last work was queued */
+  long long started_ns;				/* When the last work started */
+  long long finished_ns;			/* When the last work finished */
+};
+
+/**
+ *  Compare-and-swap of bytes of one page, passed by user space to FLASHCAS
+ */
+struct i2c_EEPROM_cas
+{
+  unsigned int page;				/* Page to update */
+  unsigned int offset;				/* First byte compared and written, from the start of the page */
+  unsigned int length;				/* Bytes compared and written, offset + length <= page size */
+  char *expected;					/* Bytes the page must hold, set to the bytes it held on a mismatch */
+  const char *desired;				/* Bytes written on a match */
+};
+
+/**
+ *  EEPROMs sharing one I2C adapter, served by one scheduler
+ */
+struct i2c_eeprom_bus
+{
+  int number;						/* I2C adapter number */
+  struct task_struct *thread;		/* Dispatcher thread running the scheduler of the bus */
+  wait_queue_head_t submit_wait;	/* The thread sleeps here while nothing is submitted */
+  struct i2c_EEPROM_dev *devices[MAX_EEPROM_DEVICES];	/* EEPROMs on the adapter */
+  unsigned int number_of_devices;	/* Number of EEPROMs on the adapter */
+  unsigned int next_device;			/* Where the round robin goes on */
+};
 
 /**
  *  Per-device data structure for each
@@ -54,10 +181,176 @@ struct i2c_EEPROM_dev
 {
   struct i2c_client client;      	/* I2C client for EEPROM */
   unsigned int addr;              	/* Slave address of EEPROM */
-  unsigned short current_pointer; 	/* Current Position pointer */
   struct cdev cdev;				  	/* Character Device */
   char name[20];				  	/* Character Device Name */
   unsigned int BUSY_FLAG;		  	/* Busy Flag Status */	
+  struct i2c_EEPROM_geometry geometry;	/* Page size, page count and address width */
+  unsigned int size;				/* Chip size in bytes */
+  int (*write_pages)(struct i2c_EEPROM_dev *, unsigned int *, char *, size_t);	/* Page loop for this geometry */
+  unsigned int frame_size;			/* Address bytes plus one page, as queued writes are kept */
+  struct device *device;			/* Class device carrying the sysfs attributes */
+  unsigned int max_read_len;		/* Largest read message the adapter accepts */
+  unsigned int max_first_read_len;	/* Largest read after the address in a combined transfer */
+  unsigned int combined_read;		/* Adapter accepts write-then-read in one transfer */
+  unsigned int bus_clock;			/* Bus clock from the adapter's device tree node, 0 if unknown */
+  unsigned int bus_speed;			/* Bus speed in Hz measured at probe */
+  unsigned int transfer;			/* TRANSFER_I2C, TRANSFER_SMBUS_BLOCK or TRANSFER_SMBUS_BYTE */
+  unsigned int ack_poll;			/* ACK_POLL_QUICK or ACK_POLL_BYTE finds the end of an SMBus chunk's write cycle, ACK_POLL_NONE waits it out */
+  u64 read_bytes;					/* Bytes read from the chip */
+  u64 read_ns;						/* Time spent on those reads */
+  u64 write_bytes;					/* Bytes written to the chip */
+  u64 write_ns;						/* Time spent on those writes, write cycles excluded */
+  unsigned int erase_done;			/* Pages erased by the queued erase */
+  unsigned int erase_total;			/* Pages the queued erase covers */
+  unsigned int erase_status;		/* Status of the queued erase, as in i2c_EEPROM_progress */
+  unsigned int erase_cancel;		/* Set to stop the queued erase at the next page */
+  unsigned int erase_forwarded;	/* A read was served from the queued erase, it can no longer be cancelled */
+  spinlock_t queue_lock;			/* Protects the queues */
+  struct llist_head __percpu *submit;	/* Works submitted on each CPU but not yet in the queues, newest first */
+  struct list_head queue[NUMBER_OF_PRIORITIES];	/* Pending work, one list per priority class */
+  unsigned int batches;				/* Batches taken off the submission list */
+  unsigned int batched_works;		/* Works in those batches */
+  struct i2c_eeprom_bus *bus;		/* Adapter the EEPROM is on */
+  struct i2c_eeprom_log *log;		/* Circular log node of the EEPROM, NULL if none */
+  unsigned int minor;				/* Minor number of the /dev node */
+  struct i2c_client *client_core;	/* Client registered for the EEPROM at init */
+  ktime_t write_cycle_end;			/* When the chip finishes its last page write */
+  wait_queue_head_t done_wait;		/* Woken whenever a work leaves the queues */
+  unsigned int done_id[TICKET_HISTORY];	/* Tickets of the last finished waitable works, by ticket % TICKET_HISTORY */
+  unsigned char done_status[TICKET_HISTORY];	/* and how they finished, 'D', 'C' or 'F' */
+  struct mutex cache_lock;			/* Protects the write cache */
+  struct mutex rmw_lock;			/* Serialises the read-modify-write of FLASHCAS and nvmem writes */
+#ifdef I2C_EEPROM_NVMEM
+  struct nvmem_device *nvmem;		/* nvmem provider of the EEPROM, NULL if not registered */
+#endif
+  char *cache;						/* Page data of the delayed writes */
+  unsigned long *dirty;				/* Pages of the cache not yet queued to the chip */
+  struct delayed_work flush_work;	/* Timed flush of the write cache */
+  struct delayed_work scrub_work;	/* Queues the next page of the scrub */
+  int scrub_stop;					/* Set on unload, the scrub queues no more pages */
+  u32 *scrub_crc;					/* Checksum of every page as last written or first read */
+  unsigned long *scrub_known;		/* Pages with a checksum in scrub_crc */
+  unsigned int scrub_next;			/* Page the scrub verifies next */
+  ktime_t scrub_queued;				/* When that page was queued */
+  ktime_t scrub_pass_start;			/* When the current pass started */
+  unsigned int scrub_passes;		/* Passes over the whole chip completed */
+  unsigned int scrub_verified;		/* Pages read back by the scrub */
+  unsigned int scrub_bad;			/* Pages that failed the scrub */
+  unsigned int scrub_rate;			/* Pages per second of the last pass */
+  char *warm;						/* Copy of the chip read at probe and kept up to date by the writes */
+  unsigned long *warm_valid;		/* Pages of warm that hold the chip's data */
+  unsigned int warm_pages;			/* Pages read in by the warm-up */
+  int warm_stop;					/* Set on unload, the queued warm-up reads are dropped */
+  ktime_t probed;					/* When the probe finished */
+  s64 warm_time_us;					/* From probe until the whole chip was warm, 0 before */
+  s64 first_read_us;				/* From probe until the first read() got its data, 0 before */
+  unsigned int cache_flushes;		/* Flushes that queued at least one page */
+  unsigned int cache_flushed_pages;	/* Pages queued to the chip by the flushes */
+  unsigned int cache_absorbed_pages;	/* Page writes absorbed by a page already dirty */
+  seqlock_t status_lock;			/* Readers of status retry instead of locking */
+  struct i2c_EEPROM_status status;	/* Scheduler state for FLASHSTATUS */
+};
+
+/**
+ *  State of one open file of an EEPROM
+ */
+struct i2c_eeprom_file
+{
+  s64 last_submitted;				/* Submission time of the newest work of the file, ns */
+  struct i2c_EEPROM_dev *dev;		/* EEPROM opened */
+  unsigned int current_pointer;		/* Current Position pointer */
+  int read_ready;					/* A finished read waits in read_buffer */
+  int read_pending;					/* A read is queued */
+  int read_error;					/* Negative errno of the last failed read, 0 if none */
+  char *read_buffer;				/* Data of the finished read */
+  size_t read_count;				/* Pages in read_buffer */
+};
+
+/**
+ *  Logical device built from all the EEPROMs
+ */
+struct i2c_eeprom_volume
+{
+  struct cdev cdev;					/* Character Device */
+  struct device *device;			/* Class device of the volume */
+  unsigned int mode;				/* VOLUME_STRIPE, VOLUME_MIRROR or VOLUME_PARITY */
+  unsigned int number_of_members;	/* EEPROMs in the volume */
+  struct i2c_EEPROM_dev *members[MAX_EEPROM_DEVICES];	/* EEPROMs in the volume */
+  struct i2c_EEPROM_geometry geometry;	/* Logical page size and page count */
+  int ready;						/* All members probed with one page size, the geometry is from them */
+  unsigned int current_pointer;		/* Current Position pointer */
+  struct mutex lock;				/* Serialises the volume requests */
+};
+
+/**
+ *  Header at the start of every page of a circular log
+ */
+struct i2c_eeprom_log_header
+{
+  __le32 sequence;					/* Number of the page in the log, never 0 or 0xFFFFFFFF */
+  __le16 used;						/* Data bytes after the header */
+  __le16 check;						/* Low half of the CRC-32 of sequence, used and the data */
+};
+
+/**
+ *  Append-only ring in the last pages of an EEPROM
+ */
+struct i2c_eeprom_log
+{
+  struct cdev cdev;					/* Character Device */
+  struct device *device;			/* Class device of the log */
+  char name[24];					/* Character Device Name */
+  struct i2c_EEPROM_dev *dev;		/* EEPROM holding the ring */
+  struct mutex lock;				/* Protects everything below */
+  int ready;						/* Head and tail recovered from the chip */
+  unsigned int first_page;			/* Chip page of ring page 0 */
+  unsigned int number_of_pages;		/* Pages in the ring */
+  unsigned int payload;				/* Data bytes per page */
+  char *frames;						/* Full pages not yet queued, then the open page, as frames */
+  unsigned int batch_first;			/* Ring page of the first frame */
+  unsigned int batch_pages;			/* Full pages in frames */
+  u32 head_sequence;				/* Sequence of the open page */
+  u32 oldest_sequence;				/* Sequence of the oldest page still in the ring */
+  unsigned int used;				/* Data bytes in the open page */
+  unsigned int queued_used;			/* Data bytes of the open page already queued to the chip */
+  unsigned int last_ticket;			/* Ticket of the last pages queued, 0 if none */
+  unsigned int appends;				/* Appends made */
+  unsigned int pages_written;		/* Pages queued to the chip */
+};
+
+/**
+ *  State of one open file of a log
+ */
+struct i2c_eeprom_log_file
+{
+  struct i2c_eeprom_log *log;		/* Log opened */
+  u32 sequence;						/* Page the next read starts in */
+  unsigned int offset;				/* Data byte of that page the next read starts at */
+};
+
+/**
+ *  Member works of one volume request
+ */
+struct i2c_eeprom_volume_io
+{
+  atomic_t pending;					/* Member works not finished yet */
+  struct completion done;			/* Completed when the last member work finishes */
+  int result[VOLUME_MAX_PARTS];		/* Outcome of the work of each part */
+  int detached;						/* Nobody waits, the request is freed by whoever drops pending to 0 */
+};
+
+/**
+ *  Run of pages of a volume request on one member
+ */
+struct i2c_eeprom_volume_part
+{
+  unsigned int member;				/* Member the part is queued to */
+  unsigned int start;				/* First page on the member */
+  unsigned int count;				/* Number of pages */
+  unsigned int index;				/* Request page of the first page */
+  unsigned int stride;				/* Request pages between two pages of the part */
+  unsigned int tried;				/* Members that failed the part */
+  char *buf;						/* Pages of a read, frames of a write */
 };
 
 /**
@@ -65,22 +358,99 @@ struct i2c_EEPROM_dev
  */
 static dev_t dev_number;          					/* Allotted Device Number */
 static struct class *eep_class;   					/* Device class */
-struct i2c_EEPROM_dev *i2c_EEPROM_device_list;     	/* List of private data structures */
-struct i2c_client* client_core = NULL;
-static struct workqueue_struct  *i2c_eeprom_workqueue;
-char *temp_read_buff = NULL;
-char *temp_write_buff = NULL;
-unsigned int WORK_ID_COUNTER=0;
-int ready_to_write_flag=0;
-int ready_to_read_flag=0;
-int ERROR;
-char *tempBuffer = NULL;
+struct i2c_EEPROM_dev *i2c_EEPROM_device_list;     	/* List of private data structures, one per EEPROM */
+struct i2c_eeprom_bus i2c_eeprom_bus_list[MAX_EEPROM_DEVICES];	/* Adapters the EEPROMs are on */
+unsigned int number_of_buses;
+struct i2c_eeprom_volume *i2c_eeprom_volume;		/* Volume over the EEPROMs, NULL if none */
+atomic_t WORK_ID_COUNTER = ATOMIC_INIT(0);
+
+/**
+ *  Tickets a CPU has taken from WORK_ID_COUNTER and not handed out yet
+ */
+struct i2c_eeprom_ticket_block
+{
+  unsigned int next;				/* Next ticket to hand out */
+  unsigned int end;					/* First ticket past the block */
+};
+static DEFINE_PER_CPU(struct i2c_eeprom_ticket_block, i2c_eeprom_ticket_blocks);
+
+/**
+ * Module parameters for the chip geometry, used unless the device tree
+ * describes the EEPROM
+ */
+static unsigned short slave_address[MAX_EEPROM_DEVICES] = { SLAVE_ADDRESS };
+static int number_of_devices = 1;
+module_param_array(slave_address, ushort, &number_of_devices, S_IRUGO);
+MODULE_PARM_DESC(slave_address, "I2C slave addresses of the EEPROMs, one /dev node each (default 0x54)");
+static int i2c_bus[MAX_EEPROM_DEVICES] = { I2C_MINOR_NUMBER };
+static int number_of_i2c_bus;
+module_param_array(i2c_bus, int, &number_of_i2c_bus, S_IRUGO);
+MODULE_PARM_DESC(i2c_bus, "I2C adapter number of each EEPROM (default 0)");
+static char *volume = "none";
+module_param(volume, charp, S_IRUGO);
+MODULE_PARM_DESC(volume, "Build /dev/" VOLUME_NAME " from all the EEPROMs: none, stripe, mirror or parity (default none)");
+static unsigned int page_size = EEPROM_PAGE_SIZE;
+module_param(page_size, uint, S_IRUGO);
+MODULE_PARM_DESC(page_size, "Page size in bytes: 8, 16, 32, 64, 128 or 256 (default 64)");
+static unsigned int number_of_pages = NUMBER_OF_PAGES;
+module_param(number_of_pages, uint, S_IRUGO);
+MODULE_PARM_DESC(number_of_pages, "Number of pages on the chip (default 512)");
+static unsigned int address_bytes = ADDRESS_BYTES;
+module_param(address_bytes, uint, S_IRUGO);
+MODULE_PARM_DESC(address_bytes, "Memory address width in bytes: 1 or 2 (default 2)");
+static unsigned int write_cycle_time = WRITE_CYCLE_TIME;
+module_param(write_cycle_time, uint, S_IRUGO);
+MODULE_PARM_DESC(write_cycle_time, "Page write cycle time in microseconds (default 5000)");
+static unsigned int write_delay;
+module_param(write_delay, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(write_delay, "Keep written pages in RAM for up to this many milliseconds before writing them, 0 writes at once (default 0)");
+static unsigned int scrub_share;
+module_param(scrub_share, uint, S_IRUGO);
+MODULE_PARM_DESC(scrub_share, "Percent of bus time the idle scrub may use, 0 turns it off (default 0)");
+static bool warm_up;
+module_param(warm_up, bool, S_IRUGO);
+MODULE_PARM_DESC(warm_up, "Read the whole chip into RAM in the background after probe and serve reads from it (default 0)");
+static unsigned int log_pages;
+module_param(log_pages, uint, S_IRUGO);
+MODULE_PARM_DESC(log_pages, "Pages at the end of each EEPROM given to its /dev/..." LOG_NAME_SUFFIX " append-only ring, 0 for none (default 0)");
+static unsigned int log_batch = LOG_BATCH_PAGES;
+module_param(log_batch, uint, S_IRUGO);
+MODULE_PARM_DESC(log_batch, "Full log pages kept in RAM and queued to the chip together (default 8)");
 
 /**
  * Functions Declarations
  */
 static ssize_t i2c_eeprom_write_into_queue(struct file *file, const char __user *buf, size_t count, loff_t *offset);
 static ssize_t i2c_eeprom_read_from_queue(struct file *file, char __user *buf, size_t count, loff_t *offset);
+static long i2c_eeprom_erase_into_queue(struct file *file);
+static int i2c_eeprom_dispatch_fn(void *data);
+static long i2c_eeprom_wait_ticket(struct i2c_EEPROM_dev *dev, unsigned int ticket);
+static long i2c_eeprom_flush(struct i2c_EEPROM_dev *dev);
+static long i2c_eeprom_cancel_work(struct i2c_EEPROM_dev *dev, struct file *file, unsigned int ticket);
+static void i2c_eeprom_read_status(struct i2c_EEPROM_dev *dev, struct i2c_EEPROM_status *status);
+static int i2c_eeprom_flush_cache(struct i2c_EEPROM_dev *dev);
+static void i2c_eeprom_flush_cache_fn(struct work_struct *work);
+static long i2c_eeprom_compare_and_swap(struct i2c_EEPROM_dev *dev, struct i2c_EEPROM_cas __user *user);
+static void i2c_eeprom_scrub_fn(struct work_struct *work);
+static void i2c_eeprom_scrub_record(struct i2c_EEPROM_dev *dev, unsigned int page, const char *data);
+static int i2c_eeprom_volume_open(struct inode *inode, struct file *file);
+static ssize_t i2c_eeprom_volume_read(struct file *file, char __user *buf, size_t count, loff_t *offset);
+static ssize_t i2c_eeprom_volume_write(struct file *file, const char __user *buf, size_t count, loff_t *offset);
+static long i2c_eeprom_volume_ioctl(struct file *file, unsigned int arg, unsigned long cmd);
+static int i2c_eeprom_volume_setup(void);
+static void i2c_eeprom_volume_update(void);
+static void i2c_eeprom_log_recover(struct i2c_EEPROM_dev *dev);
+static int i2c_eeprom_log_sync(struct i2c_eeprom_log *log);
+static int i2c_eeprom_log_open(struct inode *inode, struct file *file);
+static int i2c_eeprom_log_release(struct inode *inode, struct file *file);
+static ssize_t i2c_eeprom_log_read(struct file *file, char __user *buf, size_t count, loff_t *offset);
+static ssize_t i2c_eeprom_log_write(struct file *file, const char __user *buf, size_t count, loff_t *offset);
+static int i2c_eeprom_log_fsync(struct file *file, loff_t start, loff_t end, int datasync);
+static long i2c_eeprom_log_ioctl(struct file *file, unsigned int arg, unsigned long cmd);
+#ifdef I2C_EEPROM_NVMEM
+static void i2c_eeprom_nvmem_register(struct i2c_EEPROM_dev *dev, struct i2c_client *client);
+static void i2c_eeprom_nvmem_unregister(struct i2c_EEPROM_dev *dev);
+#endif
 
 /**
  *  Data structure for data to be passed to workers thread.
@@ -98,13 +468,28 @@ typedef struct QUEUE_DATA_TAG
  */
 typedef struct I2C_WORK_QUEUE_TAG
 {
-	struct work_struct 	work;
+	struct list_head 	list;			/* Entry in the queue of its priority class */
+	struct llist_node	submit;			/* Entry in the submission list until the queues take it */
+	s64					submitted;		/* Submission time, ns, orders the works of all CPUs */
 	unsigned char 		read_or_write;
 	unsigned char 		status_Flag;
 	unsigned int       	work_id;
+	unsigned int		priority;		/* PRIORITY_HIGH for reads, PRIORITY_LOW for writes and erases, PRIORITY_BACKGROUND for scrub and warm-up reads */
+	unsigned int		start;			/* Memory offset the work starts at */
+	unsigned int		pages_done;		/* Pages written so far by a write or erase */
+	unsigned long		*covered;		/* Pages of a read served without the chip */
+	struct i2c_eeprom_volume_io *io;	/* Volume request the work is part of, or NULL */
+	unsigned int		part;			/* Part of that request */
+	unsigned char		waited;			/* Ticket handed out to a caller, how the work finishes is recorded */
+	unsigned char		forwarded;		/* A read was served from the write, it can no longer be cancelled */
 	QUEUE_DATA 			queue_Data;
 } I2C_WORK_QUEUE;
 
+static void i2c_eeprom_finish_work(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work, int result);
+static void i2c_eeprom_scrub_done(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work, int result);
+static void i2c_eeprom_warm_done(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work, int result);
+static int i2c_eeprom_warm_up(struct i2c_EEPROM_dev *dev);
+
 /**
  *  Data structure for i2c device id of EEPROM
  */
@@ -113,638 +498,5073 @@ static struct i2c_device_id eeprom_id_table[] = {
 };
 
 /**
-* eeprom_probe - Function to probe EEPROM
-* @client: I2C Client
-* @id: I2C Device ID
+ *  Data structure for device tree match of EEPROM
+ */
+static const struct of_device_id eeprom_of_match[] = {
+	{ .compatible = "asu,i2c_flash" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, eeprom_of_match);
+
+/**
+* i2c_eeprom_chip_address - Function to get the slave address for a memory offset
+* @dev: EEPROM device
+* @offset: Memory offset
 *
-* Returns 0.
+* Returns slave address.
 * 
-* Description: This function is called when a driver is registerd and a new device
-* 				is plugged in.
+* Description: One byte address parts larger than 256 bytes (24C04 - 24C16) carry
+* 				the upper address bits in the low bits of the slave address.
 */
-static int eeprom_probe(struct i2c_client *client, const struct i2c_device_id * id)
+static inline unsigned short i2c_eeprom_chip_address(struct i2c_EEPROM_dev *dev, unsigned int offset)
 {
-	memcpy(&(i2c_EEPROM_device_list->client),client,sizeof(struct i2c_client));
-    return 0;
+	if(dev->geometry.address_bytes == 1)
+	{
+		return dev->client.addr | ((offset >> 8) & 0x07);
+	}
+	return dev->client.addr;
 }
 
 /**
-* eeprom_remove - Function to probe EEPROM
-* @client: I2C Client
+* i2c_eeprom_wait_write_cycle - Function to wait for the chip to finish its page write
+* @dev: EEPROM device
 *
-* Returns 0.
+* Returns void.
 * 
-* Description: This function is called when a driver is registerd and a already
-* 	plugged in device is plugged out.
+* Description: The chip does not answer while it programs a page, so every transfer
+* 				waits out what is left of the write cycle of the last page sent.
 */
-static int eeprom_remove(struct i2c_client *client)
+static void i2c_eeprom_wait_write_cycle(struct i2c_EEPROM_dev *dev)
 {
-    return 0;
+	s64 remaining = ktime_us_delta(dev->write_cycle_end, ktime_get());
+
+	if(remaining > 0)
+	{
+		usleep_range(remaining, remaining + 100);
+	}
 }
 
 /**
-* This is Board Info Structure, which gives details about the devices on
-* the board for driver.
+* i2c_eeprom_smbus_ack_poll - Function to wait until the chip answers again after a write
+* @dev: EEPROM device
+* @address: Memory offset of the frame, gives the slave address to poll
+*
+* Returns void.
+* 
+* Description: The chip does not acknowledge its address while it programs, so
+* 				a quick write, or else a byte read, is retried every
+* 				ACK_POLL_INTERVAL microseconds until it does. The write cycle
+* 				time is the upper bound, the chip is done by then in any case.
+* 				Adapters with neither transfer wait the whole cycle.
 */
-static struct i2c_board_info i2c_eeprom_board_info[] = {
+static void i2c_eeprom_smbus_ack_poll(struct i2c_EEPROM_dev *dev, unsigned int address)
+{
+	ktime_t deadline = ktime_add_us(ktime_get(), write_cycle_time);
+	union i2c_smbus_data data;
+	int retValue;
+
+	dev->write_cycle_end = deadline;
+	if(dev->ack_poll == ACK_POLL_NONE)
 	{
-		I2C_BOARD_INFO(DEVICE_NAME, SLAVE_ADDRESS),
+		i2c_eeprom_wait_write_cycle(dev);
+		return;
 	}
-};
+	while(ktime_before(ktime_get(), deadline))
+	{
+		if(dev->ack_poll == ACK_POLL_QUICK)
+		{
+			retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, address), 0, I2C_SMBUS_WRITE,
+				0, I2C_SMBUS_QUICK, NULL);
+		}
+		else
+		{
+			retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, address), 0, I2C_SMBUS_READ,
+				0, I2C_SMBUS_BYTE, &data);
+		}
+		if(retValue >= 0)
+		{
+			dev->write_cycle_end = ktime_get();
+			return;
+		}
+		usleep_range(ACK_POLL_INTERVAL, 2 * ACK_POLL_INTERVAL);
+	}
+}
 
 /**
-* This is I2C Driver Structure.
+* i2c_eeprom_smbus_send - Function to write a frame with SMBus transfers
+* @dev: EEPROM device
+* @offset: Memory offset the frame is addressed to
+* @buffer: Address bytes followed by the payload
+* @length: Length of buffer
+*
+* Returns negative errno, or else 1.
+* 
+* Description: The first address byte goes in the SMBus command, a 16 bit
+* 				address carries its low byte in front of the data. I2C block
+* 				writes take up to 32 bytes, byte mode one byte per transfer. Each
+* 				transfer starts a write cycle of its own, the next chunk of a frame
+* 				is sent as soon as the chip acknowledges again, see
+* 				i2c_eeprom_smbus_ack_poll(). Only the transfers count in write_ns,
+* 				not the write cycles between them, as for a single I2C message.
 */
-static struct i2c_driver eeprom_driver =
+static int i2c_eeprom_smbus_send(struct i2c_EEPROM_dev *dev, unsigned int offset, char *buffer, int length)
 {
-  .driver = {
-    .name       = DEVICE_NAME,      		/* Name */
-    .owner		= THIS_MODULE,				/* Owner */
-  },
-  .id_table     = eeprom_id_table, 			/* ID */
-  .probe 		= eeprom_probe,        		/* Probe Method */
-  .remove  		= eeprom_remove,       		/* Remove Method */
-};
+	unsigned int addressBytes = dev->geometry.address_bytes;
+	unsigned int payload = length - addressBytes;
+	unsigned int maxChunk, chunk, done, address;
+	union i2c_smbus_data data;
+	ktime_t start;
+	int retValue = 0;
+
+	maxChunk = (dev->transfer == TRANSFER_SMBUS_BLOCK) ? (I2C_SMBUS_BLOCK_MAX - (addressBytes - 1)) : 1;
+	for(done = 0; done < payload && retValue >= 0; done += chunk)
+	{
+		chunk = min(payload - done, maxChunk);
+		address = offset + done;
+		if(done != 0)
+		{
+			i2c_eeprom_smbus_ack_poll(dev, offset);
+		}
+		start = ktime_get();
+		if(dev->transfer == TRANSFER_SMBUS_BLOCK)
+		{
+			data.block[0] = chunk + addressBytes - 1;
+			data.block[1] = address & 0xFF;
+			memcpy(&data.block[addressBytes], &buffer[addressBytes + done], chunk);
+			retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, address), 0, I2C_SMBUS_WRITE,
+				(addressBytes == 2) ? ((address >> 8) & 0xFF) : (address & 0xFF), I2C_SMBUS_I2C_BLOCK_DATA, &data);
+		}
+		else if(addressBytes == 2)
+		{
+			data.word = (address & 0xFF) | ((u8)buffer[addressBytes + done] << 8);
+			retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, address), 0, I2C_SMBUS_WRITE,
+				(address >> 8) & 0xFF, I2C_SMBUS_WORD_DATA, &data);
+		}
+		else
+		{
+			data.byte = buffer[addressBytes + done];
+			retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, address), 0, I2C_SMBUS_WRITE,
+				address & 0xFF, I2C_SMBUS_BYTE_DATA, &data);
+		}
+		if(retValue >= 0)
+		{
+			dev->write_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		}
+	}
+	return (retValue < 0) ? retValue : 1;
+}
 
 /**
-* eeprom_open - Function called when EEPROM device is opened for use.
-* @client: I2C Client
+* i2c_eeprom_send - Function to write a frame to the chip
+* @dev: EEPROM device
+* @offset: Memory offset the message is addressed to
+* @buffer: Address bytes followed by the payload
+* @length: Length of buffer
 *
-* Returns 0.
+* Returns negative errno, or else the number of messages sent.
 * 
-* Description: This function is called when a driver is registerd and a already
-* 	plugged in device is plugged out.
+* Description: A single I2C message where the adapter can do plain I2C, or else
+* 				SMBus transfers.
 */
-static int i2c_eeprom_open(struct inode *inode, struct file *file)
+static int i2c_eeprom_send(struct i2c_EEPROM_dev *dev, unsigned int offset, char *buffer, int length)
 {
-	int ret;
-	//Setting Current Pointer Position to 0 for first time.
-	i2c_EEPROM_device_list->current_pointer = 0;
-	ret = gpio_request_one(GPIO_LED_PIN, GPIOF_OUT_INIT_LOW, "Led");
-	if(ret)
+	struct i2c_msg msg;
+	ktime_t start;
+	int retValue;
+
+	if(dev->transfer == TRANSFER_I2C)
 	{
-		//printk("LED ERROR");
+		msg.addr  = i2c_eeprom_chip_address(dev, offset);
+		msg.flags = 0;
+		msg.len   = length;
+		msg.buf   = buffer;
+		start = ktime_get();
+		retValue = i2c_transfer(dev->client.adapter, &msg, 1);
+		if(retValue >= 0)
+		{
+			dev->write_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		}
 	}
-	gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-	i2c_EEPROM_device_list->BUSY_FLAG = 0;
-	ready_to_write_flag  = 0;
-	ready_to_read_flag   = 0;
-	return 0;
+	else
+	{
+		//Times its transfers itself, leaving out the write cycles between chunks
+		retValue = i2c_eeprom_smbus_send(dev, offset, buffer, length);
+	}
+	if(retValue >= 0)
+	{
+		dev->write_bytes += length - dev->geometry.address_bytes;
+	}
+	return retValue;
 }
 
 /**
-* i2c_eeprom_release - Function called during release of EEPROM.
-* @inode: Inodes
-* @filp: Fle Pointer
+* i2c_eeprom_set_address - Function to place a memory offset at the start of a message
+* @buffer: Message buffer
+* @offset: Memory offset
+* @addressBytes: Width of the memory address
 *
-* Returns 0.
-* 
+* Returns void.
 */
-int i2c_eeprom_release(struct inode *inode, struct file *filp)
+static __always_inline void i2c_eeprom_set_address(char *buffer, unsigned int offset, const unsigned int addressBytes)
 {
-	return 0;
+	if(addressBytes == 2)
+	{
+		//Set Address High Byte
+		buffer[0] = ((offset >> 8) & 0xFF);
+	}
+	//Set Address Low Byte
+	buffer[addressBytes - 1] = (offset & 0xFF);
 }
 
 /**
-* i2c_eeprom_write - Function called to write message into EEPROM.
-* @filp: I2C Client
-* @buf:Buffer Space
-* @count:Count to hold number of pages
-* @ppos:offset
+* i2c_eeprom_smbus_read - Function to read a block of memory with SMBus transfers
+* @dev: EEPROM device
+* @offset: Memory offset to read from
+* @buffer: Buffer for the data
+* @length: Number of bytes
 *
-* Returns 0.
+* Returns negative errno, or else 0.
 * 
-* Description: This function is called when a driver is registerd and a already
-* 	plugged in device is plugged out.
+* Description: One byte address parts are read in I2C block reads of 32 bytes,
+* 				the command byte being the address. Otherwise the address is set
+* 				with a write and the bytes come one by one as current address reads.
 */
-static ssize_t i2c_eeprom_write(struct file *filp, const char *buf, size_t count, loff_t *ppos)
+static int i2c_eeprom_smbus_read(struct i2c_EEPROM_dev *dev, unsigned int offset, char *buffer, unsigned int length)
 {
-	int retValue,i;
-	char *receiveBuffer;
-	char sendBuffer[EEPROM_PAGE_SIZE+2];
-	int tempPointer;
-	//printk("i2c_flash.c: i2c_eeprom_write: Start\n");
-	receiveBuffer = kmalloc(count * EEPROM_PAGE_SIZE, GFP_KERNEL);
-	tempPointer = i2c_EEPROM_device_list->current_pointer;
-	//copy contents from userspace to kernel space
-	retValue = copy_from_user(receiveBuffer,buf,(count * EEPROM_PAGE_SIZE));
-
-	if(retValue)
-	{
-		printk("Error: copy from user");
-		gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-		i2c_EEPROM_device_list->BUSY_FLAG = 0;
-		kfree(receiveBuffer);
-		return -1;
-	}
+	union i2c_smbus_data data;
+	unsigned int chunk, done;
+	int retValue = 0;
 
-	for(i=0;i<count;i++)
+	if(dev->transfer == TRANSFER_SMBUS_BLOCK && dev->geometry.address_bytes == 1)
 	{
-		//Switch ON LED before Write Operation Begins
-		gpio_set_value_cansleep(GPIO_LED_PIN, 1);
-		//Turn On Busy Flag
-		i2c_EEPROM_device_list->BUSY_FLAG = 1;
-	
-		//Set Address High Byte
-		sendBuffer[0]= ((tempPointer >> 8) & 0xFF);
-		//Set Address Low Byte
-		sendBuffer[1]= (tempPointer & 0xFF);
-		memcpy(&sendBuffer[2], &receiveBuffer[i * EEPROM_PAGE_SIZE], EEPROM_PAGE_SIZE);
-
-		//Issue a single I2C message in master transmit mode
-		retValue = i2c_master_send(&(i2c_EEPROM_device_list->client), sendBuffer,sizeof(sendBuffer));
-		if(retValue<0)
-		{
-			printk("Error:i2c_master_send");
-			ready_to_write_flag = -1;
-			gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-			i2c_EEPROM_device_list->BUSY_FLAG = 0;
-			kfree(receiveBuffer);
-			return -1;
-		}
-		else
+		for(done = 0; done < length && retValue >= 0; done += chunk)
 		{
-			ready_to_write_flag = 1;
+			chunk = min(length - done, (unsigned int)I2C_SMBUS_BLOCK_MAX);
+			data.block[0] = chunk;
+			retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, offset + done), 0, I2C_SMBUS_READ,
+				(offset + done) & 0xFF, I2C_SMBUS_I2C_BLOCK_DATA, &data);
+			memcpy(&buffer[done], &data.block[1], chunk);
 		}
-		i2c_EEPROM_device_list->current_pointer = (i2c_EEPROM_device_list->current_pointer) + EEPROM_PAGE_SIZE;
-		//If current position of pointer has reached the last position then reset it back to 0
-		if((i2c_EEPROM_device_list->current_pointer) >= (EEPROM_PAGE_SIZE * NUMBER_OF_PAGES))
-		{
-			i2c_EEPROM_device_list->current_pointer = 0;
-		}
-		tempPointer = i2c_EEPROM_device_list->current_pointer;
-		
-		//Switch Off LED after Write Operation Ends
-		gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-		//Turn Off Busy Flag
-		i2c_EEPROM_device_list->BUSY_FLAG = 0;
+		return (retValue < 0) ? retValue : 0;
 	}
-	kfree(receiveBuffer);
-	msleep_interruptible(3);
-	//printk("i2c_flash.c: i2c_eeprom_write: End\n");
-	return 0;
+	if(dev->geometry.address_bytes == 2)
+	{
+		data.byte = offset & 0xFF;
+		retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, offset), 0, I2C_SMBUS_WRITE,
+			(offset >> 8) & 0xFF, I2C_SMBUS_BYTE_DATA, &data);
+	}
+	else
+	{
+		retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, offset), 0, I2C_SMBUS_WRITE,
+			offset & 0xFF, I2C_SMBUS_BYTE, NULL);
+	}
+	for(done = 0; done < length && retValue >= 0; done++)
+	{
+		retValue = i2c_smbus_xfer(dev->client.adapter, i2c_eeprom_chip_address(dev, offset + done), 0, I2C_SMBUS_READ,
+			0, I2C_SMBUS_BYTE, &data);
+		buffer[done] = data.byte;
+	}
+	return (retValue < 0) ? retValue : 0;
 }
 
 /**
-* i2c_eeprom_read - Function to read EEPROM
-* @filp: File Pointer
-* @buf:Buffer
-* @count:Number of Pages
-* @ppos:Position Pointer
+* i2c_eeprom_read_data - Function to read a block of memory in adapter sized chunks
+* @dev: EEPROM device
+* @offset: Memory offset to read from
+* @buffer: Buffer for the data
+* @length: Number of bytes
 *
-* Returns 0.
+* Returns negative errno, or else 0.
 * 
-* Description: This function is called to read data from EEPROM
+* Description: The address write and the first chunk go out as one combined
+* 				transfer. The chip keeps counting, so the remaining chunks are issued
+* 				back to back as current address reads without addressing it again.
+* 				Adapters without plain I2C are read with SMBus transfers.
 */
-static ssize_t i2c_eeprom_read(struct file *filp, char *buf, size_t count, loff_t *ppos)
+static int i2c_eeprom_read_data(struct i2c_EEPROM_dev *dev, unsigned int offset, char *buffer, unsigned int length)
 {
+	struct i2c_msg msg[2];
+	char Address[2];
+	unsigned int chunk, done;
+	ktime_t start;
 	int retValue;
-	unsigned char Address[2];
-	int tempPointer;
 
-	//printk("i2c_flash.c: i2c_eeprom_read: Start\n");
-	tempPointer = i2c_EEPROM_device_list->current_pointer;
-	
-	tempBuffer =kzalloc((count*EEPROM_PAGE_SIZE),GFP_KERNEL);
-	if(tempBuffer == NULL)
+	i2c_eeprom_wait_write_cycle(dev);
+	start = ktime_get();
+	if(dev->transfer != TRANSFER_I2C)
 	{
-		printk("tempBuffer : Failure in malloc during read\n");
-		return -ENOMEM;
+		retValue = i2c_eeprom_smbus_read(dev, offset, buffer, length);
+		goto out;
 	}
-	
-	//Set Address High Byte
-	Address[0] = (unsigned )((tempPointer >> 8) & (0x00FF));
-	//Set Address Low Byte
-	Address[1] = (unsigned )(tempPointer & (0x00FF));
-	//Switch ON LED before Read Operation Begins
-	gpio_set_value_cansleep(GPIO_LED_PIN, 1);
-	i2c_EEPROM_device_list->BUSY_FLAG = 1;
-	//Issue a single I2C message in master transmit mode
-	retValue = i2c_master_send(&(i2c_EEPROM_device_list->client), &Address[0],sizeof(Address));
-	if(retValue < 0)
+	i2c_eeprom_set_address(Address, offset, dev->geometry.address_bytes);
+	msg[0].addr  = i2c_eeprom_chip_address(dev, offset);
+	msg[0].flags = 0;
+	msg[0].len   = dev->geometry.address_bytes;
+	msg[0].buf   = Address;
+	msg[1].addr  = msg[0].addr;
+	msg[1].flags = I2C_M_RD;
+	if(dev->combined_read)
 	{
-		return -1;
+		chunk = min(length, dev->max_first_read_len);
+		msg[1].len = chunk;
+		msg[1].buf = buffer;
+		retValue = i2c_transfer(dev->client.adapter, msg, 2);
 	}
 	else
 	{
-		msleep_interruptible(3);
-	}
-	//Receive a single I2C message in master receive mode
-	retValue = i2c_master_recv(&(i2c_EEPROM_device_list->client),tempBuffer,(count*EEPROM_PAGE_SIZE));
-	if(retValue < 0)
-	{
-		i2c_EEPROM_device_list->BUSY_FLAG = 0;
-		ready_to_read_flag = 0;
-		return -1;
+		chunk = 0;
+		retValue = i2c_transfer(dev->client.adapter, msg, 1);
 	}
-	else
+	for(done = chunk; retValue >= 0 && done < length; done += chunk)
 	{
-		ready_to_read_flag = 1;
+		chunk = min(length - done, dev->max_read_len);
+		msg[1].addr = i2c_eeprom_chip_address(dev, offset + done);
+		msg[1].len  = chunk;
+		msg[1].buf  = &buffer[done];
+		retValue = i2c_transfer(dev->client.adapter, &msg[1], 1);
 	}
-	//Switch OFF LED after Read Operation Ends
-	gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-	i2c_EEPROM_device_list->BUSY_FLAG = 0;
-	i2c_EEPROM_device_list->current_pointer = i2c_EEPROM_device_list->current_pointer + (count*EEPROM_PAGE_SIZE);
-	// If pointer has reached last position then set it to the start position.
-	if((i2c_EEPROM_device_list->current_pointer) >= ((EEPROM_PAGE_SIZE * NUMBER_OF_PAGES) - EEPROM_PAGE_SIZE))
+out:
+	if(retValue >= 0)
 	{
-		i2c_EEPROM_device_list->current_pointer = 0;
+		dev->read_bytes += length;
+		dev->read_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
 	}
-	tempPointer = i2c_EEPROM_device_list->current_pointer;
-
-	//printk("i2c_flash.c: i2c_eeprom_read: End\n");
-    return 0;
+	return (retValue < 0) ? retValue : 0;
 }
 
 /**
-* i2c_eeprom_ioctl - Function to perform IOCTL operations
-* @file: File Pointer
-* @arg: Arguments to the functions
-* @cmd: Command to perform specific functions
+* i2c_eeprom_select_transfer - Function to pick the fastest transfer the adapter supports
+* @dev: EEPROM device
+* @adapter: Adapter the EEPROM sits on
 *
-* Returns pointer position, no of pages erased.
+* Returns 0, or -EPFNOSUPPORT if the adapter can not drive the EEPROM.
 * 
-* Description: This function is called to perform ioctl functions like 
-* set pointer positions, get pointer positions, erase eeprom and to check the 
-* status of the EEPROM.
+* Description: Plain I2C first, then SMBus I2C block transfers and last single
+* 				bytes. Block mode reads two byte address parts byte by byte, so
+* 				it needs the byte transfers for them as well. The SMBus modes
+* 				also pick the transfer that polls the chip between chunks.
 */
-static long i2c_eeprom_ioctl(struct file *file, unsigned int arg, unsigned long cmd)
+static int i2c_eeprom_select_transfer(struct i2c_EEPROM_dev *dev, struct i2c_adapter *adapter)
 {
-	long retValue =0;
-	int tempPointer = 0;
-	char tempIOCTLBuffer[EEPROM_PAGE_SIZE];
-	char sendBuffer[EEPROM_PAGE_SIZE+2];
-	int i=0;
-	//printk(KERN_INFO "i2c_flash.c: eep_ioctl: Start\n");
-	switch(cmd)
+	u32 byteFunctions = I2C_FUNC_SMBUS_READ_BYTE;
+
+	dev->ack_poll = ACK_POLL_NONE;
+	if(i2c_check_functionality(adapter, I2C_FUNC_SMBUS_QUICK))
 	{
-		case FLASHGETS:
-			{
-				retValue = i2c_EEPROM_device_list->BUSY_FLAG;
-			    break;
-			}
-		case FLASHGETP:
-			{
-				retValue = (i2c_EEPROM_device_list->current_pointer)/(EEPROM_PAGE_SIZE);
-			    break;
-			}
-		case FLASHSETP:
-			{
-				if(arg > 511 || arg < 0)
-				{
-					retValue = -1;
-				}
-				else
+		dev->ack_poll = ACK_POLL_QUICK;
+	}
+	else if(i2c_check_functionality(adapter, I2C_FUNC_SMBUS_READ_BYTE))
+	{
+		dev->ack_poll = ACK_POLL_BYTE;
+	}
+
+	if(i2c_check_functionality(adapter, I2C_FUNC_I2C))
+	{
+		dev->transfer = TRANSFER_I2C;
+		return 0;
+	}
+	if(dev->geometry.address_bytes == 2)
+	{
+		byteFunctions |= I2C_FUNC_SMBUS_WRITE_BYTE_DATA;
+	}
+	else
+	{
+		byteFunctions |= I2C_FUNC_SMBUS_WRITE_BYTE;
+	}
+	if(i2c_check_functionality(adapter, I2C_FUNC_SMBUS_I2C_BLOCK) &&
+		(dev->geometry.address_bytes == 1 || i2c_check_functionality(adapter, byteFunctions)))
+	{
+		dev->transfer = TRANSFER_SMBUS_BLOCK;
+		return 0;
+	}
+	byteFunctions |= (dev->geometry.address_bytes == 2) ? I2C_FUNC_SMBUS_WRITE_WORD_DATA : I2C_FUNC_SMBUS_WRITE_BYTE_DATA;
+	if(i2c_check_functionality(adapter, byteFunctions))
+	{
+		dev->transfer = TRANSFER_SMBUS_BYTE;
+		return 0;
+	}
+	return -EPFNOSUPPORT;
+}
+
+/**
+* i2c_eeprom_set_transfer_limits - Function to size read chunks for the adapter
+* @dev: EEPROM device
+* @adapter: Adapter the EEPROM sits on
+*
+* Returns void.
+* 
+* Description: Reads are split to the adapter's quirks when it declares any,
+* 				otherwise to the largest length an I2C message can carry.
+*/
+static void i2c_eeprom_set_transfer_limits(struct i2c_EEPROM_dev *dev, struct i2c_adapter *adapter)
+{
+	u32 value;
+
+	dev->max_read_len = MAX_MESSAGE_LENGTH;
+	dev->max_first_read_len = MAX_MESSAGE_LENGTH;
+	dev->combined_read = 1;
+	if(dev->transfer != TRANSFER_I2C)
+	{
+		dev->max_read_len = (dev->transfer == TRANSFER_SMBUS_BLOCK && dev->geometry.address_bytes == 1) ? I2C_SMBUS_BLOCK_MAX : 1;
+		dev->max_first_read_len = dev->max_read_len;
+		dev->combined_read = 0;
+	}
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,1,0)
+	if(adapter->quirks)
+	{
+		if(adapter->quirks->max_read_len)
+		{
+			dev->max_read_len = min_t(unsigned int, dev->max_read_len, adapter->quirks->max_read_len);
+		}
+		dev->max_first_read_len = dev->max_read_len;
+		if(adapter->quirks->max_comb_2nd_msg_len)
+		{
+			dev->max_first_read_len = min_t(unsigned int, dev->max_first_read_len, adapter->quirks->max_comb_2nd_msg_len);
+		}
+		if(adapter->quirks->max_num_msgs == 1)
+		{
+			dev->combined_read = 0;
+		}
+	}
+#endif
+	dev->bus_clock = 0;
+	if(adapter->dev.of_node && !of_property_read_u32(adapter->dev.of_node, "clock-frequency", &value))
+	{
+		dev->bus_clock = value;
+	}
+}
+
+/**
+* i2c_eeprom_measure_bus_speed - Function to measure the effective bus speed
+* @dev: EEPROM device
+*
+* Returns void.
+* 
+* Description: Times a one page read from offset 0 and counts nine clocks for
+* 				every byte on the wire (slave address, memory address and data).
+*/
+static void i2c_eeprom_measure_bus_speed(struct i2c_EEPROM_dev *dev)
+{
+	char probeBuffer[MAX_PAGE_SIZE];
+	unsigned int bits;
+	ktime_t start;
+	s64 elapsed;
+
+	dev->bus_speed = 0;
+	start = ktime_get();
+	if(i2c_eeprom_read_data(dev, 0, probeBuffer, dev->geometry.page_size) < 0)
+	{
+		printk("Bus speed measurement failed\n");
+		return;
+	}
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+	bits = (2 + (dev->combined_read ? 0 : 1) + dev->geometry.address_bytes + dev->geometry.page_size) * 9;
+	if(elapsed > 0)
+	{
+		dev->bus_speed = div64_u64((u64)bits * NSEC_PER_SEC, elapsed);
+	}
+	printk("EEPROM bus speed %u Hz (adapter clock %u Hz), reads split at %u bytes\n",
+		dev->bus_speed, dev->bus_clock, dev->max_read_len);
+}
+
+/**
+ * Sysfs attributes of the EEPROM class device
+ */
+static ssize_t bus_speed_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->bus_speed);
+}
+static DEVICE_ATTR(bus_speed, S_IRUGO, bus_speed_show, NULL);
+
+static ssize_t bus_clock_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->bus_clock);
+}
+static DEVICE_ATTR(bus_clock, S_IRUGO, bus_clock_show, NULL);
+
+static ssize_t max_read_len_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->max_read_len);
+}
+static DEVICE_ATTR(max_read_len, S_IRUGO, max_read_len_show, NULL);
+
+static ssize_t transfer_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%s\n", (dev->transfer == TRANSFER_I2C) ? "i2c" :
+		(dev->transfer == TRANSFER_SMBUS_BLOCK) ? "smbus-block" : "smbus-byte");
+}
+static DEVICE_ATTR(transfer, S_IRUGO, transfer_show, NULL);
+
+static ssize_t read_throughput_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%llu\n", dev->read_ns ? div64_u64(dev->read_bytes * NSEC_PER_SEC, dev->read_ns) : 0);
+}
+static DEVICE_ATTR(read_throughput, S_IRUGO, read_throughput_show, NULL);
+
+static ssize_t write_throughput_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%llu\n", dev->write_ns ? div64_u64(dev->write_bytes * NSEC_PER_SEC, dev->write_ns) : 0);
+}
+static DEVICE_ATTR(write_throughput, S_IRUGO, write_throughput_show, NULL);
+
+static ssize_t cache_flushes_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->cache_flushes);
+}
+static DEVICE_ATTR(cache_flushes, S_IRUGO, cache_flushes_show, NULL);
+
+static ssize_t cache_flushed_pages_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->cache_flushed_pages);
+}
+static DEVICE_ATTR(cache_flushed_pages, S_IRUGO, cache_flushed_pages_show, NULL);
+
+static ssize_t cache_absorbed_pages_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->cache_absorbed_pages);
+}
+static DEVICE_ATTR(cache_absorbed_pages, S_IRUGO, cache_absorbed_pages_show, NULL);
+
+static ssize_t scrub_passes_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->scrub_passes);
+}
+static DEVICE_ATTR(scrub_passes, S_IRUGO, scrub_passes_show, NULL);
+
+static ssize_t scrub_position_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->scrub_next);
+}
+static DEVICE_ATTR(scrub_position, S_IRUGO, scrub_position_show, NULL);
+
+static ssize_t scrub_verified_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->scrub_verified);
+}
+static DEVICE_ATTR(scrub_verified, S_IRUGO, scrub_verified_show, NULL);
+
+static ssize_t scrub_bad_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->scrub_bad);
+}
+static DEVICE_ATTR(scrub_bad, S_IRUGO, scrub_bad_show, NULL);
+
+static ssize_t scrub_rate_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->scrub_rate);
+}
+static DEVICE_ATTR(scrub_rate, S_IRUGO, scrub_rate_show, NULL);
+
+static ssize_t scrub_coverage_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	unsigned int known = 0;
+
+	if(dev->scrub_known != NULL)
+	{
+		known = bitmap_weight(dev->scrub_known, dev->geometry.number_of_pages);
+	}
+	return sprintf(buf, "%u\n", (known * 100) / dev->geometry.number_of_pages);
+}
+static DEVICE_ATTR(scrub_coverage, S_IRUGO, scrub_coverage_show, NULL);
+
+static ssize_t warm_pages_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->warm_pages);
+}
+static DEVICE_ATTR(warm_pages, S_IRUGO, warm_pages_show, NULL);
+
+static ssize_t warm_time_us_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%lld\n", dev->warm_time_us);
+}
+static DEVICE_ATTR(warm_time_us, S_IRUGO, warm_time_us_show, NULL);
+
+static ssize_t first_read_us_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%lld\n", dev->first_read_us);
+}
+static DEVICE_ATTR(first_read_us, S_IRUGO, first_read_us_show, NULL);
+
+static ssize_t batches_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->batches);
+}
+static DEVICE_ATTR(batches, S_IRUGO, batches_show, NULL);
+
+static ssize_t batched_works_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", dev->batched_works);
+}
+static DEVICE_ATTR(batched_works, S_IRUGO, batched_works_show, NULL);
+
+static ssize_t log_appends_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", (dev->log != NULL) ? dev->log->appends : 0);
+}
+static DEVICE_ATTR(log_appends, S_IRUGO, log_appends_show, NULL);
+
+static ssize_t log_pages_written_show(struct device *device, struct device_attribute *attr, char *buf)
+{
+	struct i2c_EEPROM_dev *dev = dev_get_drvdata(device);
+	return sprintf(buf, "%u\n", (dev->log != NULL) ? dev->log->pages_written : 0);
+}
+static DEVICE_ATTR(log_pages_written, S_IRUGO, log_pages_written_show, NULL);
+
+static struct attribute *i2c_eeprom_attrs[] = {
+	&dev_attr_bus_speed.attr,
+	&dev_attr_bus_clock.attr,
+	&dev_attr_max_read_len.attr,
+	&dev_attr_transfer.attr,
+	&dev_attr_read_throughput.attr,
+	&dev_attr_write_throughput.attr,
+	&dev_attr_cache_flushes.attr,
+	&dev_attr_cache_flushed_pages.attr,
+	&dev_attr_cache_absorbed_pages.attr,
+	&dev_attr_scrub_passes.attr,
+	&dev_attr_scrub_position.attr,
+	&dev_attr_scrub_verified.attr,
+	&dev_attr_scrub_bad.attr,
+	&dev_attr_scrub_rate.attr,
+	&dev_attr_scrub_coverage.attr,
+	&dev_attr_warm_pages.attr,
+	&dev_attr_warm_time_us.attr,
+	&dev_attr_first_read_us.attr,
+	&dev_attr_batches.attr,
+	&dev_attr_batched_works.attr,
+	&dev_attr_log_appends.attr,
+	&dev_attr_log_pages_written.attr,
+	NULL,
+};
+
+static const struct attribute_group i2c_eeprom_attr_group = {
+	.attrs = i2c_eeprom_attrs,
+};
+
+/**
+* i2c_eeprom_write_pages - Function to program consecutive pages
+* @dev: EEPROM device
+* @offset: Memory offset to start at, advanced past every page written
+* @frames: One frame per page, room for the address followed by the page data
+* @count: Number of pages
+* @pageSize: Page size in bytes
+* @addressBytes: Width of the memory address
+*
+* Returns negative errno, or else 0.
+* 
+* Description: The page data was copied behind the address slot when the write
+* 				was queued, so only the address is filled in and the frame goes to
+* 				the bus as it is. Always inlined, so the wrappers below get a copy
+* 				of the loop with the page size and address width folded in as constants.
+*/
+static __always_inline int i2c_eeprom_write_pages(struct i2c_EEPROM_dev *dev, unsigned int *offset, char *frames, size_t count,
+	const unsigned int pageSize, const unsigned int addressBytes)
+{
+	int retValue;
+	size_t i;
+	char *frame;
+	unsigned int tempPointer = *offset;
+
+	for(i=0;i<count;i++)
+	{
+		//Switch ON LED before Write Operation Begins
+		gpio_set_value_cansleep(GPIO_LED_PIN, 1);
+		//Turn On Busy Flag
+		dev->BUSY_FLAG = 1;
+
+		frame = &frames[i * (addressBytes + pageSize)];
+		i2c_eeprom_set_address(frame, tempPointer, addressBytes);
+		i2c_eeprom_wait_write_cycle(dev);
+		retValue = i2c_eeprom_send(dev, tempPointer, frame, addressBytes + pageSize);
+		if(retValue<0)
+		{
+			printk("Error:i2c_master_send");
+			gpio_set_value_cansleep(GPIO_LED_PIN, 0);
+			dev->BUSY_FLAG = 0;
+			return retValue;
+		}
+		dev->write_cycle_end = ktime_add_us(ktime_get(), write_cycle_time);
+		tempPointer = tempPointer + pageSize;
+		//If current position of pointer has reached the last position then reset it back to 0
+		if(tempPointer >= dev->size)
+		{
+			tempPointer = 0;
+		}
+		*offset = tempPointer;
+
+		//Switch Off LED after Write Operation Ends
+		gpio_set_value_cansleep(GPIO_LED_PIN, 0);
+		//Turn Off Busy Flag
+		dev->BUSY_FLAG = 0;
+	}
+	return 0;
+}
+
+/**
+ * Fast paths for the common geometries
+ */
+#define I2C_EEPROM_WRITE_PAGES(pageSize, addressBytes) \
+static int i2c_eeprom_write_pages_##pageSize##_##addressBytes(struct i2c_EEPROM_dev *dev, unsigned int *offset, char *buf, size_t count) \
+{ \
+	return i2c_eeprom_write_pages(dev, offset, buf, count, pageSize, addressBytes); \
+}
+I2C_EEPROM_WRITE_PAGES(8, 1)
+I2C_EEPROM_WRITE_PAGES(16, 1)
+I2C_EEPROM_WRITE_PAGES(32, 2)
+I2C_EEPROM_WRITE_PAGES(64, 2)
+I2C_EEPROM_WRITE_PAGES(128, 2)
+I2C_EEPROM_WRITE_PAGES(256, 2)
+
+static int i2c_eeprom_write_pages_generic(struct i2c_EEPROM_dev *dev, unsigned int *offset, char *buf, size_t count)
+{
+	return i2c_eeprom_write_pages(dev, offset, buf, count, dev->geometry.page_size, dev->geometry.address_bytes);
+}
+
+/**
+* i2c_eeprom_set_geometry - Function to validate and apply the chip geometry
+* @dev: EEPROM device
+* @geometry: Requested geometry
+*
+* Returns 0, or -EINVAL if the geometry is not supported.
+* 
+* Description: Page size must be a power of two from 8 to 256 bytes and the address
+* 				one or two bytes wide. The page loop for the geometry is picked here once.
+*/
+static int i2c_eeprom_set_geometry(struct i2c_EEPROM_dev *dev, const struct i2c_EEPROM_geometry *geometry)
+{
+	unsigned int maxSize;
+
+	if(geometry->page_size < MIN_PAGE_SIZE || geometry->page_size > MAX_PAGE_SIZE ||
+		(geometry->page_size & (geometry->page_size - 1)))
+	{
+		return -EINVAL;
+	}
+	if(geometry->address_bytes != 1 && geometry->address_bytes != 2)
+	{
+		return -EINVAL;
+	}
+	//One byte parts address at most eight 256 byte blocks through the slave address
+	maxSize = (geometry->address_bytes == 1) ? (256 * 8) : (256 * 256);
+	if(geometry->number_of_pages < 1 || geometry->number_of_pages > (maxSize / geometry->page_size))
+	{
+		return -EINVAL;
+	}
+
+	dev->geometry = *geometry;
+	dev->size = geometry->page_size * geometry->number_of_pages;
+	dev->frame_size = geometry->address_bytes + geometry->page_size;
+	switch((geometry->page_size << 2) | geometry->address_bytes)
+	{
+		case (8 << 2) | 1:
+			dev->write_pages = i2c_eeprom_write_pages_8_1;
+			break;
+		case (16 << 2) | 1:
+			dev->write_pages = i2c_eeprom_write_pages_16_1;
+			break;
+		case (32 << 2) | 2:
+			dev->write_pages = i2c_eeprom_write_pages_32_2;
+			break;
+		case (64 << 2) | 2:
+			dev->write_pages = i2c_eeprom_write_pages_64_2;
+			break;
+		case (128 << 2) | 2:
+			dev->write_pages = i2c_eeprom_write_pages_128_2;
+			break;
+		case (256 << 2) | 2:
+			dev->write_pages = i2c_eeprom_write_pages_256_2;
+			break;
+		default:
+			dev->write_pages = i2c_eeprom_write_pages_generic;
+			break;
+	}
+	return 0;
+}
+
+/**
+* eeprom_probe - Function to probe EEPROM
+* @client: I2C Client
+* @id: I2C Device ID
+*
+* Returns 0, -ENODEV for an EEPROM not given in the module parameters, or -EINVAL
+* if the geometry is not supported.
+* 
+* Description: This function is called when a driver is registerd and a new device
+* 				is plugged in. The "pagesize", "size" and "address-width" device tree
+* 				properties override the module parameters.
+*/
+static int eeprom_probe(struct i2c_client *client, const struct i2c_device_id * id)
+{
+	struct i2c_EEPROM_dev *dev = NULL;
+	struct i2c_EEPROM_geometry geometry;
+	u32 value, sizeBytes = 0;
+	int i;
+
+	//Find the EEPROM registered for this adapter and address
+	for(i = 0; i < number_of_devices; i++)
+	{
+		if(i2c_EEPROM_device_list[i].bus->number == client->adapter->nr &&
+			i2c_EEPROM_device_list[i].geometry.slave_address == client->addr)
+		{
+			dev = &i2c_EEPROM_device_list[i];
+		}
+	}
+	if(dev == NULL)
+	{
+		return -ENODEV;
+	}
+	geometry = dev->geometry;
+
+	if(client->dev.of_node)
+	{
+		if(!of_property_read_u32(client->dev.of_node, "pagesize", &value))
+		{
+			geometry.page_size = value;
+		}
+		if(!of_property_read_u32(client->dev.of_node, "address-width", &value))
+		{
+			geometry.address_bytes = value / 8;
+		}
+		if(!of_property_read_u32(client->dev.of_node, "size", &value))
+		{
+			sizeBytes = value;
+		}
+		if(sizeBytes && geometry.page_size)
+		{
+			geometry.number_of_pages = sizeBytes / geometry.page_size;
+		}
+	}
+	geometry.slave_address = client->addr;
+	if(i2c_eeprom_set_geometry(dev, &geometry))
+	{
+		printk("Unsupported EEPROM geometry\n");
+		return -EINVAL;
+	}
+	memcpy(&(dev->client),client,sizeof(struct i2c_client));
+	if(i2c_eeprom_select_transfer(dev, client->adapter))
+	{
+		printk("I2C adapter %d supports neither I2C nor SMBus transfers for the EEPROM\n", client->adapter->nr);
+		return -EPFNOSUPPORT;
+	}
+	i2c_eeprom_set_transfer_limits(dev, client->adapter);
+	i2c_eeprom_measure_bus_speed(dev);
+	if(scrub_share != 0 && dev->scrub_crc == NULL)
+	{
+		dev->scrub_crc = kcalloc(dev->geometry.number_of_pages, sizeof(u32), GFP_KERNEL);
+		dev->scrub_known = kcalloc(BITS_TO_LONGS(dev->geometry.number_of_pages), sizeof(unsigned long), GFP_KERNEL);
+		if(dev->scrub_crc == NULL || dev->scrub_known == NULL)
+		{
+			printk("No memory for the scrub checksums, scrub is off\n");
+			kfree(dev->scrub_crc);
+			kfree(dev->scrub_known);
+			dev->scrub_crc = NULL;
+			dev->scrub_known = NULL;
+		}
+		else
+		{
+			dev->scrub_pass_start = ktime_get();
+			schedule_delayed_work(&dev->scrub_work, msecs_to_jiffies(SCRUB_START_DELAY));
+		}
+	}
+	dev->probed = ktime_get();
+	if(warm_up && dev->warm == NULL && i2c_eeprom_warm_up(dev))
+	{
+		printk("No memory for the warm-up copy of %s, reads go to the chip\n", dev->name);
+	}
+	i2c_eeprom_log_recover(dev);
+	//The volume takes its geometry from the members as probed, not from the module parameters
+	i2c_eeprom_volume_update();
+#ifdef I2C_EEPROM_NVMEM
+	i2c_eeprom_nvmem_register(dev, client);
+#endif
+    return 0;
+}
+
+/**
+* eeprom_remove - Function to probe EEPROM
+* @client: I2C Client
+*
+* Returns 0.
+* 
+* Description: This function is called when a driver is registerd and a already
+* 	plugged in device is plugged out.
+*/
+static int eeprom_remove(struct i2c_client *client)
+{
+#ifdef I2C_EEPROM_NVMEM
+	int i;
+
+	for(i = 0; i < number_of_devices; i++)
+	{
+		if(i2c_EEPROM_device_list[i].bus->number == client->adapter->nr &&
+			i2c_EEPROM_device_list[i].geometry.slave_address == client->addr)
+		{
+			i2c_eeprom_nvmem_unregister(&i2c_EEPROM_device_list[i]);
+		}
+	}
+#endif
+    return 0;
+}
+
+/**
+* This is Board Info Structure, which gives details about the devices on
+* the board for driver.
+*/
+static struct i2c_board_info i2c_eeprom_board_info[] = {
+	{
+		I2C_BOARD_INFO(DEVICE_NAME, SLAVE_ADDRESS),
+	}
+};
+
+/**
+* This is I2C Driver Structure.
+*/
+static struct i2c_driver eeprom_driver =
+{
+  .driver = {
+    .name       = DEVICE_NAME,      		/* Name */
+    .owner		= THIS_MODULE,				/* Owner */
+    .of_match_table = of_match_ptr(eeprom_of_match),	/* Device Tree Match */
+  },
+  .id_table     = eeprom_id_table, 			/* ID */
+  .probe 		= eeprom_probe,        		/* Probe Method */
+  .remove  		= eeprom_remove,       		/* Remove Method */
+};
+
+/**
+* eeprom_open - Function called when EEPROM device is opened for use.
+* @client: I2C Client
+*
+* Returns 0.
+* 
+* Description: This function is called when a driver is registerd and a already
+* 	plugged in device is plugged out.
+*/
+static int i2c_eeprom_open(struct inode *inode, struct file *file)
+{
+	int ret;
+	struct i2c_EEPROM_dev *dev = container_of(inode->i_cdev, struct i2c_EEPROM_dev, cdev);
+	struct i2c_eeprom_file *ctx;
+
+	//Every open file has its own position and read result
+	ctx = kzalloc(sizeof(struct i2c_eeprom_file), GFP_KERNEL);
+	if(ctx == NULL)
+	{
+		return -ENOMEM;
+	}
+	ctx->dev = dev;
+	file->private_data = ctx;
+	ret = gpio_request_one(GPIO_LED_PIN, GPIOF_OUT_INIT_LOW, "Led");
+	if(ret)
+	{
+		//printk("LED ERROR");
+	}
+	return 0;
+}
+
+/**
+* i2c_eeprom_release - Function called during release of EEPROM.
+* @inode: Inodes
+* @filp: Fle Pointer
+*
+* Returns 0.
+* 
+*/
+int i2c_eeprom_release(struct inode *inode, struct file *filp)
+{
+	struct i2c_eeprom_file *ctx = filp->private_data;
+	struct i2c_EEPROM_dev *dev = ctx->dev;
+
+	//Pages in the write cache are queued to the chip on close
+	i2c_eeprom_flush_cache(dev);
+	//A read still queued publishes into the file, let it finish first
+	wait_event(dev->done_wait, ACCESS_ONCE(ctx->read_pending) == 0);
+	kfree(ctx->read_buffer);
+	kfree(ctx);
+	return 0;
+}
+
+/**
+* i2c_eeprom_fsync - Function called to sync the EEPROM
+* @filp: File Pointer
+* @start: Start of the range, the whole EEPROM is synced
+* @end: End of the range
+* @datasync: Only data to sync
+*
+* Returns 0 once every written page is on the chip, or negative errno.
+*/
+static int i2c_eeprom_fsync(struct file *filp, loff_t start, loff_t end, int datasync)
+{
+	struct i2c_eeprom_file *ctx = filp->private_data;
+
+	return i2c_eeprom_flush(ctx->dev);
+}
+
+/**
+* i2c_eeprom_write_slice - Function to write the next page of a queued write or erase
+* @dev: EEPROM device
+* @work: Queued write or erase
+*
+* Returns negative errno, 1 once the last page is written, or else 0.
+* 
+* Description: Long operations are run one page per call, so the scheduler can
+* 				serve pending reads between their pages. A cancelled erase stops here.
+*/
+static int i2c_eeprom_write_slice(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work)
+{
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int tempPointer = (work->start + (work->pages_done * pageSize)) % dev->size;
+	unsigned int page;
+	char *frame;
+	int retValue;
+
+	if(work->read_or_write == 'E')
+	{
+		if(dev->erase_cancel)
+		{
+			printk("Erase cancelled after %u pages\n", work->pages_done);
+			return -ECANCELED;
+		}
+		dev->erase_status = 'R';
+		//Every page of an erase is programmed from the same frame of 0xFF
+		frame = work->queue_Data.buf;
+	}
+	else
+	{
+		frame = &(work->queue_Data.buf[work->pages_done * dev->frame_size]);
+	}
+	page = tempPointer / pageSize;
+	retValue = dev->write_pages(dev, &tempPointer, frame, 1);
+	if(retValue < 0)
+	{
+		//Nothing is known about the page any more
+		if(dev->scrub_known != NULL)
+		{
+			clear_bit(page, dev->scrub_known);
+		}
+		if(dev->warm != NULL)
+		{
+			clear_bit(page, dev->warm_valid);
+		}
+		return retValue;
+	}
+	i2c_eeprom_scrub_record(dev, page, &frame[dev->geometry.address_bytes]);
+	if(dev->warm != NULL)
+	{
+		//The write is still queued, reads take the page from it until it retires
+		memcpy(&(dev->warm[page * pageSize]), &frame[dev->geometry.address_bytes], pageSize);
+		smp_wmb();
+		set_bit(page, dev->warm_valid);
+	}
+	work->pages_done++;
+	if(work->read_or_write == 'E')
+	{
+		dev->erase_done = work->pages_done;
+	}
+	return (work->pages_done == work->queue_Data.count) ? 1 : 0;
+}
+
+/**
+* i2c_eeprom_forward_writes - Function to serve a read from the queued writes
+* @dev: EEPROM device
+* @work: Queued read
+*
+* Returns number of pages of the read served from queued writes.
+* 
+* Description: Must be called with the cache and queue locks held. Every page of
+* 				the read that is dirty in the write cache, or else covered by a write
+* 				or erase queued before it, is copied from the newest such data, so the
+* 				read sees the data in the order the requests were made, whether or not
+* 				the chip has been written yet. Pages left are taken from the warm-up
+* 				copy if it holds them. The pages are marked in work->covered. A work
+* 				read from is pinned, it is not cancelled any more, and a cancelled erase
+* 				is passed over as it will not write the pages.
+*/
+static unsigned int i2c_eeprom_forward_writes(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work)
+{
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int i, address, pageOffset, covered = 0;
+	I2C_WORK_QUEUE *pending;
+
+	for(i = 0; i < work->queue_Data.count; i++)
+	{
+		address = (work->start + (i * pageSize)) % dev->size;
+		//The write cache holds the newest data of its pages
+		if(dev->cache != NULL && test_bit(address / pageSize, dev->dirty))
+		{
+			memcpy(&(work->queue_Data.buf[i * pageSize]), &(dev->cache[address]), pageSize);
+			set_bit(i, work->covered);
+			covered++;
+			continue;
+		}
+		//Writes and erases are all in the low priority queue, newest last.
+		//The read is forwarded as it enters the queues, so all of them came before it.
+		list_for_each_entry_reverse(pending, &dev->queue[PRIORITY_LOW], list)
+		{
+			if(pending->read_or_write == 'E')
+			{
+				if(dev->erase_cancel)
+				{
+					continue;
+				}
+				memcpy(&(work->queue_Data.buf[i * pageSize]), &(pending->queue_Data.buf[dev->geometry.address_bytes]), pageSize);
+				dev->erase_forwarded = 1;
+				set_bit(i, work->covered);
+				covered++;
+				break;
+			}
+			pageOffset = (address + dev->size - pending->start) % dev->size;
+			if(pending->read_or_write == 'W' && pageOffset < (pending->queue_Data.count * pageSize))
+			{
+				memcpy(&(work->queue_Data.buf[i * pageSize]),
+					&(pending->queue_Data.buf[((pageOffset / pageSize) * dev->frame_size) + dev->geometry.address_bytes]), pageSize);
+				pending->forwarded = 1;
+				set_bit(i, work->covered);
+				covered++;
+				break;
+			}
+		}
+		//Pages no queued work covers are as the warm-up or the last write left them
+		if(!test_bit(i, work->covered) && dev->warm != NULL && test_bit(address / pageSize, dev->warm_valid))
+		{
+			smp_rmb();
+			memcpy(&(work->queue_Data.buf[i * pageSize]), &(dev->warm[address]), pageSize);
+			set_bit(i, work->covered);
+			covered++;
+		}
+	}
+	return covered;
+}
+
+/**
+* i2c_eeprom_read_work - Function to run a queued read
+* @dev: EEPROM device
+* @work: Queued read
+*
+* Returns negative errno, or else 1.
+* 
+* Description: Reads are short and run in one go, waiting only for the write
+* 				cycle of the page written before them. Only the pages not already
+* 				served from the write cache or the queued writes are read from the chip.
+*/
+static int i2c_eeprom_read_work(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work)
+{
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned long first, last;
+	int retValue = 0;
+
+	//Switch ON LED before Read Operation Begins
+	gpio_set_value_cansleep(GPIO_LED_PIN, 1);
+	dev->BUSY_FLAG = 1;
+	//Address the chip and receive each run of pages not served yet
+	first = find_next_zero_bit(work->covered, work->queue_Data.count, 0);
+	while(first < work->queue_Data.count && retValue >= 0)
+	{
+		last = find_next_bit(work->covered, work->queue_Data.count, first);
+		retValue = i2c_eeprom_read_data(dev, (work->start + (first * pageSize)) % dev->size,
+				&(work->queue_Data.buf[first * pageSize]), ((last - first) * pageSize));
+		first = find_next_zero_bit(work->covered, work->queue_Data.count, last);
+	}
+	//Switch OFF LED after Read Operation Ends
+	gpio_set_value_cansleep(GPIO_LED_PIN, 0);
+	dev->BUSY_FLAG = 0;
+	return (retValue < 0) ? retValue : 1;
+}
+
+/**
+* i2c_eeprom_ioctl - Function to perform IOCTL operations
+* @file: File Pointer
+* @arg: Arguments to the functions
+* @cmd: Command to perform specific functions
+*
+* Returns pointer position, no of pages erased.
+* 
+* Description: This function is called to perform ioctl functions like 
+* set pointer positions, get pointer positions, erase eeprom and to check the 
+* status of the EEPROM.
+*/
+static long i2c_eeprom_ioctl(struct file *file, unsigned int arg, unsigned long cmd)
+{
+	struct i2c_eeprom_file *ctx = file->private_data;
+	struct i2c_EEPROM_dev *dev = ctx->dev;
+	long retValue =0;
+	struct i2c_EEPROM_progress progress;
+	struct i2c_EEPROM_status status;
+	unsigned int pageSize = dev->geometry.page_size;
+	//printk(KERN_INFO "i2c_flash.c: eep_ioctl: Start\n");
+	switch(cmd)
+	{
+		case FLASHGETS:
+			{
+				retValue = dev->BUSY_FLAG;
+			    break;
+			}
+		case FLASHGETP:
+			{
+				retValue = (ctx->current_pointer)/(pageSize);
+			    break;
+			}
+		case FLASHSETP:
+			{
+				if(arg >= dev->geometry.number_of_pages)
+				{
+					retValue = -1;
+				}
+				else
+				{
+					ACCESS_ONCE(ctx->current_pointer) = arg * pageSize;
+					retValue = arg;
+				}
+				break;
+			}
+		case FLASHERASE:
+			{
+				retValue = i2c_eeprom_erase_into_queue(file);
+				break;
+			}
+		case FLASHERASEP:
+			{
+				progress.pages_done  = dev->erase_done;
+				progress.pages_total = dev->erase_total;
+				progress.status      = dev->erase_status;
+				if(copy_to_user((void __user *)(unsigned long)arg, &progress, sizeof(struct i2c_EEPROM_progress)))
+				{
+					retValue = -EFAULT;
+				}
+				else
+				{
+					retValue = progress.pages_done;
+				}
+				break;
+			}
+		case FLASHERASEC:
+			{
+				//Under the queue lock, so no read is forwarded from the erase meanwhile
+				spin_lock(&dev->queue_lock);
+				if(dev->erase_forwarded)
+				{
+					retValue = -EBUSY;
+				}
+				else if(dev->erase_status == 'Q' || dev->erase_status == 'R')
+				{
+					dev->erase_cancel = 1;
+					retValue = dev->erase_done;
+				}
+				else
+				{
+					retValue = -1;
+				}
+				spin_unlock(&dev->queue_lock);
+				break;
+			}
+		case FLASHWAIT:
+			{
+				retValue = i2c_eeprom_wait_ticket(dev, arg);
+				break;
+			}
+		case FLASHFLUSH:
+			{
+				retValue = i2c_eeprom_flush(dev);
+				break;
+			}
+		case FLASHCANCEL:
+			{
+				retValue = i2c_eeprom_cancel_work(dev, file, arg);
+				break;
+			}
+		case FLASHGETG:
+			{
+				if(copy_to_user((void __user *)(unsigned long)arg, &(dev->geometry), sizeof(struct i2c_EEPROM_geometry)))
+				{
+					retValue = -EFAULT;
+				}
+				break;
+			}
+		case FLASHSTATUS:
+			{
+				i2c_eeprom_read_status(dev, &status);
+				if(copy_to_user((void __user *)(unsigned long)arg, &status, sizeof(struct i2c_EEPROM_status)))
+				{
+					retValue = -EFAULT;
+				}
+				break;
+			}
+		case FLASHCAS:
+			{
+				retValue = i2c_eeprom_compare_and_swap(dev, (struct i2c_EEPROM_cas __user *)(unsigned long)arg);
+				break;
+			}
+		default:
+			break;
+	}
+	//printk("i2c_flash.c: eep_ioctl: End\n");
+	return retValue;
+}
+/**
+ * Driver entry points 
+ */
+static struct file_operations i2c_eeprom_fops = {
+  .owner   = THIS_MODULE,
+  .read    = i2c_eeprom_read_from_queue,
+  .write   = i2c_eeprom_write_into_queue,
+  .open    = i2c_eeprom_open,
+  .release = i2c_eeprom_release,
+  .fsync   = i2c_eeprom_fsync,
+  .unlocked_ioctl   = i2c_eeprom_ioctl,
+};
+
+/**
+ * Volume entry points 
+ */
+static struct file_operations i2c_eeprom_volume_fops = {
+  .owner   = THIS_MODULE,
+  .read    = i2c_eeprom_volume_read,
+  .write   = i2c_eeprom_volume_write,
+  .open    = i2c_eeprom_volume_open,
+  .unlocked_ioctl   = i2c_eeprom_volume_ioctl,
+};
+
+/**
+ * Log entry points 
+ */
+static struct file_operations i2c_eeprom_log_fops = {
+  .owner   = THIS_MODULE,
+  .read    = i2c_eeprom_log_read,
+  .write   = i2c_eeprom_log_write,
+  .open    = i2c_eeprom_log_open,
+  .release = i2c_eeprom_log_release,
+  .fsync   = i2c_eeprom_log_fsync,
+  .unlocked_ioctl   = i2c_eeprom_log_ioctl,
+};
+
+/**
+ * Device Initialization
+ */
+static int __init i2c_eeprom_init(void)
+{
+	int err, i, j, minors;
+	struct i2c_adapter *adap;
+	struct i2c_EEPROM_geometry geometry;
+	struct i2c_EEPROM_dev *dev;
+	struct i2c_eeprom_bus *bus;
+
+	/* Allocate the per-device data structures, one i2c_EEPROM_dev per EEPROM */
+	i2c_EEPROM_device_list = kmalloc(number_of_devices * sizeof(struct i2c_EEPROM_dev), GFP_KERNEL);
+	if(i2c_EEPROM_device_list == NULL)
+	{
+		return -ENOMEM;
+	}
+	memset(i2c_EEPROM_device_list, 0, number_of_devices * sizeof(struct i2c_EEPROM_dev));
+
+	for(i = 0; i < number_of_devices; i++)
+	{
+		dev = &i2c_EEPROM_device_list[i];
+		/* Geometry from the module parameters, the device tree may override it at probe */
+		geometry.page_size       = page_size;
+		geometry.number_of_pages = number_of_pages;
+		geometry.address_bytes   = address_bytes;
+		geometry.slave_address   = slave_address[i];
+		if(i2c_eeprom_set_geometry(dev, &geometry))
+		{
+			printk("Unsupported EEPROM geometry\n");
+			kfree(i2c_EEPROM_device_list);
+			return -EINVAL;
+		}
+
+		/* EEPROMs on the same adapter share its scheduler */
+		for(j = 0; j < number_of_buses; j++)
+		{
+			if(i2c_eeprom_bus_list[j].number == ((i < number_of_i2c_bus) ? i2c_bus[i] : I2C_MINOR_NUMBER))
+			{
+				break;
+			}
+		}
+		bus = &i2c_eeprom_bus_list[j];
+		if(j == number_of_buses)
+		{
+			bus->number = (i < number_of_i2c_bus) ? i2c_bus[i] : I2C_MINOR_NUMBER;
+			init_waitqueue_head(&(bus->submit_wait));
+			number_of_buses++;
+		}
+		bus->devices[bus->number_of_devices++] = dev;
+		dev->bus = bus;
+		dev->minor = i;
+
+		/* Scheduler queues, one per priority class */
+		spin_lock_init(&(dev->queue_lock));
+		dev->submit = alloc_percpu(struct llist_head);
+		if(dev->submit == NULL)
+		{
+			while(i--)
+			{
+				free_percpu(i2c_EEPROM_device_list[i].submit);
+			}
+			kfree(i2c_EEPROM_device_list);
+			return -ENOMEM;
+		}
+		INIT_LIST_HEAD(&(dev->queue[PRIORITY_HIGH]));
+		INIT_LIST_HEAD(&(dev->queue[PRIORITY_LOW]));
+		INIT_LIST_HEAD(&(dev->queue[PRIORITY_BACKGROUND]));
+		init_waitqueue_head(&(dev->done_wait));
+		seqlock_init(&(dev->status_lock));
+		mutex_init(&(dev->cache_lock));
+		mutex_init(&(dev->rmw_lock));
+		INIT_DELAYED_WORK(&(dev->flush_work), i2c_eeprom_flush_cache_fn);
+		INIT_DELAYED_WORK(&(dev->scrub_work), i2c_eeprom_scrub_fn);
+	}
+  
+	err = i2c_eeprom_volume_setup();
+	if(err)
+	{
+		for(i = 0; i < number_of_devices; i++)
+		{
+			free_percpu(i2c_EEPROM_device_list[i].submit);
+		}
+		kfree(i2c_EEPROM_device_list);
+		return err;
+	}
+  
+	/* The logs are set up at probe, once the geometry is known */
+	if(log_pages != 0)
+	{
+		for(i = 0; i < number_of_devices; i++)
+		{
+			dev = &i2c_EEPROM_device_list[i];
+			dev->log = kzalloc(sizeof(struct i2c_eeprom_log), GFP_KERNEL);
+			if(dev->log == NULL)
+			{
+				while(i--)
+				{
+					kfree(i2c_EEPROM_device_list[i].log);
+				}
+				for(i = 0; i < number_of_devices; i++)
+				{
+					free_percpu(i2c_EEPROM_device_list[i].submit);
+				}
+				kfree(i2c_eeprom_volume);
+				kfree(i2c_EEPROM_device_list);
+				return -ENOMEM;
+			}
+			dev->log->dev = dev;
+			mutex_init(&(dev->log->lock));
+		}
+	}
+  
+	/* Register and create the /dev interfaces to access the EEPROM banks, the volume after them and the logs last. */
+	minors = number_of_devices + 1 + ((log_pages != 0) ? number_of_devices : 0);
+	if(alloc_chrdev_region(&dev_number, I2C_MINOR_NUMBER, minors, DRIVER_NAME) < 0)
+	{
+		printk("Can't register device\n");
+		return -1;
+	}
+
+	eep_class = class_create(THIS_MODULE, DEVICE_NAME);
+	
+	for(i = 0; i < number_of_devices; i++)
+	{
+		dev = &i2c_EEPROM_device_list[i];
+		/* Setting i2c driver name, the first EEPROM keeps the plain name */
+		if(i == 0)
+		{
+			sprintf(dev->name, DEVICE_NAME);
+		}
+		else
+		{
+			sprintf(dev->name, DEVICE_NAME "%d", i);
+		}
+	
+		/* Connect the file operations with cdev */
+		cdev_init(&dev->cdev, &i2c_eeprom_fops);
+	
+		/* Connect the major/minor number to the cdev */
+		if (cdev_add(&dev->cdev, MKDEV(MAJOR(dev_number), i), 1))
+		{
+			printk("Bad kmalloc\n");
+			return 1;
+		}
+
+		dev->device = device_create(eep_class, NULL, MKDEV(MAJOR(dev_number), i), dev, dev->name);
+		if(sysfs_create_group(&(dev->device->kobj), &i2c_eeprom_attr_group))
+		{
+			printk("Creating sysfs attributes failed\n");
+		}
+	}
+	if(i2c_eeprom_volume)
+	{
+		cdev_init(&i2c_eeprom_volume->cdev, &i2c_eeprom_volume_fops);
+		if (cdev_add(&i2c_eeprom_volume->cdev, MKDEV(MAJOR(dev_number), number_of_devices), 1))
+		{
+			printk("Bad kmalloc\n");
+			return 1;
+		}
+		i2c_eeprom_volume->device = device_create(eep_class, NULL, MKDEV(MAJOR(dev_number), number_of_devices), i2c_eeprom_volume, VOLUME_NAME);
+	}
+	for(i = 0; i < number_of_devices && log_pages != 0; i++)
+	{
+		dev = &i2c_EEPROM_device_list[i];
+		sprintf(dev->log->name, "%s" LOG_NAME_SUFFIX, dev->name);
+		cdev_init(&dev->log->cdev, &i2c_eeprom_log_fops);
+		if (cdev_add(&dev->log->cdev, MKDEV(MAJOR(dev_number), number_of_devices + 1 + i), 1))
+		{
+			printk("Bad kmalloc\n");
+			return 1;
+		}
+		dev->log->device = device_create(eep_class, NULL, MKDEV(MAJOR(dev_number), number_of_devices + 1 + i), dev->log, dev->log->name);
+	}
+	err = gpio_request_one(GPIO_MUX_PIN, GPIOF_OUT_INIT_LOW, "Mux");
+	if(err)
+	{
+		//printk("MUX ERROR");
+	}
+	gpio_set_value_cansleep(GPIO_MUX_PIN, 0);
+	/* One dispatcher thread per adapter, running before any probe queues work for it */
+	for(i = 0; i < number_of_buses; i++)
+	{
+		bus = &i2c_eeprom_bus_list[i];
+		bus->thread = kthread_run(i2c_eeprom_dispatch_fn, bus, DISPATCH_THREAD_NAME, bus->number);
+		if(IS_ERR(bus->thread))
+		{
+			printk("Starting the dispatcher thread of I2C adapter %d failed\n", bus->number);
+			bus->thread = NULL;
+		}
+	}
+	
+	/* Inform the I2C core about driver existence. Device tree EEPROMs are probed here. */
+	err = i2c_add_driver(&eeprom_driver);
+	if(err)
+	{
+		printk("Registering I2C driver failed, errno is %d\n", err);
+		for(i = 0; i < number_of_buses; i++)
+		{
+			if(i2c_eeprom_bus_list[i].thread)
+			{
+				kthread_stop(i2c_eeprom_bus_list[i].thread);
+				i2c_eeprom_bus_list[i].thread = NULL;
+			}
+		}
+		for(i = 0; i < number_of_devices; i++)
+		{
+			dev = &i2c_EEPROM_device_list[i];
+			if(dev->log != NULL)
+			{
+				device_destroy(eep_class, MKDEV(MAJOR(dev_number), number_of_devices + 1 + i));
+				cdev_del(&(dev->log->cdev));
+				kfree(dev->log);
+			}
+			sysfs_remove_group(&(dev->device->kobj), &i2c_eeprom_attr_group);
+			device_destroy(eep_class, MKDEV(MAJOR(dev_number), i));
+			cdev_del(&(dev->cdev));
+			free_percpu(dev->submit);
+		}
+		if(i2c_eeprom_volume)
+		{
+			device_destroy(eep_class, MKDEV(MAJOR(dev_number), number_of_devices));
+			cdev_del(&(i2c_eeprom_volume->cdev));
+			kfree(i2c_eeprom_volume);
+			i2c_eeprom_volume = NULL;
+		}
+		class_destroy(eep_class);
+		unregister_chrdev_region(dev_number, minors);
+		kfree(i2c_EEPROM_device_list);
+		return err;
+	}
+	
+	for(i = 0; i < number_of_devices; i++)
+	{
+		dev = &i2c_EEPROM_device_list[i];
+		adap = i2c_get_adapter(dev->bus->number);
+		i2c_eeprom_board_info[0].addr = slave_address[i];
+		dev->client_core = i2c_new_device(adap, i2c_eeprom_board_info);
+	}
+
+	printk("EEPROM Driver Initialized.\n");
+	return 0;
+}
+
+/**
+* i2c_eeprom_exit - Function to perform IOCTL operations
+* @file: File Pointer
+* @arg: Arguments to the functions
+* @cmd: Command to perform specific functions
+*
+* Returns pointer position, no of pages erased.
+* 
+* Description: This function is called to perform ioctl functions like 
+* set pointer positions, get pointer positions, erase eeprom and to check the 
+* status of the EEPROM.
+*/
+static void __exit i2c_eeprom_exit(void)
+{
+	int i;
+	struct i2c_EEPROM_dev *dev;
+
+	//printk("i2c_flash.c: i2c_dev_exit: Start\n");
+	/* Queue what is left in the write caches */
+	for(i = 0; i < number_of_devices; i++)
+	{
+		dev = &i2c_EEPROM_device_list[i];
+#ifdef I2C_EEPROM_NVMEM
+		/* No more kernel consumers once the workers thread is gone */
+		i2c_eeprom_nvmem_unregister(dev);
+#endif
+		dev->scrub_stop = 1;
+		dev->warm_stop = 1;
+		cancel_delayed_work_sync(&(dev->scrub_work));
+		cancel_delayed_work_sync(&(dev->flush_work));
+		i2c_eeprom_flush_cache(dev);
+		if(dev->log != NULL)
+		{
+			//Full pages and the open page of the log go to the chip too
+			mutex_lock(&(dev->log->lock));
+			i2c_eeprom_log_sync(dev->log);
+			mutex_unlock(&(dev->log->lock));
+		}
+	}
+	/* Let the dispatcher threads finish the queued work while the chips are still there */
+	for(i = 0; i < number_of_buses; i++)
+	{
+		if(i2c_eeprom_bus_list[i].thread)
+		{
+			kthread_stop(i2c_eeprom_bus_list[i].thread);
+		}
+	}
+	for(i = 0; i < number_of_devices; i++)
+	{
+		dev = &i2c_EEPROM_device_list[i];
+		/* and let the chip finish programming the last page */
+		i2c_eeprom_wait_write_cycle(dev);
+		sysfs_remove_group(&(dev->device->kobj), &i2c_eeprom_attr_group);
+		device_destroy(eep_class, MKDEV(MAJOR(dev_number), i));
+		cdev_del(&(dev->cdev));
+	}
+	if(i2c_eeprom_volume)
+	{
+		device_destroy(eep_class, MKDEV(MAJOR(dev_number), number_of_devices));
+		cdev_del(&(i2c_eeprom_volume->cdev));
+		kfree(i2c_eeprom_volume);
+	}
+	for(i = 0; i < number_of_devices; i++)
+	{
+		dev = &i2c_EEPROM_device_list[i];
+		if(dev->log != NULL)
+		{
+			device_destroy(eep_class, MKDEV(MAJOR(dev_number), number_of_devices + 1 + i));
+			cdev_del(&(dev->log->cdev));
+			kfree(dev->log->frames);
+			kfree(dev->log);
+		}
+	}
+	class_destroy(eep_class);
+	unregister_chrdev(MAJOR(dev_number), DRIVER_NAME);
+	for(i = 0; i < number_of_devices; i++)
+	{
+		dev = &i2c_EEPROM_device_list[i];
+		i2c_unregister_device(dev->client_core);
+		kfree(dev->cache);
+		kfree(dev->dirty);
+		kfree(dev->scrub_crc);
+		kfree(dev->scrub_known);
+		kfree(dev->warm);
+		kfree(dev->warm_valid);
+		free_percpu(dev->submit);
+	}
+	i2c_del_driver(&eeprom_driver);
+	kfree(i2c_EEPROM_device_list);
+	//printk("i2c_flash.c: i2c_dev_exit: End\n");
+}
+
+/**
+* i2c_eeprom_retire_work - Function to record how a work finished
+* @dev: EEPROM device
+* @work: Work leaving the queues
+* @result: Negative errno, or else 0
+*
+* Returns void.
+* 
+* Description: Must be called with the queue lock held, so a ticket is always
+* 				either queued or recorded when a waiter looks it up.
+*/
+static void i2c_eeprom_retire_work(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work, int result)
+{
+	unsigned int slot = work->work_id % TICKET_HISTORY;
+
+	list_del(&work->list);
+	work->status_Flag = (result == 0) ? 'D' : (result == -ECANCELED) ? 'C' : 'F';
+	//Works nobody can wait on leave the history to those that can
+	if(work->waited)
+	{
+		dev->done_id[slot] = work->work_id;
+		dev->done_status[slot] = work->status_Flag;
+	}
+	write_seqlock(&dev->status_lock);
+	dev->status.queue_depth--;
+	if(dev->status.current_ticket == work->work_id)
+	{
+		dev->status.current_op = 0;
+	}
+	if(result == 0)
+	{
+		dev->status.works_done++;
+	}
+	else
+	{
+		dev->status.works_failed++;
+		dev->status.last_error = result;
+	}
+	dev->status.finished_ns = ktime_to_ns(ktime_get());
+	write_sequnlock(&dev->status_lock);
+}
+
+/**
+* i2c_eeprom_update_status - Function to publish the work on the bus
+* @dev: EEPROM device
+* @work: Work that has just run or is about to run a slice
+*
+* Returns void.
+* 
+* Description: Called by the scheduler around every slice, status readers see
+* 				the progress without taking a lock.
+*/
+static void i2c_eeprom_update_status(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work)
+{
+	write_seqlock(&dev->status_lock);
+	if(dev->status.current_ticket != work->work_id || dev->status.current_op == 0)
+	{
+		dev->status.started_ns = ktime_to_ns(ktime_get());
+	}
+	dev->status.current_op     = work->read_or_write;
+	dev->status.current_ticket = work->work_id;
+	dev->status.pages_done     = work->pages_done;
+	dev->status.pages_total    = work->queue_Data.count;
+	write_sequnlock(&dev->status_lock);
+}
+
+/**
+* i2c_eeprom_read_status - Function to take a consistent snapshot of the scheduler state
+* @dev: EEPROM device
+* @status: Filled with the snapshot
+*
+* Returns void.
+* 
+* Description: Lock free, the copy is taken again if the scheduler changed the
+* 				state meanwhile. The scheduler never waits for a reader.
+*/
+static void i2c_eeprom_read_status(struct i2c_EEPROM_dev *dev, struct i2c_EEPROM_status *status)
+{
+	unsigned int seq;
+
+	do
+	{
+		seq = read_seqbegin(&dev->status_lock);
+		*status = dev->status;
+	} while(read_seqretry(&dev->status_lock, seq));
+}
+
+/**
+* i2c_eeprom_submitted - Function to check the submission lists of an EEPROM
+* @dev: EEPROM device
+*
+* Returns 1 if a work waits on the list of any CPU, or else 0.
+*/
+static int i2c_eeprom_submitted(struct i2c_EEPROM_dev *dev)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+	{
+		if(!llist_empty(per_cpu_ptr(dev->submit, cpu)))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+* i2c_eeprom_claim_pointer - Function to take the next pages of an open file
+* @dev: EEPROM device
+* @ctx: Open file
+* @length: Bytes the request covers
+* @read: Reads go back to page 0 before the last page, writes wrap around
+*
+* Returns the memory offset the request starts at.
+*
+* Description: Lock free, two requests of one file racing each other still get
+* 				consecutive pages.
+*/
+static unsigned int i2c_eeprom_claim_pointer(struct i2c_EEPROM_dev *dev, struct i2c_eeprom_file *ctx, unsigned int length, int read)
+{
+	unsigned int start, next;
+
+	do
+	{
+		start = ACCESS_ONCE(ctx->current_pointer);
+		if(read)
+		{
+			next = start + length;
+			// If pointer has reached last position then set it to the start position.
+			if(next >= (dev->size - dev->geometry.page_size))
+			{
+				next = 0;
+			}
+		}
+		else
+		{
+			next = (start + length) % dev->size;
+		}
+	} while(cmpxchg(&(ctx->current_pointer), start, next) != start);
+	return start;
+}
+
+/**
+* i2c_eeprom_drain_submissions - Function to move the submitted works into the queues
+* @dev: EEPROM device
+* @served: Collects the reads served without the chip, for the caller to finish
+* 			once the lock is dropped
+*
+* Returns number of works moved.
+*
+* Description: Must be called with the queue lock held. The submission lists of
+* 				all CPUs are taken whole and merged into one batch by submission
+* 				time, which keeps the order of the works of each file even when its
+* 				thread moved between CPUs. The batch is put in the queues in that
+* 				order, so every read is forwarded against the writes ahead of it,
+* 				those of the same batch included.
+*/
+static unsigned int i2c_eeprom_drain_submissions(struct i2c_EEPROM_dev *dev, struct list_head *served)
+{
+	struct llist_node *node;
+	I2C_WORK_QUEUE *work, *next, *pos;
+	LIST_HEAD(batch);
+	unsigned int count = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+	{
+		node = llist_reverse_order(llist_del_all(per_cpu_ptr(dev->submit, cpu)));
+		llist_for_each_entry_safe(work, next, node, submit)
+		{
+			//The list of one CPU is in order already, merge it in by submission time
+			list_for_each_entry_reverse(pos, &batch, list)
+			{
+				if(pos->submitted <= work->submitted)
+				{
+					break;
+				}
+			}
+			list_add(&work->list, &pos->list);
+			count++;
+		}
+	}
+	if(count == 0)
+	{
+		return 0;
+	}
+	write_seqlock(&dev->status_lock);
+	dev->status.queue_depth += count;
+	dev->status.queued_ns = ktime_to_ns(ktime_get());
+	write_sequnlock(&dev->status_lock);
+	list_for_each_entry_safe(work, next, &batch, list)
+	{
+		if(work->read_or_write == 'R' && i2c_eeprom_forward_writes(dev, work) == work->queue_Data.count)
+		{
+			//Nothing left to read from the chip, retiring takes it off the batch
+			i2c_eeprom_retire_work(dev, work, 0);
+			list_add_tail(&work->list, served);
+			continue;
+		}
+		list_move_tail(&work->list, &dev->queue[work->priority]);
+	}
+	dev->batches++;
+	dev->batched_works += count;
+	return count;
+}
+
+/**
+* i2c_eeprom_drain - Function to empty the submission list of a device
+* @dev: EEPROM device
+*
+* Returns void.
+*
+* Description: Run by the dispatcher thread before it picks work, and by the
+* 				callers that must see every work submitted so far. Must be
+* 				called with the cache lock held, whoever drains forwards the
+* 				reads of the batch against the write cache. Reads are submitted
+* 				with the lock held and drain the list themselves, the dispatcher
+* 				and the other callers take the lock for the drain.
+*/
+static void i2c_eeprom_drain(struct i2c_EEPROM_dev *dev)
+{
+	I2C_WORK_QUEUE *work, *next;
+	LIST_HEAD(served);
+
+	if(!i2c_eeprom_submitted(dev))
+	{
+		return;
+	}
+	spin_lock(&dev->queue_lock);
+	i2c_eeprom_drain_submissions(dev, &served);
+	spin_unlock(&dev->queue_lock);
+	list_for_each_entry_safe(work, next, &served, list)
+	{
+		list_del(&work->list);
+		i2c_eeprom_finish_work(dev, work, 0);
+	}
+}
+
+/**
+* i2c_eeprom_queue_work - Function to hand work to the scheduler
+* @dev: EEPROM device
+* @work: Work with read_or_write and queue_Data filled in
+*
+* Returns the ticket of the work.
+* 
+* Description: Reads and writes take their offset from the position pointer when
+* 				they are queued and move it on, so later requests queue behind them.
+* 				Reads go to the high priority class, writes and erases to the low one.
+* 				A read whose pages are all covered by the write cache or queued writes
+* 				is served from them at once and never reaches the chip. Reads must be
+* 				queued with the cache lock held.
+* 				The work is pushed on the lock free submission list of the EEPROM for
+* 				the current CPU, and its ticket comes from a block the CPU holds, so
+* 				writes and erases are queued without taking any lock or sharing a
+* 				cache line with other CPUs. The dispatcher thread is woken only when
+* 				the list was empty. Tickets are unique but not in submission order.
+*/
+static unsigned int i2c_eeprom_queue_work(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work)
+{
+	unsigned int length = work->queue_Data.count * dev->geometry.page_size;
+	struct i2c_eeprom_file *ctx = NULL;
+	struct i2c_eeprom_ticket_block *block;
+	unsigned int ticket;
+	s64 now;
+	bool wake;
+
+	work->status_Flag = 'Q';
+	work->pages_done  = 0;
+	work->forwarded   = 0;
+	if(work->queue_Data.file != NULL)
+	{
+		ctx = work->queue_Data.file->private_data;
+		work->waited = 1;
+	}
+	switch(work->read_or_write)
+	{
+		case 'R':
+			work->priority = PRIORITY_HIGH;
+			//Reads queued by the driver itself bring their own start
+			if(work->queue_Data.offset != NULL)
+			{
+				work->start = i2c_eeprom_claim_pointer(dev, ctx, length, 1);
+			}
+			break;
+		case 'W':
+			work->priority = PRIORITY_LOW;
+			//Writes queued by the driver itself bring their own start
+			if(work->queue_Data.offset != NULL)
+			{
+				work->start = i2c_eeprom_claim_pointer(dev, ctx, length, 0);
+			}
+			break;
+		case 'V':
+		case 'P':
+			//Scrub and warm-up reads want the chip itself, nothing is forwarded
+			work->priority = PRIORITY_BACKGROUND;
+			break;
+		default:
+			work->priority = PRIORITY_LOW;
+			work->start = 0;
+			//Requests of the erasing file queued after the erase start at page 0
+			if(ctx != NULL)
+			{
+				ACCESS_ONCE(ctx->current_pointer) = 0;
+			}
+			break;
+	}
+	//Stamp and push on this CPU without being moved, so its list stays in order
+	block = get_cpu_ptr(&i2c_eeprom_ticket_blocks);
+	if(block->next == block->end)
+	{
+		//The shared counter is touched once per TICKET_BLOCK works on a CPU
+		block->end  = atomic_add_return(TICKET_BLOCK, &WORK_ID_COUNTER) + 1;
+		block->next = block->end - TICKET_BLOCK;
+	}
+	work->work_id = block->next++;
+	ticket = work->work_id;
+	now = ktime_to_ns(ktime_get());
+	if(ctx != NULL)
+	{
+		//Works of one file never share a stamp, their order survives the merge
+		if(now <= ctx->last_submitted)
+		{
+			now = ctx->last_submitted + 1;
+		}
+		ctx->last_submitted = now;
+	}
+	work->submitted = now;
+	//The dispatcher is asleep only if the list was empty
+	wake = llist_add(&work->submit, this_cpu_ptr(dev->submit));
+	put_cpu_ptr(&i2c_eeprom_ticket_blocks);
+	if(wake)
+	{
+		wake_up(&dev->bus->submit_wait);
+	}
+	if(work->read_or_write == 'R')
+	{
+		//Forwarded now, while the caller holds the cache lock
+		i2c_eeprom_drain(dev);
+	}
+	return ticket;
+}
+
+/**
+* i2c_eeprom_ticket_status - Function to look up the state of a ticket
+* @dev: EEPROM device
+* @ticket: Ticket returned by write()
+*
+* Returns 'Q' or 'R' while the work is queued or running, else how it finished,
+* or 0 if that is not known.
+* 
+* Description: Only works whose ticket was handed out are recorded, one per
+* 				ticket % TICKET_HISTORY slot. A ticket of another EEPROM, or
+* 				one whose slot was taken by a later work, is not known.
+*/
+static unsigned char i2c_eeprom_ticket_status(struct i2c_EEPROM_dev *dev, unsigned int ticket)
+{
+	I2C_WORK_QUEUE *work;
+	unsigned char status = 0;
+	int priority;
+
+	spin_lock(&dev->queue_lock);
+	for(priority = PRIORITY_HIGH; priority < NUMBER_OF_PRIORITIES; priority++)
+	{
+		list_for_each_entry(work, &dev->queue[priority], list)
+		{
+			if(work->work_id == ticket)
+			{
+				status = work->status_Flag;
+				goto out;
+			}
+		}
+	}
+	if(dev->done_id[ticket % TICKET_HISTORY] == ticket)
+	{
+		status = dev->done_status[ticket % TICKET_HISTORY];
+	}
+out:
+	spin_unlock(&dev->queue_lock);
+	return status;
+}
+
+/**
+* i2c_eeprom_queue_idle - Function to check that no work is queued or running
+* @dev: EEPROM device
+*
+* Returns 1 if the read and write queues are empty, or else 0. Background reads do not count.
+*/
+static int i2c_eeprom_queue_idle(struct i2c_EEPROM_dev *dev)
+{
+	int idle;
+
+	spin_lock(&dev->queue_lock);
+	idle = !i2c_eeprom_submitted(dev) && list_empty(&dev->queue[PRIORITY_HIGH]) && list_empty(&dev->queue[PRIORITY_LOW]);
+	spin_unlock(&dev->queue_lock);
+	return idle;
+}
+
+/**
+* i2c_eeprom_queue_load - Function to count the pages still to do in the queues
+* @dev: EEPROM device
+*
+* Returns the number of pages.
+*/
+static unsigned long i2c_eeprom_queue_load(struct i2c_EEPROM_dev *dev)
+{
+	I2C_WORK_QUEUE *work;
+	unsigned long load = 0;
+	int priority;
+
+	spin_lock(&dev->queue_lock);
+	for(priority = PRIORITY_HIGH; priority < NUMBER_OF_PRIORITIES; priority++)
+	{
+		list_for_each_entry(work, &dev->queue[priority], list)
+		{
+			load += work->queue_Data.count - work->pages_done;
+		}
+	}
+	spin_unlock(&dev->queue_lock);
+	return load;
+}
+
+/**
+* i2c_eeprom_wait_ticket - Function to wait until a queued work has finished
+* @dev: EEPROM device
+* @ticket: Ticket returned by write()
+*
+* Returns 0 once the work is on the chip, -ECANCELED if it was cancelled,
+* -EIO if it failed, -ESTALE if how it finished is no longer known, or
+* -EINVAL for ticket 0.
+* 
+* Description: This function is the FLASHWAIT entry point. A write counts as
+* 				finished only when the write cycle of its last page has ended.
+*/
+static long i2c_eeprom_wait_ticket(struct i2c_EEPROM_dev *dev, unsigned int ticket)
+{
+	unsigned char status;
+
+	if(ticket == 0)
+	{
+		return -EINVAL;
+	}
+	//The ticket may still be on the submission list
+	mutex_lock(&dev->cache_lock);
+	i2c_eeprom_drain(dev);
+	mutex_unlock(&dev->cache_lock);
+	if(wait_event_interruptible(dev->done_wait,
+			(status = i2c_eeprom_ticket_status(dev, ticket)) != 'Q' && status != 'R'))
+	{
+		return -ERESTARTSYS;
+	}
+	if(status == 'C')
+	{
+		return -ECANCELED;
+	}
+	if(status == 'F')
+	{
+		return -EIO;
+	}
+	if(status != 'D')
+	{
+		return -ESTALE;
+	}
+	i2c_eeprom_wait_write_cycle(dev);
+	return 0;
+}
+
+/**
+* i2c_eeprom_flush - Function to wait until all queued work has finished
+* @dev: EEPROM device
+*
+* Returns 0 once every queued work is done and the chip has finished writing.
+* 
+* Description: This function is the FLASHFLUSH and fsync entry point. Pages held in
+* 				the write cache are queued first.
+*/
+static long i2c_eeprom_flush(struct i2c_EEPROM_dev *dev)
+{
+	if(i2c_eeprom_flush_cache(dev) < 0)
+	{
+		return -ENOMEM;
+	}
+	if(wait_event_interruptible(dev->done_wait, i2c_eeprom_queue_idle(dev)))
+	{
+		return -ERESTARTSYS;
+	}
+	i2c_eeprom_wait_write_cycle(dev);
+	return 0;
+}
+
+/**
+* i2c_eeprom_next_work - Function to pick the work to run next
+* @dev: EEPROM device
+*
+* Returns the oldest work of the highest non-empty priority class, or NULL.
+* 
+* Description: The work stays queued until it finishes, the caller runs one slice
+* 				of it and asks again, so a read queued meanwhile is picked next.
+*/
+static I2C_WORK_QUEUE *i2c_eeprom_next_work(struct i2c_EEPROM_dev *dev)
+{
+	I2C_WORK_QUEUE *work = NULL;
+	int priority;
+
+	spin_lock(&dev->queue_lock);
+	for(priority = PRIORITY_HIGH; priority < NUMBER_OF_PRIORITIES; priority++)
+	{
+		if(!list_empty(&dev->queue[priority]))
+		{
+			work = list_first_entry(&dev->queue[priority], I2C_WORK_QUEUE, list);
+			work->status_Flag = 'R';
+			break;
+		}
+	}
+	spin_unlock(&dev->queue_lock);
+	return work;
+}
+
+/**
+* i2c_eeprom_volume_io_put - Function to drop one reference to a volume request
+* @io: Volume request
+*
+* Returns void.
+* 
+* Description: Every member work and the submitter hold one reference. The
+* 				last one completes a request somebody waits for, or frees a
+* 				detached one.
+*/
+static void i2c_eeprom_volume_io_put(struct i2c_eeprom_volume_io *io)
+{
+	if(atomic_dec_and_test(&io->pending))
+	{
+		if(io->detached)
+		{
+			kfree(io);
+		}
+		else
+		{
+			complete(&io->done);
+		}
+	}
+}
+
+/**
+* i2c_eeprom_finish_work - Function to publish the result of a finished work
+* @dev: EEPROM device
+* @work: Finished work, already off the queue
+* @result: Negative errno, or else 0
+*
+* Returns void.
+*/
+static void i2c_eeprom_finish_work(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work, int result)
+{
+	struct i2c_eeprom_file *ctx;
+
+	if(work->io != NULL)
+	{
+		//Part of a volume request, the read buffer belongs to the request
+		if(work->read_or_write == 'R')
+		{
+			kfree(work->covered);
+		}
+		else
+		{
+			kfree(work->queue_Data.buf);
+		}
+		work->io->result[work->part] = result;
+		i2c_eeprom_volume_io_put(work->io);
+		kfree(work);
+		wake_up_all(&dev->done_wait);
+		return;
+	}
+	switch(work->read_or_write)
+	{
+		case 'R':
+			ctx = work->queue_Data.file->private_data;
+			kfree(work->covered);
+			if(result < 0)
+			{
+				kfree(work->queue_Data.buf);
+				ctx->read_error = result;
+			}
+			else
+			{
+				ctx->read_buffer = work->queue_Data.buf;
+				ctx->read_count = work->queue_Data.count;
+				ctx->read_ready = 1;
+			}
+			//Last touch of the file, release may free it from here on
+			smp_wmb();
+			ctx->read_pending = 0;
+			break;
+		case 'W':
+			kfree(work->queue_Data.buf);
+			break;
+		case 'E':
+			kfree(work->queue_Data.buf);
+			dev->erase_status = (result == 0) ? 'D' : (result == -ECANCELED) ? 'C' : 'F';
+			break;
+		case 'V':
+			i2c_eeprom_scrub_done(dev, work, result);
+			kfree(work->covered);
+			kfree(work->queue_Data.buf);
+			break;
+		case 'P':
+			i2c_eeprom_warm_done(dev, work, result);
+			kfree(work->covered);
+			kfree(work->queue_Data.buf);
+			break;
+		default:
+			break;
+	}
+	kfree(work);
+	wake_up_all(&dev->done_wait);
+}
+
+/**
+* i2c_eeprom_next_device - Function to pick the EEPROM the bus serves next
+* @bus: EEPROMs sharing the adapter
+* @wait: Set to the microseconds until the first busy EEPROM with work is ready, or -1
+*
+* Returns the EEPROM to serve, or NULL if none can be served now.
+* 
+* Description: A chip in its write cycle does not answer, so it is passed over and
+* 				the bus goes to another chip meanwhile. Chips with reads pending
+* 				go first, chips of the same class are served round robin.
+*/
+static struct i2c_EEPROM_dev *i2c_eeprom_next_device(struct i2c_eeprom_bus *bus, s64 *wait)
+{
+	struct i2c_EEPROM_dev *dev;
+	unsigned int i, index;
+	int priority, pending;
+	s64 remaining;
+
+	*wait = -1;
+	for(priority = PRIORITY_HIGH; priority < NUMBER_OF_PRIORITIES; priority++)
+	{
+		for(i = 0; i < bus->number_of_devices; i++)
+		{
+			index = (bus->next_device + i) % bus->number_of_devices;
+			dev = bus->devices[index];
+			spin_lock(&dev->queue_lock);
+			pending = !list_empty(&dev->queue[priority]);
+			spin_unlock(&dev->queue_lock);
+			if(!pending)
+			{
+				continue;
+			}
+			remaining = ktime_us_delta(dev->write_cycle_end, ktime_get());
+			if(remaining <= 0)
+			{
+				bus->next_device = (index + 1) % bus->number_of_devices;
+				return dev;
+			}
+			if(*wait < 0 || remaining < *wait)
+			{
+				*wait = remaining;
+			}
+		}
+	}
+	return NULL;
+}
+
+/**
+* i2c_eeprom_bus_pending - Function to check for work on any EEPROM of an adapter
+* @bus: EEPROMs sharing the adapter
+*
+* Returns 1 if a work is submitted or queued, or else 0.
+*/
+static int i2c_eeprom_bus_pending(struct i2c_eeprom_bus *bus)
+{
+	struct i2c_EEPROM_dev *dev;
+	unsigned int i;
+	int priority, pending = 0;
+
+	for(i = 0; i < bus->number_of_devices && !pending; i++)
+	{
+		dev = bus->devices[i];
+		pending = i2c_eeprom_submitted(dev);
+		spin_lock(&dev->queue_lock);
+		for(priority = PRIORITY_HIGH; priority < NUMBER_OF_PRIORITIES && !pending; priority++)
+		{
+			pending = !list_empty(&dev->queue[priority]);
+		}
+		spin_unlock(&dev->queue_lock);
+	}
+	return pending;
+}
+
+/**
+* i2c_eeprom_dispatch_fn - Function run by the dispatcher thread of an adapter
+* @data: EEPROMs sharing the adapter
+*
+* Returns 0 when the thread is stopped and no work is left.
+*
+* Description: Runs the queued work of the EEPROMs on one adapter and sleeps only
+* when nothing is submitted or queued. Submitters push their work on a lock free
+* list per EEPROM and the thread takes each list whole, so a burst of requests
+* costs one lock and one wake up. Reads run whole, writes and erases one page at
+* a time, and the next slice of a chip is always taken from its highest priority
+* class with work pending. A read therefore waits for at most one page write, even
+* during a full chip erase. While one chip programs a page the bus serves the other
+* chips, so their write cycles overlap.
+*/
+static int i2c_eeprom_dispatch_fn(void *data)
+{
+	struct i2c_eeprom_bus *bus = data;
+	struct i2c_EEPROM_dev *dev;
+	I2C_WORK_QUEUE *rcvd_work;
+	unsigned int i;
+	int retValue;
+	s64 wait;
+
+	//printk("i2c_flash.c : i2c_eeprom_dispatch_fn : Start\n");
+	while(1)
+	{
+		for(i = 0; i < bus->number_of_devices; i++)
+		{
+			//The lock is only taken when there is something to forward against the cache
+			if(i2c_eeprom_submitted(bus->devices[i]))
+			{
+				mutex_lock(&(bus->devices[i]->cache_lock));
+				i2c_eeprom_drain(bus->devices[i]);
+				mutex_unlock(&(bus->devices[i]->cache_lock));
+			}
+		}
+		dev = i2c_eeprom_next_device(bus, &wait);
+		if(dev == NULL)
+		{
+			if(wait < 0)
+			{
+				//Nothing left, finish once unloading, else sleep until work is submitted
+				if(kthread_should_stop())
+				{
+					break;
+				}
+				wait_event_interruptible(bus->submit_wait, kthread_should_stop() || i2c_eeprom_bus_pending(bus));
+				continue;
+			}
+			//Every chip with work is programming a page, sleep until the first is done
+			usleep_range(wait, wait + 100);
+			continue;
+		}
+		rcvd_work = i2c_eeprom_next_work(dev);
+		if(rcvd_work == NULL)
+		{
+			continue;
+		}
+		i2c_eeprom_update_status(dev, rcvd_work);
+		if(rcvd_work->read_or_write == 'R' || rcvd_work->read_or_write == 'V')
+		{
+			retValue = i2c_eeprom_read_work(dev, rcvd_work);
+		}
+		else if(rcvd_work->read_or_write == 'P')
+		{
+			retValue = dev->warm_stop ? -ECANCELED : i2c_eeprom_read_work(dev, rcvd_work);
+		}
+		else if(rcvd_work->read_or_write == 'W' || rcvd_work->read_or_write == 'E')
+		{
+			retValue = i2c_eeprom_write_slice(dev, rcvd_work);
+		}
+		else
+		{
+			printk("Invalid work type\n");
+			retValue = -EINVAL;
+		}
+		if(retValue == 0)
+		{
+			i2c_eeprom_update_status(dev, rcvd_work);
+		}
+		else
+		{
+			retValue = (retValue < 0) ? retValue : 0;
+			spin_lock(&dev->queue_lock);
+			i2c_eeprom_retire_work(dev, rcvd_work, retValue);
+			spin_unlock(&dev->queue_lock);
+			i2c_eeprom_finish_work(dev, rcvd_work, retValue);
+		}
+	}
+	//printk("i2c_flash.c : i2c_eeprom_dispatch_fn : End\n");
+	return 0;
+}
+
+/**
+* i2c_eeprom_cancel_work - Function to cancel queued work that has not started
+* @dev: EEPROM device
+* @file: File of the caller, only its own works are cancelled
+* @ticket: Ticket returned by write(), or 0 for all work of the file not started yet
+*
+* Returns number of works cancelled, -EBUSY if the work has already started
+* or a read was served from it, or -ENOENT if it is not queued.
+* 
+* Description: This function is the FLASHCANCEL entry point. A started erase is
+* 				stopped with FLASHERASEC instead. Works the driver queued itself,
+* 				the flushes of the write cache, FLASHCAS, log, volume, warm-up,
+* 				scrub and nvmem works, have no file and are never cancelled.
+*/
+static long i2c_eeprom_cancel_work(struct i2c_EEPROM_dev *dev, struct file *file, unsigned int ticket)
+{
+	I2C_WORK_QUEUE *work, *next;
+	LIST_HEAD(cancelled);
+	long retValue = 0;
+	int priority;
+
+	mutex_lock(&dev->cache_lock);
+	i2c_eeprom_drain(dev);
+	mutex_unlock(&dev->cache_lock);
+	spin_lock(&dev->queue_lock);
+	for(priority = PRIORITY_HIGH; priority < NUMBER_OF_PRIORITIES; priority++)
+	{
+		list_for_each_entry_safe(work, next, &dev->queue[priority], list)
+		{
+			if(work->queue_Data.file != file || (ticket != 0 && work->work_id != ticket))
+			{
+				continue;
+			}
+			//A read already returned the data of a forwarded write, it must reach the chip
+			if(work->status_Flag != 'Q' || work->forwarded || (work->read_or_write == 'E' && dev->erase_forwarded))
+			{
+				if(ticket != 0)
+				{
+					retValue = -EBUSY;
+				}
+				continue;
+			}
+			i2c_eeprom_retire_work(dev, work, -ECANCELED);
+			list_add_tail(&work->list, &cancelled);
+			retValue++;
+		}
+	}
+	spin_unlock(&dev->queue_lock);
+	list_for_each_entry_safe(work, next, &cancelled, list)
+	{
+		list_del(&work->list);
+		i2c_eeprom_finish_work(dev, work, -ECANCELED);
+	}
+	if(ticket != 0 && retValue == 0)
+	{
+		retValue = -ENOENT;
+	}
+	return retValue;
+}
+
+/**
+* i2c_eeprom_flush_cache - Function to queue the dirty pages of the write cache
+* @dev: EEPROM device
+*
+* Returns number of pages queued, or negative errno.
+* 
+* Description: Every run of consecutive dirty pages becomes one queued write.
+* 				Called by the timed flush, fsync, close and unload.
+*/
+static int i2c_eeprom_flush_cache(struct i2c_EEPROM_dev *dev)
+{
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int numberOfPages = dev->geometry.number_of_pages;
+	unsigned long first, last, page;
+	I2C_WORK_QUEUE *send_work_queue;
+	char *writeBuffer;
+	int pages = 0;
+
+	mutex_lock(&dev->cache_lock);
+	if(dev->cache == NULL)
+	{
+		mutex_unlock(&dev->cache_lock);
+		return 0;
+	}
+	first = find_next_bit(dev->dirty, numberOfPages, 0);
+	while(first < numberOfPages)
+	{
+		last = find_next_zero_bit(dev->dirty, numberOfPages, first);
+		writeBuffer = kmalloc((last - first) * dev->frame_size, GFP_KERNEL);
+		send_work_queue = (I2C_WORK_QUEUE *)kzalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+		if(writeBuffer == NULL || send_work_queue == NULL)
+		{
+			printk("Failure in malloc during cache flush\n");
+			kfree(writeBuffer);
+			kfree(send_work_queue);
+			mutex_unlock(&dev->cache_lock);
+			return -ENOMEM;
+		}
+		for(page = first; page < last; page++)
+		{
+			memcpy(&writeBuffer[((page - first) * dev->frame_size) + dev->geometry.address_bytes], &(dev->cache[page * pageSize]), pageSize);
+		}
+		bitmap_clear(dev->dirty, first, last - first);
+		send_work_queue->read_or_write     = 'W';
+		send_work_queue->io                = NULL;
+		send_work_queue->start             = first * pageSize;
+		send_work_queue->queue_Data.file   = NULL;
+		send_work_queue->queue_Data.buf    = writeBuffer;
+		send_work_queue->queue_Data.count  = last - first;
+		send_work_queue->queue_Data.offset = NULL;
+		i2c_eeprom_queue_work(dev, send_work_queue);
+		pages += last - first;
+		first = find_next_bit(dev->dirty, numberOfPages, last);
+	}
+	if(pages)
+	{
+		dev->cache_flushes++;
+		dev->cache_flushed_pages += pages;
+	}
+	mutex_unlock(&dev->cache_lock);
+	return pages;
+}
+
+/**
+* i2c_eeprom_flush_cache_fn - Function run by the timer to flush the write cache
+* @work: Flush work of the device
+*
+* Returns void
+*/
+static void i2c_eeprom_flush_cache_fn(struct work_struct *work)
+{
+	struct i2c_EEPROM_dev *dev = container_of(to_delayed_work(work), struct i2c_EEPROM_dev, flush_work);
+
+	i2c_eeprom_flush_cache(dev);
+}
+
+/**
+* i2c_eeprom_scrub_record - Function to remember the checksum of a page written
+* @dev: EEPROM device
+* @page: Page
+* @data: Page data now on the chip
+*
+* Returns void.
+*/
+static void i2c_eeprom_scrub_record(struct i2c_EEPROM_dev *dev, unsigned int page, const char *data)
+{
+	if(dev->scrub_known == NULL)
+	{
+		return;
+	}
+	dev->scrub_crc[page] = crc32_le(~0, data, dev->geometry.page_size);
+	set_bit(page, dev->scrub_known);
+}
+
+/**
+* i2c_eeprom_scrub_fn - Function run by the timer to queue the next page of the scrub
+* @work: Scrub work of the device
+*
+* Returns void
+* 
+* Description: A page is queued only while no read or write is queued, and in the
+* 				lowest priority class, so it never runs ahead of foreground work.
+*/
+static void i2c_eeprom_scrub_fn(struct work_struct *work)
+{
+	struct i2c_EEPROM_dev *dev = container_of(to_delayed_work(work), struct i2c_EEPROM_dev, scrub_work);
+	I2C_WORK_QUEUE *send_work_queue;
+
+	if(dev->scrub_stop)
+	{
+		return;
+	}
+	if(!i2c_eeprom_queue_idle(dev))
+	{
+		schedule_delayed_work(&dev->scrub_work, msecs_to_jiffies(SCRUB_IDLE_RETRY));
+		return;
+	}
+	send_work_queue = (I2C_WORK_QUEUE *)kzalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+	if(send_work_queue != NULL)
+	{
+		send_work_queue->covered = kcalloc(1, sizeof(unsigned long), GFP_KERNEL);
+		send_work_queue->queue_Data.buf = kmalloc(dev->geometry.page_size, GFP_KERNEL);
+	}
+	if(send_work_queue == NULL || send_work_queue->covered == NULL || send_work_queue->queue_Data.buf == NULL)
+	{
+		if(send_work_queue != NULL)
+		{
+			kfree(send_work_queue->covered);
+			kfree(send_work_queue->queue_Data.buf);
+			kfree(send_work_queue);
+		}
+		schedule_delayed_work(&dev->scrub_work, msecs_to_jiffies(SCRUB_IDLE_RETRY));
+		return;
+	}
+	send_work_queue->read_or_write     = 'V';
+	send_work_queue->io                = NULL;
+	send_work_queue->start             = dev->scrub_next * dev->geometry.page_size;
+	send_work_queue->queue_Data.file   = NULL;
+	send_work_queue->queue_Data.count  = 1;
+	send_work_queue->queue_Data.offset = NULL;
+	dev->scrub_queued = ktime_get();
+	i2c_eeprom_queue_work(dev, send_work_queue);
+}
+
+/**
+* i2c_eeprom_scrub_done - Function to check a page read back by the scrub
+* @dev: EEPROM device
+* @work: Finished scrub read
+* @result: Negative errno, or else 0
+*
+* Returns void.
+* 
+* Description: A page with a known checksum must still match it, the others get
+* 				their checksum from this read. The next page is queued after a
+* 				pause that keeps the scrub to scrub_share percent of the bus time.
+*/
+static void i2c_eeprom_scrub_done(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work, int result)
+{
+	unsigned int page = work->start / dev->geometry.page_size;
+	u32 crc;
+	s64 elapsed, pause, passTime;
+
+	if(result == 0)
+	{
+		crc = crc32_le(~0, work->queue_Data.buf, dev->geometry.page_size);
+		dev->scrub_verified++;
+		if(!test_bit(page, dev->scrub_known))
+		{
+			dev->scrub_crc[page] = crc;
+			set_bit(page, dev->scrub_known);
+		}
+		else if(dev->scrub_crc[page] != crc)
+		{
+			dev->scrub_bad++;
+			printk("%s: page %u does not match its checksum\n", dev->name, page);
+		}
+	}
+	else if(result != -ECANCELED)
+	{
+		dev->scrub_bad++;
+		printk("%s: page %u can not be read: %d\n", dev->name, page, result);
+	}
+	if(result != -ECANCELED)
+	{
+		dev->scrub_next = page + 1;
+	}
+	if(dev->scrub_next >= dev->geometry.number_of_pages)
+	{
+		dev->scrub_next = 0;
+		dev->scrub_passes++;
+		passTime = ktime_us_delta(ktime_get(), dev->scrub_pass_start);
+		dev->scrub_rate = (passTime > 0) ? div64_u64((u64)dev->geometry.number_of_pages * USEC_PER_SEC, passTime) : 0;
+		dev->scrub_pass_start = ktime_get();
+	}
+	if(dev->scrub_stop)
+	{
+		return;
+	}
+	elapsed = ktime_us_delta(ktime_get(), dev->scrub_queued);
+	pause = div64_u64((u64)max_t(s64, elapsed, 0) * (100 - min(scrub_share, 100U)), max(scrub_share, 1U));
+	schedule_delayed_work(&dev->scrub_work, usecs_to_jiffies(pause) + 1);
+}
+
+/**
+* i2c_eeprom_warm_up - Function to queue the background read of the whole chip
+* @dev: EEPROM device
+*
+* Returns 0, or -ENOMEM.
+*
+* Description: The chip is read WARM_UP_PAGES at a time in the background class,
+* 				so reads of pages not warm yet go ahead of it and wait for at
+* 				most one chunk. Probe does not wait for any of it.
+*/
+static int i2c_eeprom_warm_up(struct i2c_EEPROM_dev *dev)
+{
+	unsigned int page, count, numberOfPages = dev->geometry.number_of_pages;
+	I2C_WORK_QUEUE *send_work_queue;
+
+	dev->warm = kmalloc(dev->size, GFP_KERNEL);
+	dev->warm_valid = kcalloc(BITS_TO_LONGS(numberOfPages), sizeof(unsigned long), GFP_KERNEL);
+	if(dev->warm == NULL || dev->warm_valid == NULL)
+	{
+		kfree(dev->warm);
+		kfree(dev->warm_valid);
+		dev->warm = NULL;
+		dev->warm_valid = NULL;
+		return -ENOMEM;
+	}
+	for(page = 0; page < numberOfPages; page += count)
+	{
+		count = min_t(unsigned int, WARM_UP_PAGES, numberOfPages - page);
+		send_work_queue = (I2C_WORK_QUEUE *)kzalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+		if(send_work_queue != NULL)
+		{
+			send_work_queue->covered = kcalloc(BITS_TO_LONGS(count), sizeof(unsigned long), GFP_KERNEL);
+			send_work_queue->queue_Data.buf = kmalloc(count * dev->geometry.page_size, GFP_KERNEL);
+		}
+		if(send_work_queue == NULL || send_work_queue->covered == NULL || send_work_queue->queue_Data.buf == NULL)
+		{
+			//The pages not queued are read from the chip on every read
+			if(send_work_queue != NULL)
+			{
+				kfree(send_work_queue->covered);
+				kfree(send_work_queue->queue_Data.buf);
+				kfree(send_work_queue);
+			}
+			printk("%s: warm-up stopped at page %u, no memory\n", dev->name, page);
+			break;
+		}
+		send_work_queue->read_or_write     = 'P';
+		send_work_queue->io                = NULL;
+		send_work_queue->start             = page * dev->geometry.page_size;
+		send_work_queue->queue_Data.file   = NULL;
+		send_work_queue->queue_Data.count  = count;
+		send_work_queue->queue_Data.offset = NULL;
+		i2c_eeprom_queue_work(dev, send_work_queue);
+	}
+	return 0;
+}
+
+/**
+* i2c_eeprom_warm_done - Function to take a finished warm-up read into the copy
+* @dev: EEPROM device
+* @work: Finished warm-up read
+* @result: Negative errno, or else 0
+*
+* Returns void.
+*
+* Description: Pages a write has made valid meanwhile are left alone, the write
+* 				ran after this read and its data is newer.
+*/
+static void i2c_eeprom_warm_done(struct i2c_EEPROM_dev *dev, I2C_WORK_QUEUE *work, int result)
+{
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int i, page = work->start / pageSize;
+
+	if(result < 0)
+	{
+		if(result != -ECANCELED)
+		{
+			printk("%s: warm-up read of pages %u to %u failed: %d\n", dev->name, page, page + work->queue_Data.count - 1, result);
+		}
+		return;
+	}
+	for(i = 0; i < work->queue_Data.count; i++, page++)
+	{
+		if(test_bit(page, dev->warm_valid))
+		{
+			continue;
+		}
+		memcpy(&(dev->warm[page * pageSize]), &(work->queue_Data.buf[i * pageSize]), pageSize);
+		smp_wmb();
+		set_bit(page, dev->warm_valid);
+	}
+	dev->warm_pages += work->queue_Data.count;
+	if(dev->warm_pages == dev->geometry.number_of_pages)
+	{
+		dev->warm_time_us = max_t(s64, ktime_us_delta(ktime_get(), dev->probed), 1);
+		printk("%s: whole chip warm %lld us after probe\n", dev->name, dev->warm_time_us);
+	}
+}
+
+/**
+* i2c_eeprom_cache_write - Function to absorb a write in the write cache
+* @ctx: Open file writing
+* @buf: Page data in user space
+* @count: Number of pages
+*
+* Returns 0, -EFAULT if a page can not be copied or -ENOMEM if the cache can not be allocated.
+* 
+* Description: The pages are copied to the cache at the file position and the
+* 				flush is armed. A page written again before the flush costs no bus
+* 				time, the flush is not pushed back, so no page stays in RAM for
+* 				longer than write_delay.
+*/
+static int i2c_eeprom_cache_write(struct i2c_eeprom_file *ctx, const char __user *buf, size_t count)
+{
+	struct i2c_EEPROM_dev *dev = ctx->dev;
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int numberOfPages = dev->geometry.number_of_pages;
+	unsigned int i, page;
+	int retValue = 0;
+
+	mutex_lock(&dev->cache_lock);
+	if(dev->cache == NULL)
+	{
+		dev->cache = kmalloc(dev->size, GFP_KERNEL);
+		dev->dirty = kcalloc(BITS_TO_LONGS(numberOfPages), sizeof(unsigned long), GFP_KERNEL);
+		if(dev->cache == NULL || dev->dirty == NULL)
+		{
+			kfree(dev->cache);
+			kfree(dev->dirty);
+			dev->cache = NULL;
+			dev->dirty = NULL;
+			mutex_unlock(&dev->cache_lock);
+			return -ENOMEM;
+		}
+	}
+	page = i2c_eeprom_claim_pointer(dev, ctx, count * pageSize, 0) / pageSize;
+	for(i = 0; i < count; i++, page = (page + 1) % numberOfPages)
+	{
+		//Straight from userspace into the cache, no bounce buffer
+		if(copy_from_user(&(dev->cache[page * pageSize]), &buf[i * pageSize], pageSize))
+		{
+			retValue = -EFAULT;
+			break;
+		}
+		if(test_and_set_bit(page, dev->dirty))
+		{
+			dev->cache_absorbed_pages++;
+		}
+	}
+	mutex_unlock(&dev->cache_lock);
+	schedule_delayed_work(&dev->flush_work, msecs_to_jiffies(write_delay));
+	return retValue;
+}
+
+/**
+* i2c_eeprom_write_into_queue - Function to add job into the worker thread for write operation
+* 
+* @file: Work Data Structure
+* @buf: Data Buffer
+* @count: Count of number of pages.
+* @offset: offset position pointer
+*
+* Returns the ticket of the queued write, or negative errno.
+* 
+* Description: This function is the .write function entry point from the user space. After receiving
+* the request from the user, the job is assigned to workers thread and is immediately returned back
+* to user space. So this makes the function to appear as Non Blocking call. The write is queued even
+* while the EEPROM is busy, it runs behind the writes already queued. The returned ticket can be
+* passed to FLASHWAIT or FLASHCANCEL. With write_delay set the pages are kept in the write cache
+* instead and 0 is returned, fsync or FLASHFLUSH push them to the chip.
+*/
+static ssize_t i2c_eeprom_write_into_queue(struct file *file, const char __user *buf, size_t count, loff_t *offset)
+{
+	struct i2c_eeprom_file *ctx = file->private_data;
+	struct i2c_EEPROM_dev *dev = ctx->dev;
+	char *writeBuffer;
+	I2C_WORK_QUEUE *send_work_queue;
+	unsigned int ticket, frameSize;
+	size_t i;
+	int retValue;
+	unsigned int pageSize = dev->geometry.page_size;
+	//printk("i2c_flash.c : i2c_eeprom_write_into_queue : Start\n");
+	if(count < 1 || count > dev->geometry.number_of_pages)
+	{
+		printk("Invalid Input for Page Number\n");
+		return 0;
+	}
+	if(dev->bus->thread == NULL)
+	{
+		printk("Dispatcher thread is not running\n");
+		return 0;
+	}
+	if(write_delay != 0)
+	{
+		retValue = i2c_eeprom_cache_write(ctx, (const char __user *)buf, count);
+		if(retValue != -ENOMEM)
+		{
+			return retValue;
+		}
+	}
+	//Each page is copied behind its address slot, ready to go to the bus
+	frameSize = dev->frame_size;
+	writeBuffer = kmalloc((count*frameSize), GFP_KERNEL);
+	if (writeBuffer == NULL)
+	{
+		printk("Failure in malloc during write\n");
+		return -ENOMEM;
+	}
+	for(i = 0; i < count; i++)
+	{
+		if(copy_from_user(&writeBuffer[(i*frameSize) + (frameSize - pageSize)], (void __user *)&buf[i*pageSize], pageSize))
+		{
+			printk("Error: copy from user");
+			kfree(writeBuffer);
+			return -EFAULT;
+		}
+	}
+	//Pages left in the cache go first, so the writes reach the chip in order
+	i2c_eeprom_flush_cache(dev);
+	send_work_queue = (I2C_WORK_QUEUE *)kmalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+	if (send_work_queue == NULL)
+	{
+		printk("Failure in malloc during write_transfer\n");
+		kfree(writeBuffer);
+		return -ENOMEM;
+	}
+	send_work_queue->read_or_write     = 'W';
+	send_work_queue->io                = NULL;
+	send_work_queue->queue_Data.file   = file;
+	send_work_queue->queue_Data.buf    = writeBuffer;
+	send_work_queue->queue_Data.count  = count;
+	send_work_queue->queue_Data.offset = offset;
+	ticket = i2c_eeprom_queue_work(dev, send_work_queue);
+	printk("Write Work %u Successfully added in Work Queue\n", ticket);
+	//printk("i2c_flash.c : i2c_eeprom_write_into_queue : End\n");
+	return ticket;
+}
+
+/**
+* i2c_eeprom_read_from_queue - Function to add job into the worker thread for read operation 
+* 
+* @file: Work Data Structure
+* @buf: Data Buffer
+* @count: Count of number of pages.
+* @offset: offset position pointer
+*
+* Returns ssize_t
+* 
+* Description: This function is the .read function entry point from the user space. After receiving
+* the request from the user, the job is assigned to workers thread and is immediately returned back
+* to user space. So this makes the function to appear as Non Blocking call. Reads are queued with
+* high priority, so they run ahead of queued writes and between the pages of a long write or erase.
+* The data is returned by the first call after the read has completed, or at once if every page
+* of the read is covered by writes still in the queue.
+*/
+static ssize_t i2c_eeprom_read_from_queue(struct file *file, char __user *buf, size_t count, loff_t *offset)
+{
+	struct i2c_eeprom_file *ctx = file->private_data;
+	struct i2c_EEPROM_dev *dev = ctx->dev;
+	int retValue = 0;
+	char *readBuffer;
+	unsigned long *covered;
+	I2C_WORK_QUEUE *send_work_queue;
+	unsigned int pageSize = dev->geometry.page_size;
+	//printk("i2c_flash.c : i2c_eeprom_read_from_queue : Start\n");
+	if(count < 1 || count > dev->geometry.number_of_pages)
+	{
+		printk("Invalid Input for Page Number\n");
+		return 0;
+	}
+	if(dev->bus->thread == NULL)
+	{
+		printk("Dispatcher thread is not running\n");
+		return retValue;
+	}
+	if(ctx->read_error != 0 && ctx->read_pending == 0)
+	{
+		//The last read of this file failed on the chip
+		retValue = ctx->read_error;
+		ctx->read_error = 0;
+		return retValue;
+	}
+	if(ctx->read_ready == 0)
+	{
+		/* One read in flight per file, the caller polls until it completes */
+		if(xchg(&(ctx->read_pending), 1))
+		{
+			return -1;
+		}
+		readBuffer = kzalloc(count*pageSize, GFP_KERNEL);
+		send_work_queue = (I2C_WORK_QUEUE *)kmalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+		covered = kcalloc(BITS_TO_LONGS(count), sizeof(unsigned long), GFP_KERNEL);
+		if(readBuffer == NULL || send_work_queue == NULL || covered == NULL)
+		{
+			printk("Failure in malloc during read\n");
+			kfree(readBuffer);
+			kfree(send_work_queue);
+			kfree(covered);
+			ctx->read_pending = 0;
+			return -ENOMEM;
+		}
+		send_work_queue->read_or_write     = 'R';
+		send_work_queue->io                = NULL;
+		send_work_queue->covered           = covered;
+		send_work_queue->queue_Data.file   = file;
+		send_work_queue->queue_Data.buf    = readBuffer;
+		send_work_queue->queue_Data.count  = count;
+		send_work_queue->queue_Data.offset = offset;
+		mutex_lock(&(dev->cache_lock));
+		i2c_eeprom_queue_work(dev, send_work_queue);
+		mutex_unlock(&(dev->cache_lock));
+		if(ctx->read_ready == 0)
+		{
+			printk("Successfully queued readqueue\n");
+			return -1;
+		}
+		//Served from the queued writes, hand the data over right away
+	}
+	if(dev->first_read_us == 0)
+	{
+		dev->first_read_us = max_t(s64, ktime_us_delta(ktime_get(), dev->probed), 1);
+	}
+	retValue = copy_to_user((void *)buf, ctx->read_buffer, (min(count, ctx->read_count)*pageSize));
+	ctx->read_ready = 0;
+	if(ctx->read_buffer != NULL)
+	{
+		kfree(ctx->read_buffer);
+		ctx->read_buffer = NULL;
+	}
+	retValue = 0;
+	return retValue;
+	//printk("i2c_flash.c : i2c_eeprom_read_from_queue : End\n");
+}
+
+/**
+* i2c_eeprom_erase_into_queue - Function to add job into the worker thread for erase operation
+* 
+* @file: File Pointer
+*
+* Returns 0, or -EBUSY if an erase is already queued.
+* 
+* Description: This function is the FLASHERASE entry point from the user space. The
+* erase is assigned to workers thread behind the writes already queued and the call
+* returns immediately. FLASHERASEP reports the progress and FLASHERASEC cancels it.
+*/
+static long i2c_eeprom_erase_into_queue(struct file *file)
+{
+	struct i2c_eeprom_file *ctx = file->private_data;
+	struct i2c_EEPROM_dev *dev = ctx->dev;
+	I2C_WORK_QUEUE *send_work_queue;
+	char *eraseBuffer;
+	unsigned int status;
+
+	if(dev->bus->thread == NULL)
+	{
+		printk("Dispatcher thread is not running\n");
+		return -1;
+	}
+	/* Only one erase at a time, claim the slot before touching the progress */
+	status = dev->erase_status;
+	if(status == 'Q' || status == 'R' || cmpxchg(&(dev->erase_status), status, 'Q') != status)
+	{
+		printk("Resource (EEPROM) is Busy\n");
+		return -EBUSY;
+	}
+	//Pages written before the erase must not land on the chip after it
+	i2c_eeprom_flush_cache(dev);
+	eraseBuffer = kmalloc(dev->frame_size, GFP_KERNEL);
+	send_work_queue = (I2C_WORK_QUEUE *)kmalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+	if(eraseBuffer == NULL || send_work_queue == NULL)
+	{
+		printk("Failure in malloc during erase_transfer\n");
+		kfree(eraseBuffer);
+		kfree(send_work_queue);
+		dev->erase_status = status;
+		return -ENOMEM;
+	}
+	memset(&eraseBuffer[dev->geometry.address_bytes], 0xFF, dev->geometry.page_size);
+	dev->erase_done   = 0;
+	dev->erase_total  = dev->geometry.number_of_pages;
+	dev->erase_cancel = 0;
+	dev->erase_forwarded = 0;
+
+	send_work_queue->read_or_write     = 'E';
+	send_work_queue->io                = NULL;
+	send_work_queue->queue_Data.file   = file;
+	send_work_queue->queue_Data.buf    = eraseBuffer;
+	send_work_queue->queue_Data.count  = dev->erase_total;
+	send_work_queue->queue_Data.offset = NULL;
+	i2c_eeprom_queue_work(dev, send_work_queue);
+	return 0;
+}
+
+/**
+* i2c_eeprom_sync_work - Function to queue work for the driver itself and wait for it
+* @dev: EEPROM device
+* @type: 'R' or 'W'
+* @start: Memory offset
+* @buf: Pages for a read, frames for a write, freed with the work
+* @count: Number of pages
+*
+* Returns 0, or negative errno.
+* 
+* Description: The work goes through the same queues as the character device,
+* 				so a read sees the write cache and the writes queued before it.
+*/
+static int i2c_eeprom_sync_work(struct i2c_EEPROM_dev *dev, unsigned char type, unsigned int start, char *buf, size_t count)
+{
+	struct i2c_eeprom_volume_io io;
+	I2C_WORK_QUEUE *send_work_queue;
+
+	send_work_queue = (I2C_WORK_QUEUE *)kzalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+	if(send_work_queue == NULL)
+	{
+		return -ENOMEM;
+	}
+	if(type == 'R')
+	{
+		send_work_queue->covered = kcalloc(BITS_TO_LONGS(count), sizeof(unsigned long), GFP_KERNEL);
+		if(send_work_queue->covered == NULL)
+		{
+			kfree(send_work_queue);
+			return -ENOMEM;
+		}
+	}
+	atomic_set(&io.pending, 1);
+	io.detached = 0;
+	init_completion(&io.done);
+	send_work_queue->read_or_write     = type;
+	send_work_queue->io                = &io;
+	send_work_queue->part              = 0;
+	send_work_queue->start             = start;
+	send_work_queue->queue_Data.file   = NULL;
+	send_work_queue->queue_Data.buf    = buf;
+	send_work_queue->queue_Data.count  = count;
+	send_work_queue->queue_Data.offset = NULL;
+	mutex_lock(&dev->cache_lock);
+	i2c_eeprom_queue_work(dev, send_work_queue);
+	mutex_unlock(&dev->cache_lock);
+	wait_for_completion(&io.done);
+	return io.result[0];
+}
+
+/**
+* i2c_eeprom_compare_and_swap - Function to update bytes of a page only if they hold what the caller expects
+* @dev: EEPROM device
+* @user: Request in user space
+*
+* Returns the ticket of the queued write, 0 if the page was updated in the write
+* cache, -EAGAIN if the bytes did not match, or negative errno.
+* 
+* Description: This function is the FLASHCAS entry point from the user space. The
+* 				compare and the write run under the read-modify-write lock, so two
+* 				FLASHCAS calls on a page never both succeed on the same old bytes.
+* 				A page dirty in the write cache is compared and updated there with
+* 				no bus traffic at all. Otherwise the page is read through the queues,
+* 				so queued writes and the warm-up copy serve it and the chip is only
+* 				read if neither holds it, and the new page is queued as a write like
+* 				any other. On a mismatch the bytes the page held are copied back to
+* 				expected, ready for the next try. Plain write() calls do not take the
+* 				lock, a page shared through FLASHCAS should only be written with it.
+*/
+static long i2c_eeprom_compare_and_swap(struct i2c_EEPROM_dev *dev, struct i2c_EEPROM_cas __user *user)
+{
+	unsigned int pageSize = dev->geometry.page_size;
+	struct i2c_EEPROM_cas request;
+	I2C_WORK_QUEUE *send_work_queue;
+	char *expected, *desired, *pageBuffer, *writeBuffer;
+	long retValue;
+
+	if(copy_from_user(&request, user, sizeof(struct i2c_EEPROM_cas)))
+	{
+		return -EFAULT;
+	}
+	if(request.page >= dev->geometry.number_of_pages || request.length == 0 ||
+		request.offset >= pageSize || request.length > (pageSize - request.offset))
+	{
+		printk("Invalid Input for Compare and Swap\n");
+		return -EINVAL;
+	}
+	if(dev->bus->thread == NULL)
+	{
+		printk("Dispatcher thread is not running\n");
+		return -1;
+	}
+	expected = kmalloc(3 * pageSize, GFP_KERNEL);
+	if(expected == NULL)
+	{
+		return -ENOMEM;
+	}
+	desired = &expected[pageSize];
+	pageBuffer = &expected[2 * pageSize];
+	if(copy_from_user(expected, (void __user *)request.expected, request.length) ||
+		copy_from_user(desired, (void __user *)request.desired, request.length))
+	{
+		kfree(expected);
+		return -EFAULT;
+	}
+	mutex_lock(&dev->rmw_lock);
+	mutex_lock(&dev->cache_lock);
+	if(dev->cache != NULL && test_bit(request.page, dev->dirty))
+	{
+		//The newest data of the page is in the cache, the flush takes the update along
+		memcpy(pageBuffer, &(dev->cache[request.page * pageSize]), pageSize);
+		retValue = -EAGAIN;
+		if(memcmp(&pageBuffer[request.offset], expected, request.length) == 0)
+		{
+			memcpy(&(dev->cache[(request.page * pageSize) + request.offset]), desired, request.length);
+			retValue = 0;
+		}
+		mutex_unlock(&dev->cache_lock);
+		goto out;
+	}
+	mutex_unlock(&dev->cache_lock);
+	retValue = i2c_eeprom_sync_work(dev, 'R', request.page * pageSize, pageBuffer, 1);
+	if(retValue < 0)
+	{
+		goto out;
+	}
+	if(memcmp(&pageBuffer[request.offset], expected, request.length) != 0)
+	{
+		retValue = -EAGAIN;
+		goto out;
+	}
+	writeBuffer = kmalloc(dev->frame_size, GFP_KERNEL);
+	send_work_queue = (I2C_WORK_QUEUE *)kzalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+	if(writeBuffer == NULL || send_work_queue == NULL)
+	{
+		kfree(writeBuffer);
+		kfree(send_work_queue);
+		retValue = -ENOMEM;
+		goto out;
+	}
+	memcpy(&writeBuffer[dev->frame_size - pageSize], pageBuffer, pageSize);
+	memcpy(&writeBuffer[(dev->frame_size - pageSize) + request.offset], desired, request.length);
+	send_work_queue->read_or_write     = 'W';
+	send_work_queue->io                = NULL;
+	send_work_queue->start             = request.page * pageSize;
+	send_work_queue->queue_Data.file   = NULL;
+	send_work_queue->queue_Data.buf    = writeBuffer;
+	send_work_queue->queue_Data.count  = 1;
+	send_work_queue->queue_Data.offset = NULL;
+	//Queued before the lock is dropped, the next FLASHCAS reads the page from this write
+	retValue = i2c_eeprom_queue_work(dev, send_work_queue);
+out:
+	mutex_unlock(&dev->rmw_lock);
+	if(retValue == -EAGAIN && copy_to_user((void __user *)request.expected, &pageBuffer[request.offset], request.length))
+	{
+		retValue = -EFAULT;
+	}
+	kfree(expected);
+	return retValue;
+}
+
+#ifdef I2C_EEPROM_NVMEM
+/**
+* i2c_eeprom_nvmem_read - Function to read bytes for a kernel consumer
+* @priv: EEPROM device
+* @offset: Byte offset
+* @val: Buffer for the bytes
+* @bytes: Number of bytes
+*
+* Returns 0, or negative errno.
+*/
+static int i2c_eeprom_nvmem_read(void *priv, unsigned int offset, void *val, size_t bytes)
+{
+	struct i2c_EEPROM_dev *dev = priv;
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int first = offset / pageSize;
+	unsigned int count = ((offset + bytes - 1) / pageSize) - first + 1;
+	char *readBuffer;
+	int retValue;
+
+	if(bytes == 0)
+	{
+		return 0;
+	}
+	readBuffer = kmalloc(count * pageSize, GFP_KERNEL);
+	if(readBuffer == NULL)
+	{
+		return -ENOMEM;
+	}
+	retValue = i2c_eeprom_sync_work(dev, 'R', first * pageSize, readBuffer, count);
+	if(retValue == 0)
+	{
+		memcpy(val, &readBuffer[offset % pageSize], bytes);
+	}
+	kfree(readBuffer);
+	return retValue;
+}
+
+/**
+* i2c_eeprom_nvmem_write - Function to write bytes for a kernel consumer
+* @priv: EEPROM device
+* @offset: Byte offset
+* @val: Bytes to write
+* @bytes: Number of bytes
+*
+* Returns 0 once the bytes are on the chip, or negative errno.
+* 
+* Description: Partly written pages are read first and written back whole. The
+* 				write cache is flushed ahead, so its older data can not land on
+* 				the chip after the new bytes.
+*/
+static int i2c_eeprom_nvmem_write(void *priv, unsigned int offset, void *val, size_t bytes)
+{
+	struct i2c_EEPROM_dev *dev = priv;
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int frameSize = dev->frame_size;
+	unsigned int first = offset / pageSize;
+	unsigned int count = ((offset + bytes - 1) / pageSize) - first + 1;
+	char *pageBuffer, *writeBuffer;
+	unsigned int i;
+	int retValue = 0;
+
+	if(bytes == 0)
+	{
+		return 0;
+	}
+	pageBuffer = kmalloc(count * pageSize, GFP_KERNEL);
+	writeBuffer = kmalloc(count * frameSize, GFP_KERNEL);
+	if(pageBuffer == NULL || writeBuffer == NULL)
+	{
+		kfree(pageBuffer);
+		kfree(writeBuffer);
+		return -ENOMEM;
+	}
+	mutex_lock(&dev->rmw_lock);
+	i2c_eeprom_flush_cache(dev);
+	if((offset % pageSize) != 0 || ((offset + bytes) % pageSize) != 0)
+	{
+		retValue = i2c_eeprom_sync_work(dev, 'R', first * pageSize, pageBuffer, count);
+	}
+	if(retValue == 0)
+	{
+		memcpy(&pageBuffer[offset % pageSize], val, bytes);
+		for(i = 0; i < count; i++)
+		{
+			memcpy(&writeBuffer[(i * frameSize) + (frameSize - pageSize)], &pageBuffer[i * pageSize], pageSize);
+		}
+		retValue = i2c_eeprom_sync_work(dev, 'W', first * pageSize, writeBuffer, count);
+		writeBuffer = NULL;
+	}
+	mutex_unlock(&dev->rmw_lock);
+	kfree(writeBuffer);
+	kfree(pageBuffer);
+	return retValue;
+}
+
+/**
+* i2c_eeprom_nvmem_register - Function to offer the EEPROM to kernel consumers
+* @dev: EEPROM device
+* @client: I2C client probed
+*
+* Returns void.
+* 
+* Description: nvmem cells of the client's device tree node can then be read by
+* 				other drivers without going through the character device. The
+* 				EEPROM still works as character device if this fails.
+*/
+static void i2c_eeprom_nvmem_register(struct i2c_EEPROM_dev *dev, struct i2c_client *client)
+{
+	struct nvmem_config config;
+
+	memset(&config, 0, sizeof(struct nvmem_config));
+	config.name      = dev->name;
+	config.id        = dev->minor;
+	config.dev       = &client->dev;
+	config.owner     = THIS_MODULE;
+	config.read_only = false;
+	config.word_size = 1;
+	config.stride    = 1;
+	config.size      = dev->size;
+	config.priv      = dev;
+	config.reg_read  = i2c_eeprom_nvmem_read;
+	config.reg_write = i2c_eeprom_nvmem_write;
+	dev->nvmem = nvmem_register(&config);
+	if(IS_ERR(dev->nvmem))
+	{
+		printk("nvmem registration failed: %ld\n", PTR_ERR(dev->nvmem));
+		dev->nvmem = NULL;
+	}
+}
+
+/**
+* i2c_eeprom_nvmem_unregister - Function to withdraw the EEPROM from kernel consumers
+* @dev: EEPROM device
+*
+* Returns void.
+*/
+static void i2c_eeprom_nvmem_unregister(struct i2c_EEPROM_dev *dev)
+{
+	if(dev->nvmem != NULL)
+	{
+		nvmem_unregister(dev->nvmem);
+		dev->nvmem = NULL;
+	}
+}
+#endif
+
+/**
+* i2c_eeprom_volume_setup - Function to build the volume given by the volume parameter
+*
+* Returns 0, or -EINVAL if the volume can not be built from the EEPROMs.
+* 
+* Description: The geometry is only known once every member has probed, see
+* 				i2c_eeprom_volume_update().
+*/
+static int i2c_eeprom_volume_setup(void)
+{
+	struct i2c_eeprom_volume *vol;
+	int i;
+
+	if(volume == NULL || !strcmp(volume, "none"))
+	{
+		return 0;
+	}
+	if(number_of_devices < 2)
+	{
+		printk("A volume needs at least two EEPROMs\n");
+		return -EINVAL;
+	}
+	vol = kzalloc(sizeof(struct i2c_eeprom_volume), GFP_KERNEL);
+	if(vol == NULL)
+	{
+		return -ENOMEM;
+	}
+	if(!strcmp(volume, "stripe"))
+	{
+		vol->mode = VOLUME_STRIPE;
+	}
+	else if(!strcmp(volume, "mirror"))
+	{
+		vol->mode = VOLUME_MIRROR;
+	}
+	else if(!strcmp(volume, "parity") && number_of_devices >= 3)
+	{
+		vol->mode = VOLUME_PARITY;
+	}
+	else
+	{
+		printk("Unknown volume %s for %d EEPROMs\n", volume, number_of_devices);
+		kfree(vol);
+		return -EINVAL;
+	}
+	vol->number_of_members = number_of_devices;
+	for(i = 0; i < number_of_devices; i++)
+	{
+		vol->members[i] = &i2c_EEPROM_device_list[i];
+	}
+	mutex_init(&vol->lock);
+	i2c_eeprom_volume = vol;
+	return 0;
+}
+
+/**
+* i2c_eeprom_volume_update - Function to set the volume geometry from its probed members
+*
+* Returns void, the volume can not be opened until all members have probed.
+* 
+* Description: Called at the end of every probe. The members must have the same
+* 				page size, a volume of mixed page sizes stays off. Every member
+* 				gives as many pages as the smallest one has, not counting the
+* 				pages of its log. A stripe has the pages of all members, a mirror
+* 				the pages of one and a parity volume, of three members or more,
+* 				the pages of all but one.
+*/
+static void i2c_eeprom_volume_update(void)
+{
+	struct i2c_eeprom_volume *vol = i2c_eeprom_volume;
+	struct i2c_EEPROM_geometry geometry;
+	struct i2c_EEPROM_dev *dev;
+	unsigned int member, pages;
+
+	if(vol == NULL)
+	{
+		return;
+	}
+	mutex_lock(&vol->lock);
+	vol->ready = 0;
+	geometry = vol->members[0]->geometry;
+	for(member = 0; member < vol->number_of_members; member++)
+	{
+		dev = vol->members[member];
+		if(ktime_to_ns(dev->probed) == 0)
+		{
+			goto out;
+		}
+		if(dev->geometry.page_size != geometry.page_size)
+		{
+			printk("%s has %u byte pages and %s %u byte pages, the volume is off\n", vol->members[0]->name,
+				geometry.page_size, dev->name, dev->geometry.page_size);
+			goto out;
+		}
+		pages = dev->geometry.number_of_pages;
+		//The pages of a log at the end of the member are not the volume's
+		if(dev->log != NULL && dev->log->ready)
+		{
+			pages = dev->log->first_page;
+		}
+		geometry.number_of_pages = min(geometry.number_of_pages, pages);
+	}
+	if(vol->mode == VOLUME_STRIPE)
+	{
+		geometry.number_of_pages = vol->number_of_members * geometry.number_of_pages;
+	}
+	else if(vol->mode == VOLUME_PARITY)
+	{
+		geometry.number_of_pages = (vol->number_of_members - 1) * geometry.number_of_pages;
+	}
+	geometry.slave_address = 0;
+	vol->geometry = geometry;
+	vol->current_pointer = 0;
+	vol->ready = 1;
+out:
+	mutex_unlock(&vol->lock);
+}
+
+/**
+* i2c_eeprom_volume_plan - Function to split a volume request into member parts
+* @vol: Volume
+* @first: First logical page
+* @count: Number of pages
+* @type: 'R' or 'W'
+* @parts: Filled with the parts
+*
+* Returns the number of parts.
+* 
+* Description: A request running past the last page goes on at page 0, the two
+* 				sides are split on their own so that every part is one run of
+* 				pages on its member. Page j of a part is page index + j * stride
+* 				of the request.
+* 				Stripe: logical page L is page L / N of member L % N.
+* 				Mirror: writes go to every member. Each page of a read goes to the
+* 				member with the fewest queued pages, counting the pages given out.
+*/
+static unsigned int i2c_eeprom_volume_plan(struct i2c_eeprom_volume *vol, unsigned int first, size_t count,
+	unsigned char type, struct i2c_eeprom_volume_part *parts)
+{
+	unsigned int members = vol->number_of_members;
+	unsigned int pages = vol->geometry.number_of_pages;
+	unsigned long load[MAX_EEPROM_DEVICES];
+	unsigned int share[MAX_EEPROM_DEVICES];
+	unsigned int segStart = first, segLength, index = 0, numberOfParts = 0;
+	unsigned int member, least, skip, i;
+
+	if(vol->mode == VOLUME_MIRROR && type == 'R')
+	{
+		for(member = 0; member < members; member++)
+		{
+			load[member] = i2c_eeprom_queue_load(vol->members[member]);
+		}
+	}
+	while(index < count)
+	{
+		segLength = min_t(unsigned int, count - index, pages - segStart);
+		for(member = 0; member < members; member++)
+		{
+			share[member] = 0;
+		}
+		if(vol->mode == VOLUME_MIRROR && type == 'R')
+		{
+			for(i = 0; i < segLength; i++)
+			{
+				least = 0;
+				for(member = 1; member < members; member++)
+				{
+					if(load[member] < load[least])
+					{
+						least = member;
+					}
+				}
+				share[least]++;
+				load[least]++;
+			}
+		}
+		skip = 0;
+		for(member = 0; member < members; member++)
+		{
+			parts[numberOfParts].member = member;
+			parts[numberOfParts].tried  = 0;
+			parts[numberOfParts].buf    = NULL;
+			if(vol->mode == VOLUME_STRIPE)
+			{
+				skip = (member + members - (segStart % members)) % members;
+				if(skip >= segLength)
+				{
+					continue;
+				}
+				parts[numberOfParts].start  = (segStart + skip) / members;
+				parts[numberOfParts].count  = (segLength - skip + members - 1) / members;
+				parts[numberOfParts].index  = index + skip;
+				parts[numberOfParts].stride = members;
+			}
+			else if(type == 'W')
+			{
+				parts[numberOfParts].start  = segStart;
+				parts[numberOfParts].count  = segLength;
+				parts[numberOfParts].index  = index;
+				parts[numberOfParts].stride = 1;
+			}
+			else
+			{
+				if(share[member] == 0)
+				{
+					continue;
+				}
+				parts[numberOfParts].start  = segStart + skip;
+				parts[numberOfParts].count  = share[member];
+				parts[numberOfParts].index  = index + skip;
+				parts[numberOfParts].stride = 1;
+				skip += share[member];
+			}
+			numberOfParts++;
+		}
+		index += segLength;
+		segStart = 0;
+	}
+	return numberOfParts;
+}
+
+/**
+* i2c_eeprom_volume_submit - Function to queue the part of a volume request on its member
+* @vol: Volume
+* @io: Volume request
+* @number: Number of the part in the request
+* @type: 'R' or 'W'
+* @part: Part to queue, buf holds the pages for a read and the frames for a write
+*
+* Returns 0, or -ENOMEM.
+* 
+* Description: The member queues and the adapter schedulers run the part like any
+* 				other work, so the parts on different chips overlap.
+*/
+static int i2c_eeprom_volume_submit(struct i2c_eeprom_volume *vol, struct i2c_eeprom_volume_io *io, unsigned int number,
+	unsigned char type, struct i2c_eeprom_volume_part *part)
+{
+	struct i2c_EEPROM_dev *dev = vol->members[part->member];
+	I2C_WORK_QUEUE *send_work_queue;
+
+	send_work_queue = (I2C_WORK_QUEUE *)kzalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+	if(send_work_queue == NULL)
+	{
+		return -ENOMEM;
+	}
+	if(type == 'R')
+	{
+		send_work_queue->covered = kcalloc(BITS_TO_LONGS(part->count), sizeof(unsigned long), GFP_KERNEL);
+		if(send_work_queue->covered == NULL)
+		{
+			kfree(send_work_queue);
+			return -ENOMEM;
+		}
+	}
+	send_work_queue->read_or_write     = type;
+	send_work_queue->io                = io;
+	send_work_queue->part              = number;
+	send_work_queue->start             = part->start * vol->geometry.page_size;
+	send_work_queue->queue_Data.file   = NULL;
+	send_work_queue->queue_Data.buf    = part->buf;
+	send_work_queue->queue_Data.count  = part->count;
+	send_work_queue->queue_Data.offset = NULL;
+	atomic_inc(&io->pending);
+	mutex_lock(&dev->cache_lock);
+	i2c_eeprom_queue_work(dev, send_work_queue);
+	mutex_unlock(&dev->cache_lock);
+	return 0;
+}
+
+/**
+* i2c_eeprom_volume_read_parts - Function to read volume parts and wait for them
+* @vol: Volume
+* @parts: Parts to read
+* @numberOfParts: Number of parts
+* @result: Set to the outcome of each part
+*
+* Returns 0, or -ENOMEM if not all parts could be queued.
+*/
+static int i2c_eeprom_volume_read_parts(struct i2c_eeprom_volume *vol, struct i2c_eeprom_volume_part *parts,
+	unsigned int numberOfParts, int *result)
+{
+	struct i2c_eeprom_volume_io io;
+	unsigned int p;
+	int retValue = 0;
+
+	atomic_set(&io.pending, 1);
+	io.detached = 0;
+	init_completion(&io.done);
+	for(p = 0; p < numberOfParts && retValue == 0; p++)
+	{
+		retValue = i2c_eeprom_volume_submit(vol, &io, p, 'R', &parts[p]);
+	}
+	i2c_eeprom_volume_io_put(&io);
+	wait_for_completion(&io.done);
+	for(p = 0; p < numberOfParts; p++)
+	{
+		result[p] = (retValue == 0) ? io.result[p] : -ENOMEM;
+	}
+	return retValue;
+}
+
+/**
+* i2c_eeprom_xor - Function to XOR buffers into a buffer
+* @dest: Buffer XORed into
+* @srcs: Buffers to XOR
+* @count: Number of buffers in srcs
+* @bytes: Length of the buffers
+*
+* Description: The aligned bulk goes through xor_blocks(), the SIMD code the RAID
+* 				drivers use, and the tail it can not take byte by byte.
+*/
+static void i2c_eeprom_xor(void *dest, void **srcs, unsigned int count, unsigned int bytes)
+{
+	unsigned int bulk = 0, done, i, j;
+	int aligned = IS_ALIGNED((unsigned long)dest, XOR_ALIGN);
+
+	for(i = 0; i < count; i++)
+	{
+		aligned = aligned && IS_ALIGNED((unsigned long)srcs[i], XOR_ALIGN);
+	}
+	if(aligned)
+	{
+		bulk = bytes & ~(XOR_BULK_BYTES - 1);
+	}
+	for(done = 0; done < count && bulk != 0; done += MAX_XOR_BLOCKS)
+	{
+		xor_blocks(min_t(unsigned int, count - done, MAX_XOR_BLOCKS), bulk, dest, &srcs[done]);
+	}
+	for(i = bulk; i < bytes; i++)
+	{
+		for(j = 0; j < count; j++)
+		{
+			((u8 *)dest)[i] ^= ((u8 *)srcs[j])[i];
+		}
+	}
+}
+
+/**
+* i2c_eeprom_parity_map - Function to find where a parity volume page is stored
+* @vol: Volume
+* @page: Logical page
+* @row: Set to the stripe row, the page on the member
+*
+* Returns the member holding the page.
+* 
+* Description: Row r has its parity on member r % N and its N - 1 data pages on
+* 				the members after it, so the parity writes rotate over the chips.
+*/
+static unsigned int i2c_eeprom_parity_map(struct i2c_eeprom_volume *vol, unsigned int page, unsigned int *row)
+{
+	unsigned int members = vol->number_of_members;
+
+	*row = page / (members - 1);
+	return ((*row % members) + 1 + (page % (members - 1))) % members;
+}
+
+/**
+* i2c_eeprom_parity_written - Function to check if a write of a parity volume changes a member page
+* @vol: Volume
+* @member: Member
+* @row: Stripe row
+* @first: First logical page written
+* @count: Number of pages written
+*
+* Returns 1 if the page is the parity of the row or one of the pages written, or else 0.
+*/
+static int i2c_eeprom_parity_written(struct i2c_eeprom_volume *vol, unsigned int member, unsigned int row,
+	unsigned int first, unsigned int count)
+{
+	unsigned int members = vol->number_of_members;
+	unsigned int slot = (member + members - (row % members)) % members;
+	unsigned int page = (row * (members - 1)) + slot - 1;
+
+	return slot == 0 || (page >= first && page < first + count);
+}
+
+/**
+* i2c_eeprom_parity_read_rows - Function to read pages of a parity volume within one pass
+* @vol: Volume
+* @first: First logical page
+* @count: Number of pages, not past the last page
+* @dest: Buffer for the pages
+*
+* Returns 0, or negative errno.
+* 
+* Description: Every member reads the run of rows it has requested pages in. If
+* 				one member fails, the rows of its run are read from all the others
+* 				and its pages are rebuilt as their XOR. A second failure fails
+* 				the read.
+*/
+static int i2c_eeprom_parity_read_rows(struct i2c_eeprom_volume *vol, unsigned int first, unsigned int count, char *dest)
+{
+	unsigned int members = vol->number_of_members;
+	unsigned int pageSize = vol->geometry.page_size;
+	unsigned int firstRow = first / (members - 1);
+	unsigned int rows = ((first + count - 1) / (members - 1)) - firstRow + 1;
+	unsigned int slotBytes = ALIGN(rows * pageSize, XOR_BULK_BYTES);
+	unsigned int low[MAX_EEPROM_DEVICES], high[MAX_EEPROM_DEVICES];
+	struct i2c_eeprom_volume_part parts[VOLUME_MAX_PARTS];
+	int result[VOLUME_MAX_PARTS];
+	void *srcs[MAX_EEPROM_DEVICES];
+	unsigned int numberOfParts = 0, member, row, failed, p, i;
+	char *memberBuffer;
+	int retValue;
+
+	memberBuffer = kzalloc(members * slotBytes, GFP_KERNEL);
+	if(memberBuffer == NULL)
+	{
+		return -ENOMEM;
+	}
+	for(member = 0; member < members; member++)
+	{
+		low[member]  = rows;
+		high[member] = 0;
+	}
+	for(i = 0; i < count; i++)
+	{
+		member = i2c_eeprom_parity_map(vol, first + i, &row);
+		low[member]  = min_t(unsigned int, low[member], row - firstRow);
+		high[member] = max_t(unsigned int, high[member], row - firstRow);
+	}
+	for(member = 0; member < members; member++)
+	{
+		if(low[member] > high[member])
+		{
+			continue;
+		}
+		parts[numberOfParts].member = member;
+		parts[numberOfParts].start  = firstRow + low[member];
+		parts[numberOfParts].count  = high[member] - low[member] + 1;
+		parts[numberOfParts].buf    = &memberBuffer[(member * slotBytes) + (low[member] * pageSize)];
+		numberOfParts++;
+	}
+	retValue = i2c_eeprom_volume_read_parts(vol, parts, numberOfParts, result);
+	failed = members;
+	for(p = 0; p < numberOfParts && retValue == 0; p++)
+	{
+		if(result[p] >= 0)
+		{
+			continue;
+		}
+		if(failed != members)
+		{
+			retValue = result[p];
+			break;
+		}
+		failed = parts[p].member;
+	}
+	if(retValue == 0 && failed != members)
+	{
+		printk("Volume read of EEPROM %d failed, rebuilding its pages from parity\n", failed);
+		numberOfParts = 0;
+		for(member = 0; member < members; member++)
+		{
+			if(member == failed)
+			{
+				continue;
+			}
+			parts[numberOfParts].member = member;
+			parts[numberOfParts].start  = firstRow + low[failed];
+			parts[numberOfParts].count  = high[failed] - low[failed] + 1;
+			parts[numberOfParts].buf    = &memberBuffer[(member * slotBytes) + (low[failed] * pageSize)];
+			srcs[numberOfParts] = &memberBuffer[member * slotBytes];
+			numberOfParts++;
+		}
+		retValue = i2c_eeprom_volume_read_parts(vol, parts, numberOfParts, result);
+		for(p = 0; p < numberOfParts && retValue == 0; p++)
+		{
+			if(result[p] < 0)
+			{
+				retValue = result[p];
+			}
+		}
+		if(retValue == 0)
+		{
+			memset(&memberBuffer[failed * slotBytes], 0, slotBytes);
+			i2c_eeprom_xor(&memberBuffer[failed * slotBytes], srcs, numberOfParts, slotBytes);
+		}
+	}
+	for(i = 0; i < count && retValue == 0; i++)
+	{
+		member = i2c_eeprom_parity_map(vol, first + i, &row);
+		memcpy(&dest[i * pageSize], &memberBuffer[(member * slotBytes) + ((row - firstRow) * pageSize)], pageSize);
+	}
+	kfree(memberBuffer);
+	return retValue;
+}
+
+/**
+* i2c_eeprom_parity_write_rows - Function to write pages of a parity volume within one pass
+* @vol: Volume
+* @first: First logical page
+* @count: Number of pages, not past the last page
+* @buf: User buffer with the pages
+*
+* Returns 0, or negative errno.
+* 
+* Description: The rows are laid out by slot, slot 0 is the parity and slot d + 1
+* 				data page d, so the parity of all rows is one XOR of the data slots.
+* 				Only the first and the last row can be partly written, just their
+* 				missing data pages are read. Full rows are written without reading.
+* 				Each member then gets one queued write of its run of rows.
+*/
+static int i2c_eeprom_parity_write_rows(struct i2c_eeprom_volume *vol, unsigned int first, unsigned int count, const char __user *buf)
+{
+	unsigned int members = vol->number_of_members;
+	unsigned int pageSize = vol->geometry.page_size;
+	unsigned int frameSize = vol->members[0]->frame_size;
+	unsigned int firstRow = first / (members - 1);
+	unsigned int rows = ((first + count - 1) / (members - 1)) - firstRow + 1;
+	unsigned int slotBytes = ALIGN(rows * pageSize, XOR_BULK_BYTES);
+	struct i2c_eeprom_volume_part parts[VOLUME_MAX_PARTS];
+	int result[VOLUME_MAX_PARTS];
+	void *srcs[MAX_EEPROM_DEVICES];
+	struct i2c_eeprom_volume_io *io;
+	unsigned int numberOfParts = 0, member, row, pageRow, slot, page, low, high, p, i;
+	char *slotBuffer;
+	int retValue = 0;
+
+	slotBuffer = kzalloc(members * slotBytes, GFP_KERNEL);
+	if(slotBuffer == NULL)
+	{
+		return -ENOMEM;
+	}
+	for(i = 0; i < count && retValue == 0; i++)
+	{
+		row = (first + i) / (members - 1);
+		slot = ((first + i) % (members - 1)) + 1;
+		if(copy_from_user(&slotBuffer[(slot * slotBytes) + ((row - firstRow) * pageSize)], &buf[i * pageSize], pageSize))
+		{
+			retValue = -EFAULT;
+		}
+	}
+	//Old data of the pages not written in the first and last row
+	for(slot = 1; slot < members && retValue == 0; slot++)
+	{
+		for(row = firstRow; row < firstRow + rows; row++)
+		{
+			page = (row * (members - 1)) + slot - 1;
+			if(page >= first && page < first + count)
+			{
+				continue;
+			}
+			parts[numberOfParts].member = i2c_eeprom_parity_map(vol, page, &pageRow);
+			parts[numberOfParts].start  = row;
+			parts[numberOfParts].count  = 1;
+			parts[numberOfParts].buf    = &slotBuffer[(slot * slotBytes) + ((row - firstRow) * pageSize)];
+			numberOfParts++;
+		}
+	}
+	if(numberOfParts != 0)
+	{
+		retValue = i2c_eeprom_volume_read_parts(vol, parts, numberOfParts, result);
+		for(p = 0; p < numberOfParts && retValue == 0; p++)
+		{
+			if(result[p] < 0)
+			{
+				retValue = result[p];
+			}
+		}
+	}
+	if(retValue < 0)
+	{
+		kfree(slotBuffer);
+		return retValue;
+	}
+	for(slot = 1; slot < members; slot++)
+	{
+		srcs[slot - 1] = &slotBuffer[slot * slotBytes];
+	}
+	i2c_eeprom_xor(slotBuffer, srcs, members - 1, slotBytes);
+	//Nobody waits for the writes, the request is detached and freed by the last member work
+	io = kzalloc(sizeof(struct i2c_eeprom_volume_io), GFP_KERNEL);
+	if(io == NULL)
+	{
+		kfree(slotBuffer);
+		return -ENOMEM;
+	}
+	atomic_set(&io->pending, 1);
+	io->detached = 1;
+	numberOfParts = 0;
+	for(member = 0; member < members; member++)
+	{
+		//A member writes every row but the first or last one if it keeps a page not written there
+		low  = firstRow;
+		high = firstRow + rows;
+		if(!i2c_eeprom_parity_written(vol, member, low, first, count))
+		{
+			low++;
+		}
+		if(high > low && !i2c_eeprom_parity_written(vol, member, high - 1, first, count))
+		{
+			high--;
+		}
+		if(low >= high)
+		{
+			continue;
+		}
+		parts[numberOfParts].member = member;
+		parts[numberOfParts].start  = low;
+		parts[numberOfParts].count  = high - low;
+		parts[numberOfParts].buf    = kmalloc(parts[numberOfParts].count * frameSize, GFP_KERNEL);
+		if(parts[numberOfParts].buf == NULL)
+		{
+			retValue = -ENOMEM;
+			break;
+		}
+		for(row = low; row < high; row++)
+		{
+			slot = (member + members - (row % members)) % members;
+			memcpy(&parts[numberOfParts].buf[((row - low) * frameSize) + (frameSize - pageSize)],
+				&slotBuffer[(slot * slotBytes) + ((row - firstRow) * pageSize)], pageSize);
+		}
+		if(i2c_eeprom_volume_submit(vol, io, numberOfParts, 'W', &parts[numberOfParts]) < 0)
+		{
+			kfree(parts[numberOfParts].buf);
+			retValue = -ENOMEM;
+			break;
+		}
+		numberOfParts++;
+	}
+	i2c_eeprom_volume_io_put(io);
+	kfree(slotBuffer);
+	return retValue;
+}
+
+/**
+* i2c_eeprom_parity_read - Function to read pages of a parity volume
+* @vol: Volume
+* @first: First logical page
+* @count: Number of pages
+* @dest: Buffer for the pages
+*
+* Returns 0, or negative errno.
+*/
+static int i2c_eeprom_parity_read(struct i2c_eeprom_volume *vol, unsigned int first, size_t count, char *dest)
+{
+	unsigned int pages = vol->geometry.number_of_pages;
+	unsigned int index = 0, length;
+	int retValue = 0;
+
+	//A request running past the last page goes on at page 0
+	while(index < count && retValue == 0)
+	{
+		length = min_t(unsigned int, count - index, pages - first);
+		retValue = i2c_eeprom_parity_read_rows(vol, first, length, &dest[index * vol->geometry.page_size]);
+		index += length;
+		first = 0;
+	}
+	return retValue;
+}
+
+/**
+* i2c_eeprom_parity_write - Function to write pages of a parity volume
+* @vol: Volume
+* @first: First logical page
+* @count: Number of pages
+* @buf: User buffer with the pages
+*
+* Returns 0, or negative errno.
+*/
+static int i2c_eeprom_parity_write(struct i2c_eeprom_volume *vol, unsigned int first, size_t count, const char __user *buf)
+{
+	unsigned int pages = vol->geometry.number_of_pages;
+	unsigned int index = 0, length;
+	int retValue = 0;
+
+	while(index < count && retValue == 0)
+	{
+		length = min_t(unsigned int, count - index, pages - first);
+		retValue = i2c_eeprom_parity_write_rows(vol, first, length, &buf[index * vol->geometry.page_size]);
+		index += length;
+		first = 0;
+	}
+	return retValue;
+}
+
+/**
+* i2c_eeprom_volume_open - Function called when the volume is opened for use.
+* @inode: Inode
+* @file: File Pointer
+*
+* Returns 0, or -ENODEV until every member has probed with the same page size.
+*/
+static int i2c_eeprom_volume_open(struct inode *inode, struct file *file)
+{
+	struct i2c_eeprom_volume *vol = container_of(inode->i_cdev, struct i2c_eeprom_volume, cdev);
+
+	if(!vol->ready)
+	{
+		return -ENODEV;
+	}
+	file->private_data = vol;
+	vol->current_pointer = 0;
+	return 0;
+}
+
+/**
+* i2c_eeprom_volume_read - Function to read pages of the volume
+* @file: File Pointer
+* @buf: Data Buffer
+* @count: Count of number of pages.
+* @offset: offset position pointer
+*
+* Returns 0, or negative errno.
+* 
+* Description: The parts are queued on their members all at the same time.
+* 				Unlike the EEPROM nodes the call returns once the data is in.
+* 				A mirror part that fails is read again from a mirror that has
+* 				not failed it yet, the read fails only when all mirrors did.
+*/
+static ssize_t i2c_eeprom_volume_read(struct file *file, char __user *buf, size_t count, loff_t *offset)
+{
+	struct i2c_eeprom_volume *vol = file->private_data;
+	unsigned int pageSize = vol->geometry.page_size;
+	struct i2c_eeprom_volume_part parts[VOLUME_MAX_PARTS];
+	struct i2c_eeprom_volume_io io;
+	unsigned int numberOfParts, first, pending, p, j;
+	char *readBuffer;
+	int retValue = 0;
+
+	if(count < 1 || count > vol->geometry.number_of_pages)
+	{
+		printk("Invalid Input for Page Number\n");
+		return -EINVAL;
+	}
+	readBuffer = kmalloc(count * pageSize, GFP_KERNEL);
+	if(readBuffer == NULL)
+	{
+		return -ENOMEM;
+	}
+	mutex_lock(&vol->lock);
+	first = vol->current_pointer / pageSize;
+	vol->current_pointer = ((first + count) % vol->geometry.number_of_pages) * pageSize;
+	if(vol->mode == VOLUME_PARITY)
+	{
+		retValue = i2c_eeprom_parity_read(vol, first, count, readBuffer);
+		numberOfParts = 0;
+	}
+	else
+	{
+		numberOfParts = i2c_eeprom_volume_plan(vol, first, count, 'R', parts);
+	}
+	pending = 0;
+	for(p = 0; p < numberOfParts; p++)
+	{
+		//Parts of consecutive pages are read in place
+		if(parts[p].stride == 1)
+		{
+			parts[p].buf = &readBuffer[parts[p].index * pageSize];
+		}
+		else
+		{
+			parts[p].buf = kmalloc(parts[p].count * pageSize, GFP_KERNEL);
+			if(parts[p].buf == NULL)
+			{
+				retValue = -ENOMEM;
+			}
+		}
+		pending |= 1 << p;
+	}
+	while(retValue == 0 && pending != 0)
+	{
+		atomic_set(&io.pending, 1);
+		io.detached = 0;
+		init_completion(&io.done);
+		for(p = 0; p < numberOfParts && retValue == 0; p++)
+		{
+			if(pending & (1 << p))
+			{
+				retValue = i2c_eeprom_volume_submit(vol, &io, p, 'R', &parts[p]);
+			}
+		}
+		i2c_eeprom_volume_io_put(&io);
+		wait_for_completion(&io.done);
+		for(p = 0; p < numberOfParts && retValue == 0; p++)
+		{
+			if(!(pending & (1 << p)))
+			{
+				continue;
+			}
+			if(io.result[p] >= 0)
+			{
+				pending &= ~(1 << p);
+				continue;
+			}
+			parts[p].tried |= 1 << parts[p].member;
+			if(vol->mode != VOLUME_MIRROR || parts[p].tried == (1 << vol->number_of_members) - 1)
+			{
+				retValue = io.result[p];
+				break;
+			}
+			printk("Volume read of EEPROM %d failed, reading its mirror\n", parts[p].member);
+			while(parts[p].tried & (1 << parts[p].member))
+			{
+				parts[p].member = (parts[p].member + 1) % vol->number_of_members;
+			}
+		}
+	}
+	mutex_unlock(&vol->lock);
+	for(p = 0; p < numberOfParts; p++)
+	{
+		if(parts[p].stride == 1)
+		{
+			continue;
+		}
+		//Put the pages of the members back in volume order
+		for(j = 0; j < parts[p].count && retValue == 0; j++)
+		{
+			memcpy(&readBuffer[(parts[p].index + j * parts[p].stride) * pageSize], &parts[p].buf[j * pageSize], pageSize);
+		}
+		kfree(parts[p].buf);
+	}
+	if(retValue == 0 && copy_to_user(buf, readBuffer, count * pageSize))
+	{
+		retValue = -EFAULT;
+	}
+	kfree(readBuffer);
+	return retValue;
+}
+
+/**
+* i2c_eeprom_volume_write - Function to write pages of the volume
+* @file: File Pointer
+* @buf: Data Buffer
+* @count: Count of number of pages.
+* @offset: offset position pointer
+*
+* Returns 0, or negative errno.
+* 
+* Description: The pages are copied from user space straight into the frames of
+* 				the member parts. The parts are on different chips, so their
+* 				write cycles overlap. The call returns once the writes are queued,
+* 				FLASHFLUSH waits for them.
+*/
+static ssize_t i2c_eeprom_volume_write(struct file *file, const char __user *buf, size_t count, loff_t *offset)
+{
+	struct i2c_eeprom_volume *vol = file->private_data;
+	unsigned int pageSize = vol->geometry.page_size;
+	unsigned int frameSize = vol->members[0]->frame_size;
+	struct i2c_eeprom_volume_part parts[VOLUME_MAX_PARTS];
+	struct i2c_eeprom_volume_io *io;
+	unsigned int numberOfParts, first, p, j;
+	int retValue = 0;
+
+	if(count < 1 || count > vol->geometry.number_of_pages)
+	{
+		printk("Invalid Input for Page Number\n");
+		return -EINVAL;
+	}
+	if(vol->mode == VOLUME_PARITY)
+	{
+		mutex_lock(&vol->lock);
+		first = vol->current_pointer / pageSize;
+		retValue = i2c_eeprom_parity_write(vol, first, count, buf);
+		if(retValue == 0)
+		{
+			vol->current_pointer = ((first + count) % vol->geometry.number_of_pages) * pageSize;
+		}
+		mutex_unlock(&vol->lock);
+		return retValue;
+	}
+	//Nobody waits for the request, it is freed by the last member work
+	io = kzalloc(sizeof(struct i2c_eeprom_volume_io), GFP_KERNEL);
+	if(io == NULL)
+	{
+		return -ENOMEM;
+	}
+	mutex_lock(&vol->lock);
+	first = vol->current_pointer / pageSize;
+	numberOfParts = i2c_eeprom_volume_plan(vol, first, count, 'W', parts);
+	for(p = 0; p < numberOfParts && retValue == 0; p++)
+	{
+		parts[p].buf = kmalloc(parts[p].count * frameSize, GFP_KERNEL);
+		if(parts[p].buf == NULL)
+		{
+			retValue = -ENOMEM;
+			break;
+		}
+		for(j = 0; j < parts[p].count; j++)
+		{
+			if(copy_from_user(&parts[p].buf[(j * frameSize) + (frameSize - pageSize)],
+				&buf[(parts[p].index + j * parts[p].stride) * pageSize], pageSize))
+			{
+				retValue = -EFAULT;
+				break;
+			}
+		}
+	}
+	if(retValue < 0)
+	{
+		for(p = 0; p < numberOfParts; p++)
+		{
+			kfree(parts[p].buf);
+		}
+		kfree(io);
+		mutex_unlock(&vol->lock);
+		return retValue;
+	}
+	vol->current_pointer = ((first + count) % vol->geometry.number_of_pages) * pageSize;
+	atomic_set(&io->pending, 1);
+	io->detached = 1;
+	for(p = 0; p < numberOfParts; p++)
+	{
+		if(i2c_eeprom_volume_submit(vol, io, p, 'W', &parts[p]) < 0)
+		{
+			kfree(parts[p].buf);
+			retValue = -ENOMEM;
+		}
+	}
+	mutex_unlock(&vol->lock);
+	i2c_eeprom_volume_io_put(io);
+	return retValue;
+}
+
+/**
+* i2c_eeprom_volume_ioctl - Function to perform IOCTL operations on the volume
+* @file: File Pointer
+* @arg: Arguments to the functions
+* @cmd: Command to perform specific functions
+*
+* Returns as the EEPROM nodes, FLASHGETS, FLASHGETP, FLASHSETP, FLASHGETG and
+* FLASHFLUSH are supported.
+*/
+static long i2c_eeprom_volume_ioctl(struct file *file, unsigned int arg, unsigned long cmd)
+{
+	struct i2c_eeprom_volume *vol = file->private_data;
+	unsigned int pageSize = vol->geometry.page_size;
+	unsigned int member;
+	long retValue = 0;
+
+	switch(cmd)
+	{
+		case FLASHGETS:
+			{
+				for(member = 0; member < vol->number_of_members; member++)
 				{
-					i2c_EEPROM_device_list->current_pointer = arg * EEPROM_PAGE_SIZE;
-					retValue = (i2c_EEPROM_device_list->current_pointer)/(EEPROM_PAGE_SIZE);
+					retValue |= vol->members[member]->BUSY_FLAG;
 				}
 				break;
 			}
-		case FLASHERASE:
+		case FLASHGETP:
+			{
+				retValue = vol->current_pointer / pageSize;
+				break;
+			}
+		case FLASHSETP:
 			{
-				if(i2c_EEPROM_device_list->BUSY_FLAG == 0)
+				if(arg >= vol->geometry.number_of_pages)
 				{
-					tempPointer = 0;
-					i2c_EEPROM_device_list->current_pointer = 0;
-					for(i=0;i<(EEPROM_PAGE_SIZE);i++)
-					{
-						tempIOCTLBuffer[i] = 0xFF;
-					}
-					for(i=0;i<NUMBER_OF_PAGES;i++)
-					{
-						//Set Address High Byte
-						sendBuffer[0]= ((tempPointer >> 8) & 0xFF);
-						//Set Address Low Byte
-						sendBuffer[1]= (tempPointer & 0xFF);
-						memcpy(&sendBuffer[2], &tempIOCTLBuffer[0], EEPROM_PAGE_SIZE);
-						gpio_set_value_cansleep(GPIO_LED_PIN, 1);
-						retValue = i2c_master_send(&(i2c_EEPROM_device_list->client), sendBuffer,sizeof(sendBuffer));
-						gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-						if(retValue<0)
-						{
-							printk("Error:i2c_master_send");
-							gpio_set_value_cansleep(GPIO_LED_PIN, 0);
-							return -1;
-						}
-						i2c_EEPROM_device_list->current_pointer = (i2c_EEPROM_device_list->current_pointer) + EEPROM_PAGE_SIZE;
-						tempPointer = i2c_EEPROM_device_list->current_pointer;
-						printk("Page %i Erase Successfull\n",i);
-					}
-					i2c_EEPROM_device_list->current_pointer = 0;
-					retValue = i2c_EEPROM_device_list->current_pointer;
-					break;
+					retValue = -1;
 				}
 				else
 				{
-					printk("Resource (EEPROM) is Busy\n");
-					retValue = -1;
+					mutex_lock(&vol->lock);
+					vol->current_pointer = arg * pageSize;
+					mutex_unlock(&vol->lock);
+					retValue = arg;
+				}
+				break;
+			}
+		case FLASHGETG:
+			{
+				if(copy_to_user((void __user *)(unsigned long)arg, &(vol->geometry), sizeof(struct i2c_EEPROM_geometry)))
+				{
+					retValue = -EFAULT;
+				}
+				break;
+			}
+		case FLASHFLUSH:
+			{
+				for(member = 0; member < vol->number_of_members && retValue == 0; member++)
+				{
+					retValue = i2c_eeprom_flush(vol->members[member]);
 				}
+				break;
 			}
 		default:
+			retValue = -ENOTTY;
 			break;
 	}
-	//printk("i2c_flash.c: eep_ioctl: End\n");
 	return retValue;
 }
+
 /**
- * Driver entry points 
- */
-static struct file_operations i2c_eeprom_fops = {
-  .owner   = THIS_MODULE,
-  .read    = i2c_eeprom_read_from_queue,
-  .write   = i2c_eeprom_write_into_queue,
-  .open    = i2c_eeprom_open,
-  .release = i2c_eeprom_release,
-  .unlocked_ioctl   = i2c_eeprom_ioctl,
-};
+* i2c_eeprom_log_page - Function to find the page of a frame of the log
+* @log: Log
+* @index: Frame
+*
+* Returns the page, header first, behind the address slot of the frame.
+*/
+static inline char *i2c_eeprom_log_page(struct i2c_eeprom_log *log, unsigned int index)
+{
+	struct i2c_EEPROM_dev *dev = log->dev;
+
+	return &(log->frames[(index * dev->frame_size) + (dev->frame_size - dev->geometry.page_size)]);
+}
 
 /**
- * Device Initialization
- */
-static int __init i2c_eeprom_init(void)
+* i2c_eeprom_log_check - Function to work out the check of a log page
+* @page: Page, header first
+* @used: Data bytes of the page
+*
+* Returns the check.
+*/
+static u16 i2c_eeprom_log_check(const char *page, unsigned int used)
+{
+	u32 crc;
+
+	crc = crc32_le(~0, page, offsetof(struct i2c_eeprom_log_header, check));
+	crc = crc32_le(crc, &page[sizeof(struct i2c_eeprom_log_header)], used);
+	return crc & 0xFFFF;
+}
+
+/**
+* i2c_eeprom_log_stamp - Function to fill in the header of a log page
+* @page: Page, header first
+* @sequence: Sequence of the page
+* @used: Data bytes of the page
+*
+* Returns void.
+*/
+static void i2c_eeprom_log_stamp(char *page, u32 sequence, unsigned int used)
+{
+	struct i2c_eeprom_log_header header;
+
+	header.sequence = cpu_to_le32(sequence);
+	header.used     = cpu_to_le16(used);
+	header.check    = 0;
+	memcpy(page, &header, sizeof(struct i2c_eeprom_log_header));
+	header.check    = cpu_to_le16(i2c_eeprom_log_check(page, used));
+	memcpy(page, &header, sizeof(struct i2c_eeprom_log_header));
+}
+
+/**
+* i2c_eeprom_log_parse - Function to read the header of a log page
+* @log: Log
+* @page: Page, header first
+* @sequence: Set to the sequence of the page
+* @used: Set to the data bytes of the page
+*
+* Returns 0, or -1 if the page is blank or does not pass its check.
+*/
+static int i2c_eeprom_log_parse(struct i2c_eeprom_log *log, const char *page, u32 *sequence, unsigned int *used)
 {
-	int err;
-	struct i2c_adapter *adap;
+	struct i2c_eeprom_log_header header;
 
-	/* Allocate the per-device data structure, i2c_EEPROM_dev */
-	i2c_EEPROM_device_list = kmalloc(sizeof(struct i2c_EEPROM_dev), GFP_KERNEL);
-
-	memset(i2c_EEPROM_device_list, 0, sizeof(struct i2c_EEPROM_dev));
-  
-	/* Register and create the /dev interfaces to access the EEPROM banks.  */
-	if(alloc_chrdev_region(&dev_number, I2C_MINOR_NUMBER, 1, DRIVER_NAME) < 0)
+	memcpy(&header, page, sizeof(struct i2c_eeprom_log_header));
+	*sequence = le32_to_cpu(header.sequence);
+	*used     = le16_to_cpu(header.used);
+	if(*sequence == 0 || *sequence == 0xFFFFFFFF || *used > log->payload ||
+		le16_to_cpu(header.check) != i2c_eeprom_log_check(page, *used))
 	{
-		printk("Can't register device\n");
 		return -1;
 	}
+	return 0;
+}
 
-	eep_class = class_create(THIS_MODULE, DEVICE_NAME);
-	
-	/* Setting i2c driver name */
-	sprintf(i2c_EEPROM_device_list->name, DEVICE_NAME);
-	
-	/* Connect the file operations with cdev */
-	cdev_init(&i2c_EEPROM_device_list->cdev, &i2c_eeprom_fops);
-	
-	/* Connect the major/minor number to the cdev */
-	if (cdev_add(&i2c_EEPROM_device_list->cdev, MKDEV(MAJOR(dev_number), 0), 1))
+/**
+* i2c_eeprom_log_read_page - Function to read one page of the ring through the queues
+* @log: Log
+* @index: Ring page
+* @page: Buffer of one page
+* @sequence: Set to the sequence of the page
+* @used: Set to the data bytes of the page
+*
+* Returns 0, -1 if the page holds no log page, or negative errno.
+*/
+static int i2c_eeprom_log_read_page(struct i2c_eeprom_log *log, unsigned int index, char *page, u32 *sequence, unsigned int *used)
+{
+	struct i2c_EEPROM_dev *dev = log->dev;
+	int retValue;
+
+	retValue = i2c_eeprom_sync_work(dev, 'R', (log->first_page + index) * dev->geometry.page_size, page, 1);
+	if(retValue < 0)
 	{
-		printk("Bad kmalloc\n");
-		return 1;
+		return retValue;
 	}
+	return i2c_eeprom_log_parse(log, page, sequence, used);
+}
 
-	device_create(eep_class, NULL, MKDEV(MAJOR(dev_number), 0), NULL, DEVICE_NAME);
-	err = gpio_request_one(GPIO_MUX_PIN, GPIOF_OUT_INIT_LOW, "Mux");
-	if(err)
+/**
+* i2c_eeprom_log_recover - Function to find the head and the tail of the log on the chip
+* @dev: EEPROM device
+*
+* Returns void, the log stays unusable if it can not be set up.
+* 
+* Description: Called at probe. Pages are written in ring order with one more
+* 				sequence each, so from ring page 0 the sequences go up by one
+* 				until the head and then drop to the older lap, or to blank pages
+* 				on the first lap. A binary search over "page i holds sequence
+* 				s0 + i" finds the head in log2 of the ring pages reads. One more
+* 				read tells whether the ring has gone round, the tail is then the
+* 				page after the head, or else page 0. A page that fails its check
+* 				counts as blank, a page that can not be read leaves the log off.
+* 				A head page that is not full is taken into RAM and the next
+* 				appends go on filling it.
+*/
+static void i2c_eeprom_log_recover(struct i2c_EEPROM_dev *dev)
+{
+	struct i2c_eeprom_log *log = dev->log;
+	unsigned int pageSize = dev->geometry.page_size;
+	unsigned int low, high, middle, used, headUsed;
+	u32 first, sequence;
+	char *page;
+	int retValue;
+
+	if(log == NULL || log->ready)
 	{
-		//printk("MUX ERROR");
+		return;
 	}
-	gpio_set_value_cansleep(GPIO_MUX_PIN, 0);
-	/* Inform the I2C core about driver existence. */
-	err = i2c_add_driver(&eeprom_driver);
-	if(err)
+	if(pageSize < LOG_MIN_PAGE_SIZE || log_pages < LOG_MIN_PAGES || log_pages > dev->geometry.number_of_pages)
 	{
-		printk("Registering I2C driver failed, errno is %d\n", err);
-		return err;
+		printk("%s: no log of %u pages of %u bytes on %u pages\n", log->name, log_pages, pageSize, dev->geometry.number_of_pages);
+		return;
 	}
-	
-	i2c_eeprom_workqueue = create_singlethread_workqueue(WORK_QUEUE_NAME);
-	
-	adap = i2c_get_adapter(I2C_MINOR_NUMBER);
-	client_core = i2c_new_device(adap, i2c_eeprom_board_info);
+	if(dev->bus->thread == NULL)
+	{
+		printk("Dispatcher thread is not running\n");
+		return;
+	}
+	mutex_lock(&log->lock);
+	log->first_page      = dev->geometry.number_of_pages - log_pages;
+	log->number_of_pages = log_pages;
+	log->payload         = pageSize - sizeof(struct i2c_eeprom_log_header);
+	if(log_batch < 1 || log_batch > log_pages)
+	{
+		log_batch = min_t(unsigned int, LOG_BATCH_PAGES, log_pages);
+	}
+	log->frames = kzalloc(log_batch * dev->frame_size, GFP_KERNEL);
+	page = kmalloc(pageSize, GFP_KERNEL);
+	if(log->frames == NULL || page == NULL)
+	{
+		printk("No memory for the log of %s\n", dev->name);
+		kfree(log->frames);
+		kfree(page);
+		log->frames = NULL;
+		mutex_unlock(&log->lock);
+		return;
+	}
+	retValue = i2c_eeprom_log_read_page(log, 0, page, &first, &used);
+	if(retValue < -1)
+	{
+		goto fail;
+	}
+	if(retValue != 0)
+	{
+		//Nothing logged yet
+		log->batch_first     = 0;
+		log->head_sequence   = 1;
+		log->oldest_sequence = 1;
+		log->used            = 0;
+	}
+	else
+	{
+		low  = 0;
+		high = log->number_of_pages - 1;
+		while(low < high)
+		{
+			middle = (low + high + 1) / 2;
+			retValue = i2c_eeprom_log_read_page(log, middle, page, &sequence, &used);
+			if(retValue < -1)
+			{
+				goto fail;
+			}
+			if(retValue == 0 && sequence == first + middle)
+			{
+				low = middle;
+			}
+			else
+			{
+				high = middle - 1;
+			}
+		}
+		log->head_sequence   = first + low;
+		log->oldest_sequence = first;
+		log->batch_first     = low;
+		retValue = i2c_eeprom_log_read_page(log, low, i2c_eeprom_log_page(log, 0), &sequence, &headUsed);
+		if(retValue < -1)
+		{
+			goto fail;
+		}
+		if(retValue != 0)
+		{
+			headUsed = 0;
+			memset(i2c_eeprom_log_page(log, 0), 0, pageSize);
+		}
+		if(low + 1 < log->number_of_pages)
+		{
+			retValue = i2c_eeprom_log_read_page(log, low + 1, page, &sequence, &used);
+			if(retValue < -1)
+			{
+				goto fail;
+			}
+			if(retValue == 0 && sequence == log->head_sequence - log->number_of_pages + 1)
+			{
+				log->oldest_sequence = sequence;
+			}
+		}
+		log->used = headUsed;
+		if(headUsed == log->payload)
+		{
+			//The head is full, the next append opens the page after it
+			log->batch_first = (low + 1) % log->number_of_pages;
+			log->head_sequence++;
+			log->used = 0;
+			memset(i2c_eeprom_log_page(log, 0), 0, pageSize);
+			if((s32)(log->head_sequence - log->oldest_sequence) >= (s32)log->number_of_pages)
+			{
+				log->oldest_sequence = log->head_sequence - log->number_of_pages + 1;
+			}
+		}
+	}
+	log->batch_pages = 0;
+	log->queued_used = log->used;
+	log->ready       = 1;
+	printk("%s: %u pages from page %u, head at ring page %u sequence %u\n", log->name,
+		log->number_of_pages, log->first_page, log->batch_first, log->head_sequence);
+	mutex_unlock(&log->lock);
+	kfree(page);
+	return;
+fail:
+	//Appending on a guess could overwrite the log, it stays off instead
+	printk("Reading the log of %s failed, errno is %d\n", dev->name, retValue);
+	kfree(log->frames);
+	log->frames = NULL;
+	mutex_unlock(&log->lock);
+	kfree(page);
+}
 
-	printk("EEPROM Driver Initialized.\n");
-	return 0;
+/**
+* i2c_eeprom_log_queue - Function to queue the first frames of the log to the chip
+* @log: Log, lock held
+* @count: Frames, the open page last if count is batch_pages + 1
+*
+* Returns the ticket of the write, or negative errno.
+* 
+* Description: The frames are one run of ring pages, the caller never lets a
+* 				batch go past the last page of the ring. They go out as one
+* 				write, so a batch costs one work in the queues. Full pages were
+* 				stamped when they were closed, the open page is stamped here.
+*/
+static int i2c_eeprom_log_queue(struct i2c_eeprom_log *log, unsigned int count)
+{
+	struct i2c_EEPROM_dev *dev = log->dev;
+	I2C_WORK_QUEUE *send_work_queue;
+	char *writeBuffer;
+
+	if(count > log->batch_pages)
+	{
+		i2c_eeprom_log_stamp(i2c_eeprom_log_page(log, log->batch_pages), log->head_sequence, log->used);
+	}
+	writeBuffer = kmemdup(log->frames, count * dev->frame_size, GFP_KERNEL);
+	send_work_queue = (I2C_WORK_QUEUE *)kzalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
+	if(writeBuffer == NULL || send_work_queue == NULL)
+	{
+		printk("Failure in malloc during log write\n");
+		kfree(writeBuffer);
+		kfree(send_work_queue);
+		return -ENOMEM;
+	}
+	send_work_queue->read_or_write     = 'W';
+	send_work_queue->io                = NULL;
+	send_work_queue->start             = (log->first_page + log->batch_first) * dev->geometry.page_size;
+	send_work_queue->queue_Data.file   = NULL;
+	send_work_queue->queue_Data.buf    = writeBuffer;
+	send_work_queue->queue_Data.count  = count;
+	send_work_queue->queue_Data.offset = NULL;
+	//fsync waits on the ticket
+	send_work_queue->waited            = 1;
+	log->last_ticket = i2c_eeprom_queue_work(dev, send_work_queue);
+	log->pages_written += count;
+	return log->last_ticket;
 }
 
 /**
-* i2c_eeprom_exit - Function to perform IOCTL operations
-* @file: File Pointer
-* @arg: Arguments to the functions
-* @cmd: Command to perform specific functions
+* i2c_eeprom_log_advance - Function to close the open page and open the next one
+* @log: Log, lock held
 *
-* Returns pointer position, no of pages erased.
+* Returns 0, or negative errno if the batch could not be queued.
 * 
-* Description: This function is called to perform ioctl functions like 
-* set pointer positions, get pointer positions, erase eeprom and to check the 
-* status of the EEPROM.
+* Description: The closed page waits in RAM until log_batch pages are full or
+* 				the ring wraps, then the whole batch is queued. A batch that can
+* 				not be queued is lost, the log goes on behind it.
 */
-static void __exit i2c_eeprom_exit(void)
+static int i2c_eeprom_log_advance(struct i2c_eeprom_log *log)
 {
-	//printk("i2c_flash.c: i2c_dev_exit: Start\n");
-	device_destroy(eep_class, MKDEV(MAJOR(dev_number), 0));
-	cdev_del(&(i2c_EEPROM_device_list->cdev));
-	class_destroy(eep_class);
-	unregister_chrdev(MAJOR(dev_number), DRIVER_NAME);
-	i2c_unregister_device(client_core);
-	i2c_del_driver(&eeprom_driver);
-	if(i2c_eeprom_workqueue)
+	unsigned int next;
+	int retValue = 0;
+
+	//A page closed early keeps its length, the rest of it is never read
+	i2c_eeprom_log_stamp(i2c_eeprom_log_page(log, log->batch_pages), log->head_sequence, log->used);
+	log->batch_pages++;
+	log->head_sequence++;
+	log->used = 0;
+	log->queued_used = 0;
+	//The page opened overwrites the oldest one once the ring has gone round
+	if((s32)(log->head_sequence - log->oldest_sequence) >= (s32)log->number_of_pages)
 	{
-		destroy_workqueue(i2c_eeprom_workqueue);
+		log->oldest_sequence = log->head_sequence - log->number_of_pages + 1;
 	}
-	kfree(i2c_EEPROM_device_list);
-	//printk("i2c_flash.c: i2c_dev_exit: End\n");
+	next = (log->batch_first + log->batch_pages) % log->number_of_pages;
+	if(log->batch_pages == log_batch || next == 0)
+	{
+		retValue = i2c_eeprom_log_queue(log, log->batch_pages);
+		log->batch_first = next;
+		log->batch_pages = 0;
+	}
+	memset(i2c_eeprom_log_page(log, log->batch_pages), 0, log->dev->geometry.page_size);
+	return (retValue < 0) ? retValue : 0;
 }
 
 /**
-* i2c_eeprom_work_queue_fn - Function to perform IOCTL operations
-* @work: Work Data Structure
+* i2c_eeprom_log_sync - Function to queue every page of the log held in RAM
+* @log: Log, lock held
 *
-* Returns void
+* Returns 0, or negative errno.
 * 
-* Description: This function is called from workers thread. After receiving the
-* call from workers thread, it calls respective read or write functions based
-* on the type of work to be performed.
+* Description: The open page is queued with the data it holds so far and stays
+* 				open, it is written again once more data comes in.
 */
-static void i2c_eeprom_work_queue_fn( struct work_struct *work)
+static int i2c_eeprom_log_sync(struct i2c_eeprom_log *log)
 {
+	struct i2c_EEPROM_dev *dev = log->dev;
+	unsigned int count = log->batch_pages;
 	int retValue = 0;
-	I2C_WORK_QUEUE *rcvd_work = (I2C_WORK_QUEUE *)work;
-	//printk("i2c_flash.c : i2c_eeprom_work_queue_fn : Start\n");
-	if(rcvd_work->read_or_write == 'W')
+
+	if(!log->ready)
 	{
-		retValue = i2c_eeprom_write(rcvd_work->queue_Data.file, rcvd_work->queue_Data.buf, rcvd_work->queue_Data.count, rcvd_work->queue_Data.offset);
+		return 0;
 	}
-	else if(rcvd_work->read_or_write == 'R')
+	if(log->used > log->queued_used)
 	{
-		retValue = i2c_eeprom_read(rcvd_work->queue_Data.file, rcvd_work->queue_Data.buf, rcvd_work->queue_Data.count, rcvd_work->queue_Data.offset);
+		count++;
 	}
-	else
+	if(count == 0)
+	{
+		return 0;
+	}
+	retValue = i2c_eeprom_log_queue(log, count);
+	if(log->batch_pages != 0)
 	{
-		printk("Invalid work type\n");
+		memmove(log->frames, &(log->frames[log->batch_pages * dev->frame_size]), dev->frame_size);
 	}
-	//printk("i2c_flash.c : i2c_eeprom_work_queue_fn : End\n");
-	return;
+	log->batch_first = (log->batch_first + log->batch_pages) % log->number_of_pages;
+	log->batch_pages = 0;
+	log->queued_used = log->used;
+	return (retValue < 0) ? retValue : 0;
 }
 
 /**
-* i2c_eeprom_write_into_queue - Function to add job into the worker thread for write operation
+* i2c_eeprom_log_open - Function called when a log is opened for use.
+* @inode: Inode
+* @file: File Pointer
+*
+* Returns 0, or -ENOMEM.
 * 
-* @file: Work Data Structure
+* Description: Reads of the file start at the oldest data still in the ring.
+*/
+static int i2c_eeprom_log_open(struct inode *inode, struct file *file)
+{
+	struct i2c_eeprom_log *log = container_of(inode->i_cdev, struct i2c_eeprom_log, cdev);
+	struct i2c_eeprom_log_file *ctx;
+
+	ctx = kzalloc(sizeof(struct i2c_eeprom_log_file), GFP_KERNEL);
+	if(ctx == NULL)
+	{
+		return -ENOMEM;
+	}
+	ctx->log = log;
+	mutex_lock(&log->lock);
+	ctx->sequence = log->oldest_sequence;
+	mutex_unlock(&log->lock);
+	file->private_data = ctx;
+	return 0;
+}
+
+/**
+* i2c_eeprom_log_release - Function called during release of a log.
+* @inode: Inode
+* @file: File Pointer
+*
+* Returns 0.
+* 
+* Description: What the file appended and is still in RAM is queued to the chip.
+*/
+static int i2c_eeprom_log_release(struct inode *inode, struct file *file)
+{
+	struct i2c_eeprom_log_file *ctx = file->private_data;
+	struct i2c_eeprom_log *log = ctx->log;
+
+	mutex_lock(&log->lock);
+	i2c_eeprom_log_sync(log);
+	mutex_unlock(&log->lock);
+	kfree(ctx);
+	return 0;
+}
+
+/**
+* i2c_eeprom_log_write - Function to append to a log
+* @file: File Pointer
 * @buf: Data Buffer
-* @count: Count of number of pages.
-* @offset: offset position pointer
+* @count: Count of number of bytes.
+* @offset: Unused, a log is only appended to
 *
-* Returns ssize_t
+* Returns count, or negative errno.
 * 
-* Description: This function is the .write function entry point from the user space. After receiving
-* the request from the user, the job is assigned to workers thread and is immediately returned back
-* to user space. So this makes the function to appear as Non Blocking call.
+* Description: The bytes are packed into the open page in RAM, nothing goes to
+* 				the bus until log_batch pages are full. An append of at most
+* 				one page of data is never split over two pages, it opens a new
+* 				page if it does not fit the rest of the open one, so a reader
+* 				starting at the oldest page starts on a whole append. Longer
+* 				appends fill page after page.
 */
-static ssize_t i2c_eeprom_write_into_queue(struct file *file, const char __user *buf, size_t count, loff_t *offset)
+static ssize_t i2c_eeprom_log_write(struct file *file, const char __user *buf, size_t count, loff_t *offset)
 {
+	struct i2c_eeprom_log_file *ctx = file->private_data;
+	struct i2c_eeprom_log *log = ctx->log;
+	unsigned int length;
+	size_t done = 0;
 	int retValue = 0;
-	int resValue = 0;
-	I2C_WORK_QUEUE *send_work_queue;
-	//printk("i2c_flash.c : i2c_eeprom_write_into_queue : Start\n");
-	if(count < 1 || count > 512)
+
+	if(!log->ready)
+	{
+		return -ENODEV;
+	}
+	if(count == 0)
 	{
-		printk("Invalid Input for Page Number\n");
 		return 0;
 	}
-	if(i2c_eeprom_workqueue)
+	if(count > (log->number_of_pages - 1) * log->payload)
+	{
+		printk("Append larger than the log\n");
+		return -EINVAL;
+	}
+	mutex_lock(&log->lock);
+	if(count <= log->payload && count > log->payload - log->used)
+	{
+		retValue = i2c_eeprom_log_advance(log);
+	}
+	while(done < count)
 	{
-		if(i2c_EEPROM_device_list->BUSY_FLAG == 0)
+		length = min_t(size_t, log->payload - log->used, count - done);
+		if(copy_from_user(&(i2c_eeprom_log_page(log, log->batch_pages)[sizeof(struct i2c_eeprom_log_header) + log->used]),
+			&buf[done], length))
 		{
-			retValue = 0;
-			temp_write_buff = kmalloc((count*EEPROM_PAGE_SIZE), GFP_KERNEL);
-			if (temp_write_buff == NULL)
-			{
-				printk("Failure in malloc during write\n");
-				return -ENOMEM;
-			}
-			resValue = copy_from_user((void *)temp_write_buff, (void __user *)buf, (count*EEPROM_PAGE_SIZE));
-			send_work_queue = (I2C_WORK_QUEUE *)kmalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
-			if (send_work_queue == NULL)
-			{
-				printk("Failure in malloc during write_transfer\n");
-				return -ENOMEM;
-			}
-			/* Initialize the work into work queue function */
-			INIT_WORK( (struct work_struct *)send_work_queue, (void *)i2c_eeprom_work_queue_fn);
-			
-			send_work_queue->work_id = ++WORK_ID_COUNTER;
-			send_work_queue->read_or_write     = 'W';
-			send_work_queue->status_Flag	   = 'Q';
-			send_work_queue->queue_Data.file   = file;
-			send_work_queue->queue_Data.buf    = (char*)temp_write_buff;
-			send_work_queue->queue_Data.count  = count;
-			send_work_queue->queue_Data.offset = offset;
-			
-			retValue = queue_work(i2c_eeprom_workqueue, (struct work_struct *)send_work_queue );
-			if(retValue > 0)
-			{
-				printk("Write Work Successfully added in Work Queue\n");
-			}
-			retValue = 0;
+			retValue = -EFAULT;
+			break;
 		}
-		else
+		log->used += length;
+		done += length;
+		if(log->used == log->payload && i2c_eeprom_log_advance(log) < 0)
 		{
-			retValue = -EBUSY;
+			retValue = -ENOMEM;
 		}
 	}
-	else
-	{
-		printk("Work Queue is NULL\n");
-	}
-	//printk("i2c_flash.c : i2c_eeprom_write_into_queue : End\n");
-	return retValue;
+	log->appends++;
+	mutex_unlock(&log->lock);
+	return (retValue < 0) ? retValue : count;
 }
 
 /**
-* i2c_eeprom_read_from_queue - Function to add job into the worker thread for read operation 
-* 
-* @file: Work Data Structure
+* i2c_eeprom_log_read - Function to read a log from the oldest data on
+* @file: File Pointer
 * @buf: Data Buffer
-* @count: Count of number of pages.
-* @offset: offset position pointer
+* @count: Count of number of bytes.
+* @offset: Unused, every file keeps its place in the log
 *
-* Returns ssize_t
+* Returns the bytes read, 0 at the end of the log, or negative errno.
 * 
-* Description: This function is the .read function entry point from the user space. After receiving
-* the request from the user, the job is assigned to workers thread and is immediately returned back
-* to user space. So this makes the function to appear as Non Blocking call.
+* Description: Pages still in RAM are copied from there, the others are read
+* 				through the queues and so also from queued writes. The lock is
+* 				dropped for those reads, a page overwritten meanwhile no longer
+* 				holds the sequence looked for and is passed over, as are pages
+* 				that fail their check. A reader left behind by the ring goes on
+* 				at the oldest page.
 */
-static ssize_t i2c_eeprom_read_from_queue(struct file *file, char __user *buf, size_t count, loff_t *offset)
+static ssize_t i2c_eeprom_log_read(struct file *file, char __user *buf, size_t count, loff_t *offset)
 {
+	struct i2c_eeprom_log_file *ctx = file->private_data;
+	struct i2c_eeprom_log *log = ctx->log;
+	unsigned int distance, index, used, length;
+	const char *data;
+	char *page;
+	u32 sequence;
+	size_t done = 0;
 	int retValue = 0;
-	I2C_WORK_QUEUE *send_work_queue;
-	//printk("i2c_flash.c : i2c_eeprom_read_from_queue : Start\n");
-	if(count < 1 || count > 512  )
+
+	if(!log->ready)
 	{
-		printk("Invalid Input for Page Number\n");
-		return 0;
+		return -ENODEV;
 	}
-	if(i2c_eeprom_workqueue)
+	page = kmalloc(log->dev->geometry.page_size, GFP_KERNEL);
+	if(page == NULL)
 	{
-		temp_read_buff = kzalloc(count*EEPROM_PAGE_SIZE, GFP_KERNEL);
-		if(temp_read_buff == NULL)
-		{
-			printk("Failure in malloc during read\n");
-			return -ENOMEM;
-		}
-
-		/* Allocate memory */
-		send_work_queue = (I2C_WORK_QUEUE *)kmalloc(sizeof(I2C_WORK_QUEUE), GFP_KERNEL);
-		if(send_work_queue == NULL)
+		return -ENOMEM;
+	}
+	mutex_lock(&log->lock);
+	while(done < count)
+	{
+		if((s32)(ctx->sequence - log->oldest_sequence) < 0)
 		{
-			printk("Failure in malloc during read_transfer\n");
-			return -ENOMEM;
+			ctx->sequence = log->oldest_sequence;
+			ctx->offset = 0;
 		}
-		/* Initialize the work into work queue function */
-		INIT_WORK((struct work_struct *)send_work_queue, (void *)i2c_eeprom_work_queue_fn);
-		
-		send_work_queue->work_id 		   = ++WORK_ID_COUNTER;
-		send_work_queue->status_Flag	   = 'Q';
-		send_work_queue->read_or_write     = 'R';
-		send_work_queue->queue_Data.file   = file;
-		send_work_queue->queue_Data.buf    = (char *)temp_read_buff;
-		send_work_queue->queue_Data.count  = count;
-		send_work_queue->queue_Data.offset = offset;
-		
-		if(ready_to_read_flag == 0)
+		distance = log->head_sequence - ctx->sequence;
+		if(distance <= log->batch_pages)
 		{
-			if(i2c_EEPROM_device_list->BUSY_FLAG == 0)
-			{
-				retValue = queue_work(i2c_eeprom_workqueue, (struct work_struct *)send_work_queue);
-				if(retValue > 0)
-				{
-					printk("Successfully queued readqueue\n");
-				}
-				ERROR = -EAGAIN;
-				retValue = -1;
-			}
-			else
+			data = i2c_eeprom_log_page(log, log->batch_pages - distance);
+			used = log->used;
+			if(distance != 0)
 			{
-				ERROR = -EBUSY;
-				retValue = -1;
+				i2c_eeprom_log_parse(log, data, &sequence, &used);
 			}
-			return retValue;
 		}
 		else
 		{
-			retValue = copy_to_user((void *)buf, tempBuffer, (count*EEPROM_PAGE_SIZE));
-			ready_to_read_flag = 0;
-			if(temp_read_buff != NULL)
+			index = (log->batch_first + log->batch_pages + log->number_of_pages - distance) % log->number_of_pages;
+			mutex_unlock(&log->lock);
+			retValue = i2c_eeprom_log_read_page(log, index, page, &sequence, &used);
+			mutex_lock(&log->lock);
+			if(retValue < -1)
 			{
-				kfree(temp_read_buff);
-				temp_read_buff = NULL;
+				break;
 			}
-			if(tempBuffer != NULL)
+			if(retValue != 0 || sequence != ctx->sequence)
 			{
-				kfree(tempBuffer);
-				tempBuffer = NULL;
+				used = 0;
 			}
 			retValue = 0;
-			return retValue;
+			data = page;
+		}
+		if(ctx->offset >= used)
+		{
+			if(ctx->sequence == log->head_sequence)
+			{
+				break;
+			}
+			ctx->sequence++;
+			ctx->offset = 0;
+			continue;
+		}
+		length = min_t(size_t, used - ctx->offset, count - done);
+		if(copy_to_user(&buf[done], &data[sizeof(struct i2c_eeprom_log_header) + ctx->offset], length))
+		{
+			retValue = -EFAULT;
+			break;
 		}
+		ctx->offset += length;
+		done += length;
 	}
-	else
+	mutex_unlock(&log->lock);
+	kfree(page);
+	return (retValue < 0 && done == 0) ? retValue : done;
+}
+
+/**
+* i2c_eeprom_log_fsync - Function called to sync a log
+* @file: File Pointer
+* @start: Start of the range, the whole log is synced
+* @end: End of the range
+* @datasync: Only data to sync
+*
+* Returns 0 once every appended byte is on the chip, or negative errno.
+*/
+static int i2c_eeprom_log_fsync(struct file *file, loff_t start, loff_t end, int datasync)
+{
+	struct i2c_eeprom_log_file *ctx = file->private_data;
+	struct i2c_eeprom_log *log = ctx->log;
+	unsigned int ticket;
+	int retValue;
+
+	mutex_lock(&log->lock);
+	retValue = i2c_eeprom_log_sync(log);
+	ticket = log->last_ticket;
+	mutex_unlock(&log->lock);
+	if(retValue < 0 || ticket == 0)
 	{
-		printk("Work Queue is NULL\n");
+		return retValue;
+	}
+	//Writes run in the order queued, the last one done means all are
+	return i2c_eeprom_wait_ticket(log->dev, ticket);
+}
+
+/**
+* i2c_eeprom_log_ioctl - Function to perform IOCTL operations on a log
+* @file: File Pointer
+* @arg: Arguments to the functions
+* @cmd: Command to perform specific functions
+*
+* Returns as the EEPROM nodes, FLASHGETS, FLASHGETG and FLASHFLUSH are supported.
+* FLASHGETG gives the pages of the ring.
+*/
+static long i2c_eeprom_log_ioctl(struct file *file, unsigned int arg, unsigned long cmd)
+{
+	struct i2c_eeprom_log_file *ctx = file->private_data;
+	struct i2c_eeprom_log *log = ctx->log;
+	struct i2c_EEPROM_geometry geometry;
+	long retValue = 0;
+
+	switch(cmd)
+	{
+		case FLASHGETS:
+			{
+				retValue = log->dev->BUSY_FLAG;
+				break;
+			}
+		case FLASHGETG:
+			{
+				geometry = log->dev->geometry;
+				geometry.number_of_pages = log->number_of_pages;
+				if(copy_to_user((void __user *)(unsigned long)arg, &geometry, sizeof(struct i2c_EEPROM_geometry)))
+				{
+					retValue = -EFAULT;
+				}
+				break;
+			}
+		case FLASHFLUSH:
+			{
+				retValue = i2c_eeprom_log_fsync(file, 0, 0, 0);
+				break;
+			}
+		default:
+			retValue = -ENOTTY;
+			break;
 	}
-	//printk("i2c_flash.c : i2c_eeprom_read_from_queue : End\n");
 	return retValue;
 }
 
@@ -30,9 +30,75 @@
 #define FLASHGETP			2
 #define FLASHSETP			3
 #define FLASHERASE			4
+#define FLASHGETG			5
+#define FLASHERASEP			6
+#define FLASHERASEC			7
+#define FLASHWAIT			8
+#define FLASHFLUSH			9
+#define FLASHCANCEL			10
+#define FLASHSTATUS			11
+#define FLASHCAS			12
+#define MAX_PAGE_SIZE		256
 #define EAGAIN				11
 #define EBUSY				16
 
+/**
+ *  Chip geometry as returned by FLASHGETG
+ */
+struct i2c_EEPROM_geometry
+{
+	unsigned int page_size;
+	unsigned int number_of_pages;
+	unsigned int address_bytes;
+	unsigned int slave_address;
+};
+
+/**
+ *  Progress of the queued erase as returned by FLASHERASEP
+ */
+struct i2c_EEPROM_progress
+{
+	unsigned int pages_done;
+	unsigned int pages_total;
+	unsigned int status;
+};
+
+/**
+ *  Scheduler state as returned by FLASHSTATUS
+ */
+struct i2c_EEPROM_status
+{
+	unsigned int queue_depth;
+	unsigned int current_op;
+	unsigned int current_ticket;
+	unsigned int pages_done;
+	unsigned int pages_total;
+	int last_error;
+	unsigned int works_done;
+	unsigned int works_failed;
+	long long queued_ns;
+	long long started_ns;
+	long long finished_ns;
+};
+
+/**
+ *  Compare-and-swap request passed to FLASHCAS
+ */
+struct i2c_EEPROM_cas
+{
+	unsigned int page;
+	unsigned int offset;
+	unsigned int length;
+	char *expected;
+	const char *desired;
+};
+
+/**
+ * Geometry of the opened EEPROM, defaults until FLASHGETG succeeds
+ */
+unsigned int page_size = EEPROM_PAGE_SIZE;
+unsigned int number_of_pages = NUMBER_OF_PAGES;
+
 void generate_randomString(char *s, const int len);
 /**
  * Main Function
@@ -40,8 +106,8 @@ void generate_randomString(char *s, const int len);
 int main(int argc, char **argv)
 {
 	int fd, res = 0, option;
-	/* open device */
-	fd = open(DEVICE_PATH, O_RDWR);
+	/* open device, the driver creates /dev/i2c_flash1 and on for further EEPROMs */
+	fd = open((argc > 1) ? argv[1] : DEVICE_PATH, O_RDWR);
 	if (fd < 0 )
 	{
 		printf("Can not open device file.\n");	
@@ -50,10 +116,11 @@ int main(int argc, char **argv)
 	else
 	{
 		printf("Device Opened Successfully.\n");
+		get_Geometry_EEPROM(fd);
 		while(1)
 		{
 			//sleep(1);
-			printf("\nInput command: \n1. Read\n2. Write\n3. FLASHGETS\n4. FLASHGETP\n5. FLASHSETP\n6. FLASHERASE\n7. Exit\n");
+			printf("\nInput command: \n1. Read\n2. Write\n3. FLASHGETS\n4. FLASHGETP\n5. FLASHSETP\n6. FLASHERASE\n7. Exit\n8. Erase Progress\n9. Cancel Erase\n10. Wait for Write\n11. Flush\n12. Cancel Queued Work\n13. Status\n14. Compare and Swap\n");
 			scanf("%d",&option);
 			switch(option)
 			{
@@ -77,6 +144,27 @@ int main(int argc, char **argv)
 					break;
 				case 7:
 					exit(0);
+				case 8:
+					get_Erase_Progress_EEPROM(fd);
+					break;
+				case 9:
+					cancel_Erase_EEPROM(fd);
+					break;
+				case 10:
+					wait_Write_EEPROM(fd);
+					break;
+				case 11:
+					flush_EEPROM(fd);
+					break;
+				case 12:
+					cancel_Work_EEPROM(fd);
+					break;
+				case 13:
+					get_Scheduler_Status_EEPROM(fd);
+					break;
+				case 14:
+					compare_Swap_EEPROM(fd);
+					break;
 				default: 
 					printf("Enter Valid Option\n");
       				break;
@@ -99,10 +187,11 @@ int read_EEPROM(int fd)
 {
 	int retValue,count,cp;
 	unsigned int i,j,k;
-	char buf[EEPROM_PAGE_SIZE * NUMBER_OF_PAGES];
+	char *buf;
 
 	printf("Enter the Number of pages to read from EEPROM\n");
 	scanf("%d",&count);
+	buf = (char *)malloc(page_size * number_of_pages);
 	cp = ioctl(fd,&k, FLASHGETP);
 	do
 	{
@@ -116,10 +205,10 @@ int read_EEPROM(int fd)
 		printf("Read Successful\n");
 		for(j=0;j<count;j++)
 		{
-			printf("Page %d : ",(j+cp) % (NUMBER_OF_PAGES));
-			for(i = 0; i < EEPROM_PAGE_SIZE; i++)
+			printf("Page %d : ",(j+cp) % (number_of_pages));
+			for(i = 0; i < page_size; i++)
 			{
-				printf("%c",buf[i + (j*EEPROM_PAGE_SIZE)]);
+				printf("%c",buf[i + (j*page_size)]);
 			}
 			printf("\n");
 		}
@@ -128,6 +217,7 @@ int read_EEPROM(int fd)
 	{
 		printf("Read Failure\n");
 	}
+	free(buf);
 	return retValue;
 }
 
@@ -135,7 +225,7 @@ int read_EEPROM(int fd)
 * write_EEPROM - Function to write into EEPROM
 * @fd: File Descriptor
 *
-* Returns negative errno, or else the number of bytes written.
+* Returns negative errno, or else the ticket of the queued write.
 * 
 * Description: Takes input from user on number of pages to write and make a call to 
 * i2c_flash driver to write corresponding number of pages
@@ -148,20 +238,20 @@ int write_EEPROM(int fd)
 	printf("Enter the Number of pages to write to EEPROM\n");
 	scanf("%d",&count);
 	
-	writeBuffer = (char *)malloc(count*EEPROM_PAGE_SIZE);
-	generate_randomString(writeBuffer,count*EEPROM_PAGE_SIZE);
+	writeBuffer = (char *)malloc(count*page_size + 1);
+	generate_randomString(writeBuffer,count*page_size);
 	retValue = write(fd, writeBuffer, count);
-	if(retValue == -EBUSY)
+	if(retValue > 0)
 	{
-		printf("EEPROM is busy\n");
+		printf("Write queued with ticket %d, it will be performed by the driver subsequently\n", retValue);
 	}
 	else if(retValue == 0)
 	{
-		printf("EEPROM is not busy and the write operation will be performed by the driver subsequently\n");
+		printf("Write cached, the driver writes it after write_delay or on flush\n");
 	}
 	else
 	{
-		printf("Write Successful\n");
+		printf("Write Failure\n");
 	}
 	free(writeBuffer);
 	return retValue;
@@ -232,7 +322,7 @@ int set_Pointer_EEPROM(int fd)
 	int retValue;
 	unsigned int i;
 	
-	printf("Enter the Pointer Set Position (0-511)\n");
+	printf("Enter the Pointer Set Position (0-%u)\n", number_of_pages - 1);
 	scanf("%d",&i);
 	retValue = ioctl(fd,i,FLASHSETP);
 	if(retValue < 0)
@@ -251,9 +341,10 @@ int set_Pointer_EEPROM(int fd)
 * erase_EEPROM - Function to erase all pages of EEPROM
 * @fd: File Descriptor
 *
-* Returns Number of pages erased
+* Returns 0 if the erase was queued
 * 
-* Description: This function erases all the pages of EEPROM
+* Description: This function queues the erase of all the pages of EEPROM and returns
+* 				immediately, the driver erases the pages subsequently
 */
 int erase_EEPROM(int fd)
 {
@@ -262,12 +353,261 @@ int erase_EEPROM(int fd)
 	retValue = ioctl(fd,i,FLASHERASE);
 	if (retValue < 0)
 	{
-		printf("EEPROM Erase Failure\n");
+		printf("EEPROM Erase Failure : an erase is already queued\n");
 	}
 	else
 	{
-		printf("EEPROM Erase Successful\n");
-		printf("Current EEPROM Pointer Position : %d\n",retValue);
+		printf("EEPROM Erase Queued, check option 8 for progress\n");
+	}
+	return retValue;
+}
+
+/**
+* get_Erase_Progress_EEPROM - Function to get the progress of the queued erase
+* @fd: File Descriptor
+*
+* Returns Number of pages erased
+* 
+* Description: Fetches pages erased out of total and the state of the erase
+*/
+int get_Erase_Progress_EEPROM(int fd)
+{
+	long retValue=0;
+	struct i2c_EEPROM_progress progress;
+	retValue = ioctl(fd,&progress,FLASHERASEP);
+	if (retValue < 0)
+	{
+		printf("EEPROM Erase Progress Failure\n");
+	}
+	else if(progress.status == 0)
+	{
+		printf("No EEPROM Erase has been queued\n");
+	}
+	else
+	{
+		printf("EEPROM Erase %s : %u of %u pages\n",
+			progress.status == 'Q' ? "Queued" :
+			progress.status == 'R' ? "Running" :
+			progress.status == 'D' ? "Done" :
+			progress.status == 'C' ? "Cancelled" : "Failed",
+			progress.pages_done, progress.pages_total);
+	}
+	return retValue;
+}
+
+/**
+* cancel_Erase_EEPROM - Function to cancel the queued erase
+* @fd: File Descriptor
+*
+* Returns Number of pages erased before the cancel
+* 
+* Description: The driver stops the erase at the next page boundary
+*/
+int cancel_Erase_EEPROM(int fd)
+{
+	long retValue=0;
+	unsigned int i =0;
+	retValue = ioctl(fd,i,FLASHERASEC);
+	if (retValue < 0)
+	{
+		printf("No EEPROM Erase to cancel, or a read was already served from it\n");
+	}
+	else
+	{
+		printf("EEPROM Erase Cancelled after %ld pages\n",retValue);
+	}
+	return retValue;
+}
+
+/**
+* wait_Write_EEPROM - Function to wait for a queued write
+* @fd: File Descriptor
+*
+* Returns 0 once the write is on the chip, or else negative value
+* 
+* Description: Takes the ticket returned by a write and blocks until the driver has
+* 				written it, or reports that it was cancelled or failed
+*/
+int wait_Write_EEPROM(int fd)
+{
+	long retValue=0;
+	unsigned int ticket;
+
+	printf("Enter the ticket of the write\n");
+	scanf("%u",&ticket);
+	retValue = ioctl(fd,ticket,FLASHWAIT);
+	if (retValue < 0)
+	{
+		printf("Write %u was cancelled, failed or is unknown\n",ticket);
+	}
+	else
+	{
+		printf("Write %u is on the EEPROM\n",ticket);
+	}
+	return retValue;
+}
+
+/**
+* flush_EEPROM - Function to wait for all queued work
+* @fd: File Descriptor
+*
+* Returns 0 once the queue is empty
+* 
+* Description: Blocks until every queued read, write and erase has finished
+*/
+int flush_EEPROM(int fd)
+{
+	long retValue=0;
+	unsigned int i =0;
+	retValue = ioctl(fd,i,FLASHFLUSH);
+	if (retValue < 0)
+	{
+		printf("EEPROM Flush Failure\n");
+	}
+	else
+	{
+		printf("EEPROM Flush Successful, all queued work is done\n");
+	}
+	return retValue;
+}
+
+/**
+* cancel_Work_EEPROM - Function to cancel queued work that has not started
+* @fd: File Descriptor
+*
+* Returns Number of works cancelled, or else negative value
+* 
+* Description: Takes a ticket, or 0 to cancel all queued work of this program that has not started
+*/
+int cancel_Work_EEPROM(int fd)
+{
+	long retValue=0;
+	unsigned int ticket;
+
+	printf("Enter the ticket to cancel (0 for all work queued by this program)\n");
+	scanf("%u",&ticket);
+	retValue = ioctl(fd,ticket,FLASHCANCEL);
+	if (retValue < 0)
+	{
+		printf("Nothing cancelled : the work has started or is not queued\n");
+	}
+	else
+	{
+		printf("%ld queued works cancelled\n",retValue);
+	}
+	return retValue;
+}
+
+/**
+* get_Scheduler_Status_EEPROM - Function to get the scheduler state of EEPROM
+* @fd: File Descriptor
+*
+* Returns 0, or else negative value
+* 
+* Description: Shows queue depth, the work on the bus and its progress, the last
+* 				error and when work was last queued, started and finished
+*/
+int get_Scheduler_Status_EEPROM(int fd)
+{
+	long retValue=0;
+	struct i2c_EEPROM_status status;
+	retValue = ioctl(fd,&status,FLASHSTATUS);
+	if (retValue < 0)
+	{
+		printf("EEPROM Status Failure\n");
+		return retValue;
+	}
+	printf("Queue depth : %u\n",status.queue_depth);
+	if(status.current_op == 0)
+	{
+		printf("Idle\n");
+	}
+	else
+	{
+		printf("%s %u : %u of %u pages\n",
+			status.current_op == 'R' ? "Read" :
+			status.current_op == 'W' ? "Write" : "Erase",
+			status.current_ticket, status.pages_done, status.pages_total);
+	}
+	printf("Works done %u, failed or cancelled %u, last error %d\n",status.works_done,status.works_failed,status.last_error);
+	printf("Last queued %lld ns, started %lld ns, finished %lld ns\n",status.queued_ns,status.started_ns,status.finished_ns);
+	return retValue;
+}
+
+/**
+* compare_Swap_EEPROM - Function to update bytes of a page only if they hold the expected text
+* @fd: File Descriptor
+*
+* Returns the ticket of the queued write, 0 if cached, or else negative value
+* 
+* Description: Takes a page, an offset in the page, the expected text and the new
+* 				text of the same length. On a mismatch the driver returns the text
+* 				the page held, which is shown.
+*/
+int compare_Swap_EEPROM(int fd)
+{
+	long retValue=0;
+	struct i2c_EEPROM_cas request;
+	char expected[MAX_PAGE_SIZE + 1], typed[MAX_PAGE_SIZE + 1], desired[MAX_PAGE_SIZE + 1];
+
+	printf("Enter the page and the offset in the page\n");
+	scanf("%u %u",&request.page,&request.offset);
+	printf("Enter the expected text and the new text, of the same length\n");
+	scanf("%256s %256s",expected,desired);
+	if(strlen(expected) != strlen(desired))
+	{
+		printf("Compare and Swap Failure : the texts differ in length\n");
+		return -1;
+	}
+	strcpy(typed,expected);
+	request.length = strlen(expected);
+	request.expected = expected;
+	request.desired = desired;
+	retValue = ioctl(fd,&request,FLASHCAS);
+	if(retValue > 0)
+	{
+		printf("Compare and Swap Successful, write queued with ticket %ld\n",retValue);
+	}
+	else if(retValue == 0)
+	{
+		printf("Compare and Swap Successful, the page was updated in the write cache\n");
+	}
+	else if(strcmp(typed,expected) != 0)
+	{
+		printf("Compare and Swap Failure : the page holds %s\n",expected);
+	}
+	else
+	{
+		printf("Compare and Swap Failure\n");
+	}
+	return retValue;
+}
+
+/**
+* get_Geometry_EEPROM - Function to get the geometry of EEPROM
+* @fd: File Descriptor
+*
+* Returns 0, or negative value if the driver does not report its geometry.
+* 
+* Description: Fetches page size and number of pages from the driver, so the
+* 				same program works for every supported EEPROM part.
+*/
+int get_Geometry_EEPROM(int fd)
+{
+	int retValue;
+	struct i2c_EEPROM_geometry geometry;
+
+	retValue = ioctl(fd,&geometry,FLASHGETG);
+	if(retValue < 0)
+	{
+		printf("EEPROM Geometry not reported, assuming %u pages of %u bytes\n", number_of_pages, page_size);
+	}
+	else
+	{
+		page_size = geometry.page_size;
+		number_of_pages = geometry.number_of_pages;
+		printf("EEPROM Geometry : %u pages of %u bytes, %u byte address, slave address 0x%x\n",
+			number_of_pages, page_size, geometry.address_bytes, geometry.slave_address);
 	}
 	return retValue;
 }